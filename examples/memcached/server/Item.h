@@ -2,6 +2,7 @@
 #define MUDUO_EXAMPLES_MEMCACHED_SERVER_ITEM_H
 
 #include <atomic>
+#include <muduo/base/noncopyable.h>
 #include <muduo/base/StringPiece.h>
 #include <muduo/base/Types.h>
 
@@ -1,5 +1,6 @@
 #include <muduo/net/TcpClient.h>
 
+#include <muduo/base/CountDownLatch.h>
 #include <muduo/base/Logging.h>
 #include <muduo/base/Thread.h>
 #include <muduo/net/EventLoop.h>
@@ -86,7 +87,8 @@ class Client : noncopyable
     : loop_(loop),
       threadPool_(loop, "pingpong-client"),
       sessionCount_(sessionCount),
-      timeout_(timeout)
+      timeout_(timeout),
+      numConnected_(0)
   {
     loop->runAfter(timeout, std::bind(&Client::handleTimeout, this));
     if (threadCount > 1)
@@ -110,6 +112,25 @@ class Client : noncopyable
     }
   }
 
+  void printPollStats()
+  {
+    int64_t channelUpdates = 0;
+    int64_t interestSyscalls = 0;
+    for (EventLoop* loop : threadPool_.getAllLoops())
+    {
+      CountDownLatch latch(1);
+      loop->runInLoop([&] {
+        EventLoop::PollStats stats = loop->pollStats();
+        channelUpdates += stats.channelUpdates;
+        interestSyscalls += stats.interestSyscalls;
+        latch.countDown();
+      });
+      latch.wait();
+    }
+    LOG_WARN << channelUpdates << " channel updates, "
+             << interestSyscalls << " epoll_ctl";
+  }
+
   const string& message() const
   {
     return message_;
@@ -209,6 +230,7 @@ int main(int argc, char* argv[])
 
     Client client(&loop, serverAddr, blockSize, sessionCount, timeout, threadCount);
     loop.loop();
+    client.printPollStats();
   }
 }
 
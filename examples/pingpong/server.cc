@@ -4,21 +4,42 @@
 #include <muduo/base/Logging.h>
 #include <muduo/base/Thread.h>
 #include <muduo/net/EventLoop.h>
+#include <muduo/net/EventLoopThreadPool.h>
 #include <muduo/net/InetAddress.h>
 
 #include <utility>
 
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
+TcpServer* g_server;
+std::atomic_int32_t g_numConnected(0);
+
+void printPollStats(EventLoop* loop)
+{
+  EventLoop::PollStats stats = loop->pollStats();
+  LOG_WARN << stats.channelUpdates << " channel updates, "
+           << stats.interestSyscalls << " epoll_ctl";
+}
+
 void onConnection(const TcpConnectionPtr& conn)
 {
   if (conn->connected())
   {
     conn->setTcpNoDelay(true);
+    ++g_numConnected;
+  }
+  else if (--g_numConnected == 0)
+  {
+    // 每个 loop 在自己的线程里打印
+    for (EventLoop* loop : g_server->threadPool()->getAllLoops())
+    {
+      loop->queueInLoop(std::bind(printPollStats, loop));
+    }
   }
 }
 
@@ -31,7 +52,7 @@ int main(int argc, char* argv[])
 {
   if (argc < 4)
   {
-    fprintf(stderr, "Usage: server <address> <port> <threads>\n");
+    fprintf(stderr, "Usage: server <address> <port> <threads> [et]\n");
   }
   else
   {
@@ -46,9 +67,11 @@ int main(int argc, char* argv[])
     EventLoop loop;
 
     TcpServer server(&loop, listenAddr, "PingPong");
+    g_server = &server;
 
     server.setConnectionCallback(onConnection);
     server.setMessageCallback(onMessage);
+    server.setEdgeTriggered(argc > 4 && strcmp(argv[4], "et") == 0);
 
     if (threadCount > 1)
     {
@@ -13,7 +13,9 @@ ChargenServer::ChargenServer(EventLoop* loop,
                              bool print)
   : server_(loop, listenAddr, "ChargenServer"),
     transferred_(0),
-    startTime_(Timestamp::now())
+    startTime_(Timestamp::now()),
+    channelUpdates_(0),
+    interestSyscalls_(0)
 {
   server_.setConnectionCallback(
       std::bind(&ChargenServer::onConnection, this, _1));
@@ -75,8 +77,14 @@ void ChargenServer::printThroughput()
 {
   Timestamp endTime = Timestamp::now();
   double time = timeDifference(endTime, startTime_);
-  printf("%4.3f MiB/s\n", static_cast<double>(transferred_)/time/1024/1024);
+  EventLoop::PollStats stats = server_.getLoop()->pollStats();
+  printf("%4.3f MiB/s, %lld channel updates, %lld epoll_ctl\n",
+         static_cast<double>(transferred_)/time/1024/1024,
+         static_cast<long long>(stats.channelUpdates - channelUpdates_),
+         static_cast<long long>(stats.interestSyscalls - interestSyscalls_));
   transferred_ = 0;
   startTime_ = endTime;
+  channelUpdates_ = stats.channelUpdates;
+  interestSyscalls_ = stats.interestSyscalls;
 }
 
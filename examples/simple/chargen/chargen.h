@@ -28,6 +28,8 @@ class ChargenServer
   muduo::string message_;
   int64_t transferred_;
   muduo::Timestamp startTime_;
+  int64_t channelUpdates_;
+  int64_t interestSyscalls_;
 };
 
 #endif  // MUDUO_EXAMPLES_SIMPLE_CHARGEN_CHARGEN_H
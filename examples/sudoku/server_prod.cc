@@ -20,6 +20,9 @@ using namespace muduo::net;
 
 #include "stat.h"
 
+// 客户端等待应答的时间，超过之后的请求即使求解也没有意义
+const double kRequestTimeout = 1.0;
+
 class SudokuServer : noncopyable
 {
  public:
@@ -55,6 +58,8 @@ class SudokuServer : noncopyable
   void start()
   {
     LOG_INFO << "Starting " << numThreads_ << " computing threads.";
+    // 按排队时间而不是队列长度判断过载
+    threadPool_.setAdmission(ThreadPool::kCoDel);
     threadPool_.start(numThreads_);
     server_.start();
   }
@@ -168,27 +173,41 @@ class SudokuServer : noncopyable
     if (req.puzzle.size() == implicit_cast<size_t>(kCells))
     {
       bool throttle = std::any_cast<bool>(conn->getContext());
-      if (threadPool_.queueSize() < 1000 * 1000 && !throttle)
+      bool admitted = false;
+      if (!throttle)
       {
-        threadPool_.run(std::bind(&SudokuServer::solve, this, conn, req));
+        // 客户端已经超时的请求不再求解
+        ThreadPool::TaskOptions options;
+        options.deadline = addTime(receiveTime, kRequestTimeout);
+        options.onDrop = [this, conn, id = req.id](ThreadPool::DropReason)
+        {
+          replyTooBusy(conn, id);
+        };
+        admitted = threadPool_.run(std::bind(&SudokuServer::solve, this, conn, req),
+                                   std::move(options));
       }
-      else
+      if (!admitted)
       {
-        if (req.id.empty())
-        {
-          conn->send("ServerTooBusy\r\n");
-        }
-        else
-        {
-          conn->send(req.id + ":ServerTooBusy\r\n");
-        }
-        stat_.recordDroppedRequest();
+        replyTooBusy(conn, req.id);
       }
       return true;
     }
     return false;
   }
 
+  void replyTooBusy(const TcpConnectionPtr& conn, const string& id)
+  {
+    if (id.empty())
+    {
+      conn->send("ServerTooBusy\r\n");
+    }
+    else
+    {
+      conn->send(id + ":ServerTooBusy\r\n");
+    }
+    stat_.recordDroppedRequest();
+  }
+
   void solve(const TcpConnectionPtr& conn, const Request& req)
   {
     LOG_DEBUG << conn->name();
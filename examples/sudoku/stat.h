@@ -23,6 +23,10 @@ class SudokuStat : muduo::noncopyable
     LogStream result;
     size_t queueSize = pool_.queueSize();
     result << "task_queue_size " << queueSize << '\n';
+    result << "task_overloaded " << pool_.overloaded() << '\n';
+    result << "task_rejected " << pool_.rejected() << '\n';
+    result << "task_dropped_expired " << pool_.droppedExpired() << '\n';
+    result << "task_dropped_overloaded " << pool_.droppedOverloaded() << '\n';
 
     {
     MutexLockGuard lock(mutex_);
@@ -178,7 +182,7 @@ class SudokuStat : muduo::noncopyable
   }
 
  private:
-  const ThreadPool& pool_;  // only for ThreadPool::queueSize()
+  const ThreadPool& pool_;  // only for queue size and drop counters
   mutable MutexLock mutex_;
   // invariant:
   // 0. requests_.size() == latencies_.size()
@@ -9,6 +9,7 @@
 #include <muduo/base/Condition.h>
 #include <muduo/base/Mutex.h>
 
+#include <atomic>
 #include <deque>
 #include <assert.h>
 
@@ -22,14 +23,21 @@ class BlockingQueue : noncopyable
   BlockingQueue()
     : mutex_(),
       notEmpty_(),
-      queue_()
+      queue_(),
+      count_(0)
   {
   }
 
+  // 默认直接 park，见 WaitStrategy。
+  // Must be called before any thread calls take().
+  void setWaitStrategy(const WaitStrategy& strategy) { strategy_ = strategy; }
+  const WaitStats& waitStats() const { return stats_; }
+
   void put(const T& x)
   {
     MutexLockGuard lock(mutex_);
     queue_.push_back(x);
+    count_.store(queue_.size(), std::memory_order_release);
     notEmpty_.notify(); // wait morphing saves us
     // http://www.domaigne.com/blog/computing/condvars-signal-with-mutex-locked-or-not/
   }
@@ -38,6 +46,7 @@ class BlockingQueue : noncopyable
   {
     MutexLockGuard lock(mutex_);
     queue_.push_back(std::move(x));
+    count_.store(queue_.size(), std::memory_order_release);
     notEmpty_.notify();
   }
 
@@ -45,13 +54,14 @@ class BlockingQueue : noncopyable
   {
     MutexLockGuard lock(mutex_);
     // always use a while-loop, due to spurious wakeup
-    while (queue_.empty())
-    {
-      notEmpty_.wait(lock);
-    }
+    notEmpty_.wait(lock,
+                   [this] { return !queue_.empty(); },
+                   [this] { return count_.load(std::memory_order_acquire) > 0; },
+                   strategy_, &stats_);
     assert(!queue_.empty());
     T front(std::move(queue_.front()));
     queue_.pop_front();
+    count_.store(queue_.size(), std::memory_order_release);
     return front;
   }
 
@@ -65,6 +75,9 @@ class BlockingQueue : noncopyable
   mutable MutexLock mutex_;
   Condition         notEmpty_ GUARDED_BY(mutex_);
   std::deque<T>     queue_ GUARDED_BY(mutex_);
+  std::atomic<size_t> count_;  // queue_.size()，供不持锁自旋时读取
+  WaitStrategy      strategy_;
+  WaitStats         stats_;
 };
 
 }  // namespace muduo
@@ -3,7 +3,10 @@
 
 #include <muduo/base/Condition.h>
 #include <muduo/base/Mutex.h>
+#include <algorithm>
+#include <atomic>
 #include <deque>
+#include <vector>
 
 namespace muduo
 {
@@ -12,43 +15,106 @@ class BlockingQueueForThreadPool : noncopyable
 {
 public:
   BlockingQueueForThreadPool(int maxsize = 0)
-      : mutex_(), notFull_(), notEmpty_(), maxSize_(maxsize), running_(true) {}
+      : mutex_(), notFull_(), notEmpty_(), maxSize_(maxsize), running_(true), count_(0) {}
   ~BlockingQueueForThreadPool() = default;
 
+  // 默认直接 park，见 WaitStrategy。
+  // Must be called before any thread calls put() or take().
+  void setWaitStrategy(const WaitStrategy &strategy) { strategy_ = strategy; }
+  const WaitStats &waitStats() const { return stats_; }
+
   template<typename U>
   void put(U &&x)
   {
     MutexLockGuard lock(mutex_);
     if (maxSize_ != 0)
     {
-      while (queue_.size() >= maxSize_ && running_)
-      {
-        notFull_.wait(lock);
-      }
+      notFull_.wait(lock,
+                    [this] { return queue_.size() < maxSize_ || !running_; },
+                    [this] { return count_.load(std::memory_order_acquire) < maxSize_ || !running_; },
+                    strategy_, &stats_);
     }
 
     if (!running_)
       return;
     queue_.push_back(std::forward<U>(x));
+    count_.store(queue_.size(), std::memory_order_release);
     notEmpty_.notify();
   }
 
+  // moves all elements of xs in with one lock, blocks while full
+  void putBatch(std::vector<T> &xs)
+  {
+    MutexLockGuard lock(mutex_);
+    size_t added = 0;
+    for (T &x : xs)
+    {
+      if (maxSize_ != 0)
+      {
+        while (queue_.size() >= maxSize_ && running_)
+        {
+          // 先唤醒消费者，否则可能互相等待
+          notifyTakers(queue_.size());
+          notFull_.wait(lock);
+        }
+      }
+      if (!running_)
+        break;
+      queue_.push_back(std::move(x));
+      count_.store(queue_.size(), std::memory_order_release);
+      ++added;
+    }
+    notifyTakers(added);
+  }
+
+  // returns false if full or stopped, x is left untouched
+  template<typename U>
+  bool tryPut(U &&x)
+  {
+    MutexLockGuard lock(mutex_);
+    if (!running_ || (maxSize_ != 0 && queue_.size() >= maxSize_))
+      return false;
+    queue_.push_back(std::forward<U>(x));
+    count_.store(queue_.size(), std::memory_order_release);
+    notEmpty_.notify();
+    return true;
+  }
+
 T take()
 {
   MutexLockGuard lock(mutex_);
-  while (queue_.empty() && running_)
-  {
-    notEmpty_.wait(lock);
-  }
+  ++takers_;
+  notEmpty_.wait(lock,
+                 [this] { return !queue_.empty() || !running_; },
+                 [this] { return count_.load(std::memory_order_acquire) > 0 || !running_; },
+                 strategy_, &stats_);
+  --takers_;
   if (!running_)
     return T(); // Return a default-constructed T object if the queue is not running
   assert(!queue_.empty());
   T front(std::move(queue_.front()));
   queue_.pop_front();
+  count_.store(queue_.size(), std::memory_order_release);
   notFull_.notify();
   return front;
 }
 
+  // returns false if timeout or stopped
+  bool take(T *x, double seconds)
+  {
+    MutexLockGuard lock(mutex_);
+    ++takers_;
+    notEmpty_.waitForSeconds(lock, seconds, [this] { return !queue_.empty() || !running_; });
+    --takers_;
+    if (!running_ || queue_.empty())
+      return false;
+    *x = std::move(queue_.front());
+    queue_.pop_front();
+    count_.store(queue_.size(), std::memory_order_release);
+    notFull_.notify();
+    return true;
+  }
+
   size_t size() const
   {
     MutexLockGuard lock(mutex_);
@@ -72,12 +138,23 @@ T take()
   }
 
 private:
+  // 每个新元素最多唤醒一个消费者，不惊动多余的空闲线程
+  void notifyTakers(size_t n) REQUIRES(mutex_)
+  {
+    for (size_t i = std::min(n, takers_); i > 0; --i)
+      notEmpty_.notify();
+  }
+
   std::deque<T> queue_;
   mutable MutexLock mutex_;
   Condition notFull_ GUARDED_BY(mutex_);
   Condition notEmpty_ GUARDED_BY(mutex_);
   size_t maxSize_; // 0 means no limit
-  bool running_;
+  std::atomic<bool> running_;
+  std::atomic<size_t> count_;  // queue_.size()，供不持锁自旋时读取
+  size_t takers_ = 0;          // 正在 take() 中等待的线程数
+  WaitStrategy strategy_;
+  WaitStats stats_;
 };
 
 } // namespace muduo
@@ -9,6 +9,7 @@
 #include <muduo/base/Condition.h>
 #include <muduo/base/Mutex.h>
 
+#include <atomic>
 #include <deque>
 #include <assert.h>
 
@@ -23,32 +24,40 @@ class BoundedBlockingQueue : noncopyable
     : maxSize_(maxSize),
       mutex_(),
       notEmpty_(),
-      notFull_()
+      notFull_(),
+      count_(0)
   {
   }
 
+  // put() 和 take() 使用同一个策略，默认直接 park，见 WaitStrategy。
+  // Must be called before any thread calls put() or take().
+  void setWaitStrategy(const WaitStrategy& strategy) { strategy_ = strategy; }
+  const WaitStats& waitStats() const { return stats_; }
+
   void put(const T& x)
   {
     MutexLockGuard lock(mutex_);
-    while (queue_.size() == maxSize_)
-    {
-      notFull_.wait(lock);
-    }
+    notFull_.wait(lock,
+                  [this] { return queue_.size() < maxSize_; },
+                  [this] { return count_.load(std::memory_order_acquire) < maxSize_; },
+                  strategy_, &stats_);
     assert(queue_.size() < maxSize_);
     queue_.push_back(x);
+    count_.store(queue_.size(), std::memory_order_release);
     notEmpty_.notify();
   }
 
   T take()
   {
     MutexLockGuard lock(mutex_);
-    while (queue_.empty())
-    {
-      notEmpty_.wait(lock);
-    }
+    notEmpty_.wait(lock,
+                   [this] { return !queue_.empty(); },
+                   [this] { return count_.load(std::memory_order_acquire) > 0; },
+                   strategy_, &stats_);
     assert(!queue_.empty());
     T front(queue_.front());
     queue_.pop_front();
+    count_.store(queue_.size(), std::memory_order_release);
     notFull_.notify();
     return front;
   }
@@ -83,6 +92,9 @@ class BoundedBlockingQueue : noncopyable
   Condition                  notEmpty_ GUARDED_BY(mutex_);
   Condition                  notFull_ GUARDED_BY(mutex_);
   std::deque<T>              queue_ GUARDED_BY(mutex_);
+  std::atomic<size_t>        count_;  // queue_.size()，供不持锁自旋时读取
+  WaitStrategy               strategy_;
+  WaitStats                  stats_;
 };
 
 }  // namespace muduo
@@ -7,6 +7,7 @@
 #define MUDUO_BASE_CONDITION_H
 
 #include <muduo/base/Mutex.h>
+#include <muduo/base/WaitStrategy.h>
 #include <chrono>
 #include <condition_variable>
 
@@ -33,6 +34,34 @@ class Condition : noncopyable
     m_cond.wait(lck.getUniqueLock(), pred);
   }
 
+  // 按 strategy 等待 pred 成立：先放开锁自旋/yield 直到 ready() 为真，
+  // 再加锁检查 pred，仍不成立才 park。
+  // ready 不持锁调用，只是提示（例如读一个原子计数），pred 才是准确的条件。
+  template <class Predicate, class Ready>
+  void wait(MutexLockGuard &lck, Predicate pred, Ready ready,
+            const WaitStrategy &strategy, WaitStats *stats)
+  {
+    if (pred())
+    {
+      return;
+    }
+    stats->waits.fetch_add(1, std::memory_order_relaxed);
+    if (!strategy.parksImmediately())
+    {
+      lck.unlock();
+      WaitStrategy::Result result = strategy.spinUntil(ready, stats);
+      lck.lock();
+      if (pred())
+      {
+        (result == WaitStrategy::kSpun ? stats->spinHits : stats->yieldHits)
+            .fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+    }
+    stats->parks.fetch_add(1, std::memory_order_relaxed);
+    m_cond.wait(lck.getUniqueLock(), pred);
+  }
+
   // returns true if time out, false otherwise.
   bool waitForSeconds(MutexLockGuard &lck, double seconds)
   {
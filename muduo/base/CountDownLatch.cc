@@ -17,18 +17,17 @@ CountDownLatch::CountDownLatch(int count)
 void CountDownLatch::wait()
 {
   MutexLockGuard lock(mutex_);
-  while (count_ > 0)
-  {
-    condition_.wait(lock);
-  }
+  condition_.wait(lock,
+                  [this] { return count_.load(std::memory_order_acquire) <= 0; },
+                  [this] { return count_.load(std::memory_order_acquire) <= 0; },
+                  strategy_, &stats_);
 }
 
 // 使计数器减一，并在计数器值为零时唤醒所有等待的线程
 void CountDownLatch::countDown()
 {
   MutexLockGuard lock(mutex_);
-  --count_;
-  if (count_ == 0)
+  if (count_.fetch_sub(1, std::memory_order_acq_rel) == 1)
   {
     condition_.notifyAll();
   }
@@ -9,6 +9,8 @@
 #include <muduo/base/Condition.h>
 #include <muduo/base/Mutex.h>
 
+#include <atomic>
+
 namespace muduo
 {
 
@@ -18,6 +20,11 @@ class CountDownLatch : noncopyable
 
   explicit CountDownLatch(int count);
 
+  // 默认直接 park，见 WaitStrategy。
+  // Must be called before any thread calls wait().
+  void setWaitStrategy(const WaitStrategy& strategy) { strategy_ = strategy; }
+  const WaitStats& waitStats() const { return stats_; }
+
   void wait();
 
   void countDown();
@@ -27,7 +34,10 @@ class CountDownLatch : noncopyable
  private:
   mutable MutexLock mutex_;
   Condition condition_ GUARDED_BY(mutex_);
-  int count_ GUARDED_BY(mutex_);
+  // 只在持锁时修改，wait() 自旋时不持锁读取
+  std::atomic<int> count_;
+  WaitStrategy strategy_;
+  WaitStats stats_;
 };
 
 }  // namespace muduo
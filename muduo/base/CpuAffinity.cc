@@ -0,0 +1,287 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include <muduo/base/CpuAffinity.h>
+
+#include <muduo/base/FileUtil.h>
+#include <muduo/base/Logging.h>
+
+#include <algorithm>
+
+#include <assert.h>
+#include <errno.h>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace muduo;
+
+namespace
+{
+
+// 绑定到单个 CPU 时记下它，EventLoop 等可以据此报告
+thread_local int t_boundCpu = -1;
+
+bool readCpuList(const char* path, std::vector<int>* cpus)
+{
+  string content;
+  int err = FileUtil::readFile(path, 64 * 1024, &content);
+  return err == 0 && CpuAffinity::parseCpuList(content, cpus);
+}
+
+std::vector<int> allowedCpus()
+{
+  std::vector<int> cpus;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (::sched_getaffinity(0, sizeof set, &set) == 0)
+  {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+      if (CPU_ISSET(cpu, &set))
+      {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+  if (cpus.empty())
+  {
+    long n = ::sysconf(_SC_NPROCESSORS_ONLN);
+    for (int cpu = 0; cpu < n; ++cpu)
+    {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+CpuAffinity::Nodes readSystemNodes()
+{
+  std::vector<int> allowed = allowedCpus();
+  CpuAffinity::Nodes nodes;
+  std::vector<int> nodeIds;
+  if (readCpuList("/sys/devices/system/node/online", &nodeIds))
+  {
+    for (int id : nodeIds)
+    {
+      char path[64];
+      snprintf(path, sizeof path, "/sys/devices/system/node/node%d/cpulist", id);
+      std::vector<int> cpus, usable;
+      readCpuList(path, &cpus);
+      for (int cpu : cpus)
+      {
+        if (std::binary_search(allowed.begin(), allowed.end(), cpu))
+        {
+          usable.push_back(cpu);
+        }
+      }
+      // 没有可用 CPU 的 node（纯内存 node 或被 cgroup 排除）直接跳过
+      if (!usable.empty())
+      {
+        nodes.push_back(usable);
+      }
+    }
+  }
+  if (nodes.empty())
+  {
+    nodes.push_back(allowed);
+  }
+  return nodes;
+}
+
+}  // namespace
+
+const CpuAffinity::Nodes& CpuAffinity::systemNodes()
+{
+  static const Nodes nodes = readSystemNodes();
+  return nodes;
+}
+
+bool CpuAffinity::parseCpuList(StringArg list, std::vector<int>* cpus)
+{
+  cpus->clear();
+  const char* p = list.c_str();
+  while (*p != '\0' && *p != '\n')
+  {
+    char* end = NULL;
+    long first = ::strtol(p, &end, 10);
+    if (end == p || first < 0)
+    {
+      return false;
+    }
+    long last = first;
+    p = end;
+    if (*p == '-')
+    {
+      ++p;
+      last = ::strtol(p, &end, 10);
+      if (end == p || last < first)
+      {
+        return false;
+      }
+      p = end;
+    }
+    for (long cpu = first; cpu <= last; ++cpu)
+    {
+      cpus->push_back(static_cast<int>(cpu));
+    }
+    if (*p == ',')
+    {
+      ++p;
+    }
+    else if (*p != '\0' && *p != '\n')
+    {
+      return false;
+    }
+  }
+  std::sort(cpus->begin(), cpus->end());
+  cpus->erase(std::unique(cpus->begin(), cpus->end()), cpus->end());
+  return true;
+}
+
+std::vector<int> CpuAffinity::cpusFor(int index) const
+{
+  if (policy_ == kNone)
+  {
+    return std::vector<int>();
+  }
+  return cpusFor(index, systemNodes());
+}
+
+std::vector<int> CpuAffinity::cpusFor(int index, const Nodes& nodes) const
+{
+  assert(index >= 0);
+  std::vector<int> result;
+  size_t numCpus = 0;
+  for (const auto& node : nodes)
+  {
+    numCpus += node.size();
+  }
+  if (numCpus == 0 && policy_ != kExplicit)
+  {
+    return result;
+  }
+
+  size_t i = static_cast<size_t>(index);
+  switch (policy_)
+  {
+    case kNone:
+      break;
+    case kExplicit:
+      if (!cpus_.empty())
+      {
+        result.push_back(cpus_[i % cpus_.size()]);
+      }
+      break;
+    case kCompact:
+    {
+      size_t n = i % numCpus;
+      for (const auto& node : nodes)
+      {
+        if (n < node.size())
+        {
+          result.push_back(node[n]);
+          break;
+        }
+        n -= node.size();
+      }
+      break;
+    }
+    case kScatter:
+    {
+      // 第 i 个线程放在 node (i % N) 上，依次占用该 node 的 CPU；
+      // 跳过已经用完的 node，所以各 node CPU 数不同时也不会重复绑核，直到所有 CPU 用完
+      size_t n = i % numCpus;
+      std::vector<size_t> used(nodes.size(), 0);
+      size_t node = 0;
+      for (size_t k = 0; ; ++k)
+      {
+        while (used[node] == nodes[node].size())
+        {
+          node = (node + 1) % nodes.size();
+        }
+        if (k == n)
+        {
+          result.push_back(nodes[node][used[node]]);
+          break;
+        }
+        ++used[node];
+        node = (node + 1) % nodes.size();
+      }
+      break;
+    }
+    case kPerNode:
+    {
+      size_t n = i % nodes.size();
+      while (nodes[n].empty())
+      {
+        n = (n + 1) % nodes.size();
+      }
+      result = nodes[n];
+      break;
+    }
+  }
+  return result;
+}
+
+bool CpuAffinity::bindCurrentThread(const std::vector<int>& cpus)
+{
+  if (cpus.empty())
+  {
+    return true;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus)
+  {
+    if (cpu >= 0 && cpu < CPU_SETSIZE)
+    {
+      CPU_SET(cpu, &set);
+    }
+  }
+  int err = ::pthread_setaffinity_np(::pthread_self(), sizeof set, &set);
+  if (err != 0)
+  {
+    errno = err;
+    LOG_SYSERR << "pthread_setaffinity_np, cpu " << cpus.front()
+               << " (" << cpus.size() << " cpus)";
+    return false;
+  }
+  t_boundCpu = cpus.size() == 1 ? cpus.front() : -1;
+  return true;
+}
+
+bool CpuAffinity::setLocalMemoryPolicy()
+{
+  // glibc 没有 set_mempolicy 的包装，也不想依赖 libnuma
+  if (::syscall(SYS_set_mempolicy, MPOL_LOCAL, NULL, 0) != 0)
+  {
+    LOG_SYSERR << "set_mempolicy(MPOL_LOCAL)";
+    return false;
+  }
+  return true;
+}
+
+int CpuAffinity::currentCpu()
+{
+  return t_boundCpu >= 0 ? t_boundCpu : ::sched_getcpu();
+}
+
+int CpuAffinity::nodeOfCpu(int cpu)
+{
+  const Nodes& nodes = systemNodes();
+  for (size_t i = 0; i < nodes.size(); ++i)
+  {
+    if (std::binary_search(nodes[i].begin(), nodes[i].end(), cpu))
+    {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
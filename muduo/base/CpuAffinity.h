@@ -0,0 +1,105 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_CPUAFFINITY_H
+#define MUDUO_BASE_CPUAFFINITY_H
+
+#include <muduo/base/StringPiece.h>
+#include <muduo/base/Types.h>
+
+#include <vector>
+
+namespace muduo
+{
+
+// 线程绑核策略，供 Thread / ThreadPool / EventLoopThreadPool 使用。
+// 第 i 个线程绑定到 cpusFor(i) 返回的 CPU 集合上，空集合表示不绑定。
+//
+// kExplicit  按给定的 CPU 列表轮流分配，每个线程一个 CPU
+// kCompact   先占满 node 0 的所有 CPU，再用 node 1 ...，线程之间共享 LLC
+// kScatter   线程轮流分到各个 node 上，尽量摊开内存带宽
+// kPerNode   线程轮流分到各个 node 上，但只绑定到 node 而不是具体 CPU
+//
+// NUMA 拓扑读自 /sys/devices/system/node，只考虑本进程允许使用的 CPU
+// （taskset/cgroup）；没有 NUMA 信息时当作只有一个 node。
+class CpuAffinity
+{
+ public:
+  enum Policy
+  {
+    kNone,
+    kExplicit,
+    kCompact,
+    kScatter,
+    kPerNode,
+  };
+
+  // nodes[i] 是 node i 上的 CPU 编号，按升序排列
+  typedef std::vector<std::vector<int>> Nodes;
+
+  CpuAffinity()
+    : policy_(kNone),
+      localAlloc_(false)
+  {
+  }
+
+  static CpuAffinity explicitCpus(const std::vector<int>& cpus)
+  {
+    CpuAffinity affinity(kExplicit);
+    affinity.cpus_ = cpus;
+    return affinity;
+  }
+
+  static CpuAffinity compact() { return CpuAffinity(kCompact); }
+  static CpuAffinity scatter() { return CpuAffinity(kScatter); }
+  static CpuAffinity perNode() { return CpuAffinity(kPerNode); }
+
+  // 线程绑核之后把内存策略设为 MPOL_LOCAL，
+  // 线程自己的栈、malloc 出来的缓冲区（包括栈上的 EventLoop）都从本地 node 分配，
+  // 即使进程是用 numactl --interleave 启动的。
+  CpuAffinity& setLocalAlloc(bool on)
+  {
+    localAlloc_ = on;
+    return *this;
+  }
+
+  Policy policy() const { return policy_; }
+  bool localAlloc() const { return localAlloc_; }
+
+  std::vector<int> cpusFor(int index) const;
+  std::vector<int> cpusFor(int index, const Nodes& nodes) const;
+
+  // 本机拓扑，第一次调用时读取并缓存
+  static const Nodes& systemNodes();
+
+  // "0-3,8,10-11" => {0,1,2,3,8,10,11}，格式错误时返回 false
+  static bool parseCpuList(StringArg list, std::vector<int>* cpus);
+
+  // 以下函数作用于调用线程
+
+  // cpus 为空时什么都不做，失败时返回 false 并记日志
+  static bool bindCurrentThread(const std::vector<int>& cpus);
+  static bool setLocalMemoryPolicy();
+
+  // 绑定到单个 CPU 时返回它，否则返回当前所在的 CPU（sched_getcpu）
+  static int currentCpu();
+  // 返回 systemNodes() 中的下标，找不到时返回 -1
+  static int nodeOfCpu(int cpu);
+
+ private:
+  explicit CpuAffinity(Policy policy)
+    : policy_(policy),
+      localAlloc_(false)
+  {
+  }
+
+  Policy policy_;
+  bool localAlloc_;
+  std::vector<int> cpus_;  // kExplicit
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_CPUAFFINITY_H
@@ -0,0 +1,190 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_FUTURE_H
+#define MUDUO_BASE_FUTURE_H
+
+#include <muduo/base/Condition.h>
+#include <muduo/base/Mutex.h>
+
+#include <exception>
+#include <future>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace muduo
+{
+
+namespace detail
+{
+
+template<typename T>
+class FutureState : noncopyable
+{
+ public:
+  // void 结果用一个占位的 bool 表示
+  typedef typename std::conditional<std::is_void<T>::value, bool, T>::type Value;
+
+  FutureState()
+    : ready_(false)
+  {
+  }
+
+  template<typename U>
+  void setValue(U&& value)
+  {
+    MutexLockGuard lock(mutex_);
+    value_.emplace(std::forward<U>(value));
+    ready_ = true;
+    cond_.notifyAll();
+  }
+
+  void setException(std::exception_ptr ex)
+  {
+    MutexLockGuard lock(mutex_);
+    exception_ = ex;
+    ready_ = true;
+    cond_.notifyAll();
+  }
+
+  bool ready() const
+  {
+    MutexLockGuard lock(mutex_);
+    return ready_;
+  }
+
+  void wait()
+  {
+    MutexLockGuard lock(mutex_);
+    while (!ready_)
+    {
+      cond_.wait(lock);
+    }
+  }
+
+  // returns false if timeout
+  bool waitForSeconds(double seconds)
+  {
+    MutexLockGuard lock(mutex_);
+    if (!ready_)
+    {
+      cond_.waitForSeconds(lock, seconds);
+    }
+    return ready_;
+  }
+
+  Value get()
+  {
+    wait();
+    MutexLockGuard lock(mutex_);
+    if (exception_)
+    {
+      std::rethrow_exception(exception_);
+    }
+    return std::move(*value_);
+  }
+
+ private:
+  mutable MutexLock mutex_;
+  Condition cond_ GUARDED_BY(mutex_);
+  bool ready_ GUARDED_BY(mutex_);
+  std::optional<Value> value_ GUARDED_BY(mutex_);
+  std::exception_ptr exception_ GUARDED_BY(mutex_);
+};
+
+}  // namespace detail
+
+// ThreadPool::submit() 的返回值。
+// 比 std::future 简单：结果只能 get() 一次，没有 shared_future/then。
+template<typename T>
+class Future
+{
+ public:
+  Future() = default;
+
+  explicit Future(std::shared_ptr<detail::FutureState<T>> state)
+    : state_(std::move(state))
+  {
+  }
+
+  bool valid() const { return static_cast<bool>(state_); }
+  bool ready() const { return state_->ready(); }
+  void wait() const { state_->wait(); }
+  bool waitForSeconds(double seconds) const { return state_->waitForSeconds(seconds); }
+
+  // blocks until ready, rethrows the exception thrown by the task
+  T get()
+  {
+    std::shared_ptr<detail::FutureState<T>> state(std::move(state_));
+    if constexpr (std::is_void<T>::value)
+    {
+      state->get();
+    }
+    else
+    {
+      return state->get();
+    }
+  }
+
+ private:
+  std::shared_ptr<detail::FutureState<T>> state_;
+};
+
+// 生产者一端，只能移动；
+// 若任务没有执行就被销毁（例如线程池已 stop()），Future 得到 broken_promise 异常。
+template<typename T>
+class Promise
+{
+ public:
+  Promise()
+    : state_(std::make_shared<detail::FutureState<T>>())
+  {
+  }
+
+  Promise(Promise&&) noexcept = default;
+  Promise& operator=(Promise&&) noexcept = default;
+
+  ~Promise()
+  {
+    if (state_ && !state_->ready())
+    {
+      state_->setException(std::make_exception_ptr(
+          std::future_error(std::future_errc::broken_promise)));
+    }
+  }
+
+  Future<T> getFuture() const { return Future<T>(state_); }
+
+  // runs fn and stores its result or exception
+  template<typename Fn>
+  void run(Fn& fn)
+  {
+    try
+    {
+      if constexpr (std::is_void<T>::value)
+      {
+        fn();
+        state_->setValue(true);
+      }
+      else
+      {
+        state_->setValue(fn());
+      }
+    }
+    catch (...)
+    {
+      state_->setException(std::current_exception());
+    }
+  }
+
+ private:
+  std::shared_ptr<detail::FutureState<T>> state_;
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_FUTURE_H
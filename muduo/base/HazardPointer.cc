@@ -0,0 +1,117 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include <muduo/base/HazardPointer.h>
+
+using namespace muduo;
+using namespace muduo::detail;
+
+namespace
+{
+
+// 只追加、不释放的 record 块链表，第一块是静态的
+struct RecordBlock
+{
+  HazardRecord records[HazardPointer::kRecordsPerBlock];
+  std::atomic<RecordBlock*> next{nullptr};
+};
+
+RecordBlock g_firstBlock;
+std::atomic<int> g_numRecords(HazardPointer::kRecordsPerBlock);
+
+// 每个线程缓存的空闲 record，线程退出时归还
+struct RecordCache
+{
+  static const int kSize = 4;
+
+  HazardRecord* records[kSize];
+  int count = 0;
+
+  ~RecordCache()
+  {
+    for (int i = 0; i < count; ++i)
+    {
+      records[i]->active.store(false, std::memory_order_release);
+    }
+  }
+};
+
+thread_local RecordCache t_cache;
+
+}  // namespace
+
+HazardRecord* detail::acquireHazardRecord()
+{
+  if (t_cache.count > 0)
+  {
+    return t_cache.records[--t_cache.count];
+  }
+  RecordBlock* block = &g_firstBlock;
+  for (;;)
+  {
+    for (HazardRecord& record : block->records)
+    {
+      bool expected = false;
+      if (!record.active.load(std::memory_order_relaxed) &&
+          record.active.compare_exchange_strong(expected, true))
+      {
+        return &record;
+      }
+    }
+    RecordBlock* next = block->next.load(std::memory_order_acquire);
+    if (next == nullptr)
+    {
+      // 都在用，追加一块；别的线程抢先追加了就用它的
+      RecordBlock* fresh = new RecordBlock;
+      fresh->records[0].active.store(true, std::memory_order_relaxed);
+      if (block->next.compare_exchange_strong(next, fresh,
+                                              std::memory_order_acq_rel,
+                                              std::memory_order_acquire))
+      {
+        g_numRecords.fetch_add(HazardPointer::kRecordsPerBlock, std::memory_order_relaxed);
+        return &fresh->records[0];
+      }
+      delete fresh;
+    }
+    block = next;
+  }
+}
+
+void detail::releaseHazardRecord(HazardRecord* record)
+{
+  record->pointer.store(nullptr, std::memory_order_release);
+  if (t_cache.count < RecordCache::kSize)
+  {
+    t_cache.records[t_cache.count++] = record;
+  }
+  else
+  {
+    record->active.store(false, std::memory_order_release);
+  }
+}
+
+int detail::numHazardRecords()
+{
+  return g_numRecords.load(std::memory_order_relaxed);
+}
+
+void HazardPointer::collect(std::vector<const void*>* hazards)
+{
+  hazards->clear();
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  for (const RecordBlock* block = &g_firstBlock; block;
+       block = block->next.load(std::memory_order_acquire))
+  {
+    for (const HazardRecord& record : block->records)
+    {
+      const void* p = record.pointer.load(std::memory_order_acquire);
+      if (p)
+      {
+        hazards->push_back(p);
+      }
+    }
+  }
+  std::sort(hazards->begin(), hazards->end());
+}
@@ -0,0 +1,251 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_HAZARDPOINTER_H
+#define MUDUO_BASE_HAZARDPOINTER_H
+
+#include <muduo/base/noncopyable.h>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include <stdint.h>
+
+namespace muduo
+{
+
+namespace detail
+{
+
+struct HazardRecord
+{
+  alignas(64) std::atomic<const void*> pointer;
+  std::atomic<bool> active;
+};
+
+HazardRecord* acquireHazardRecord();
+void releaseHazardRecord(HazardRecord* record);
+int numHazardRecords();
+
+}  // namespace detail
+
+// Hazard pointer (Maged Michael, 2004)，用于无锁数据结构的安全内存回收。
+// 读者在解引用共享节点之前先把它登记到自己的 hazard record 里，
+// 回收者只回收没有被任何 record 登记的节点。
+//
+// 全局的 record 表是一串 kRecordsPerBlock 个 record 的块，用完了就在末尾追加一块，
+// 块一直不释放。每个线程缓存几个 record，所以构造/析构 HazardPointer 通常不需要 CAS。
+class HazardPointer : noncopyable
+{
+ public:
+  static const int kRecordsPerBlock = 64;
+
+  HazardPointer()
+    : record_(detail::acquireHazardRecord())
+  {
+  }
+
+  ~HazardPointer()
+  {
+    detail::releaseHazardRecord(record_);
+  }
+
+  // loads src and publishes it, retries until the published value is still current
+  template<typename T>
+  T* protect(const std::atomic<T*>& src)
+  {
+    T* p = src.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      set(p);
+      T* q = src.load(std::memory_order_acquire);
+      if (q == p)
+      {
+        return p;
+      }
+      p = q;
+    }
+  }
+
+  // caller must validate the source after set()
+  void set(const void* p)
+  {
+    record_->pointer.store(p, std::memory_order_relaxed);
+    // 与 collect() 前的 fence 配对，保证回收者能看到这次登记
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+
+  void reset()
+  {
+    record_->pointer.store(nullptr, std::memory_order_release);
+  }
+
+  // sorted snapshot of all published pointers
+  static void collect(std::vector<const void*>* hazards);
+
+  // records allocated so far, grows with the number of threads
+  static int numRecords() { return detail::numHazardRecords(); }
+
+ private:
+  detail::HazardRecord* record_;
+};
+
+// 配合 HazardPointer 使用的节点池：
+// 摘下来的节点先 retire()，攒够一批后扫描 hazard pointer，
+// 没有被引用的节点放回 freelist 复用，池析构时统一 delete。
+//
+// Node 需要默认构造，并提供两个字段：
+//   std::atomic<Node*> poolNext;  // freelist / retire list
+//   Node* poolAll;                // 所有分配过的节点
+template<typename Node>
+class HazardNodePool : noncopyable
+{
+ public:
+  HazardNodePool()
+    : freeList_(0),
+      retired_(nullptr),
+      retiredCount_(0),
+      all_(nullptr)
+  {
+    static_assert(sizeof(void*) == 8, "tagged pointer needs 64-bit");
+  }
+
+  // all nodes must be returned or retired
+  ~HazardNodePool()
+  {
+    Node* node = all_.load(std::memory_order_acquire);
+    while (node)
+    {
+      Node* next = node->poolAll;
+      delete node;
+      node = next;
+    }
+  }
+
+  Node* get()
+  {
+    uint64_t head = freeList_.load(std::memory_order_acquire);
+    for (;;)
+    {
+      Node* node = pointerOf(head);
+      if (node == nullptr)
+      {
+        break;
+      }
+      // node 可能已被别的线程取走并正在使用，但内存不会释放，
+      // 读到的 next 即使过期也会因为 tag 变化而 CAS 失败
+      Node* next = node->poolNext.load(std::memory_order_relaxed);
+      if (freeList_.compare_exchange_weak(head, pack(next, tagOf(head) + 1),
+                                          std::memory_order_acquire,
+                                          std::memory_order_acquire))
+      {
+        return node;
+      }
+    }
+    return allocate();
+  }
+
+  // node is not reachable by other threads
+  void put(Node* node)
+  {
+    uint64_t head = freeList_.load(std::memory_order_relaxed);
+    do
+    {
+      node->poolNext.store(pointerOf(head), std::memory_order_relaxed);
+    }
+    while (!freeList_.compare_exchange_weak(head, pack(node, tagOf(head) + 1),
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed));
+  }
+
+  // node has been unlinked, but other threads may still hold hazard pointers to it
+  void retire(Node* node)
+  {
+    pushRetired(node);
+    // 阈值是 record 数的两倍，每次 scan() 至少有一半节点可以复用
+    if (retiredCount_.fetch_add(1, std::memory_order_relaxed) + 1 >=
+        2 * HazardPointer::numRecords())
+    {
+      scan();
+    }
+  }
+
+ private:
+  static const int kTagShift = 48;
+  static const uint64_t kPointerMask = (1ull << kTagShift) - 1;
+
+  static uint64_t pack(Node* node, uint64_t tag)
+  {
+    return (reinterpret_cast<uint64_t>(node) & kPointerMask) | (tag << kTagShift);
+  }
+
+  static Node* pointerOf(uint64_t v) { return reinterpret_cast<Node*>(v & kPointerMask); }
+  static uint64_t tagOf(uint64_t v) { return v >> kTagShift; }
+
+  Node* allocate()
+  {
+    Node* node = new Node;
+    Node* head = all_.load(std::memory_order_relaxed);
+    do
+    {
+      node->poolAll = head;
+    }
+    while (!all_.compare_exchange_weak(head, node,
+                                       std::memory_order_release,
+                                       std::memory_order_relaxed));
+    return node;
+  }
+
+  // push-only Treiber stack, exchange() takes the whole list, no ABA
+  void pushRetired(Node* node)
+  {
+    Node* head = retired_.load(std::memory_order_relaxed);
+    do
+    {
+      node->poolNext.store(head, std::memory_order_relaxed);
+    }
+    while (!retired_.compare_exchange_weak(head, node,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed));
+  }
+
+  void scan()
+  {
+    retiredCount_.store(0, std::memory_order_relaxed);
+    Node* node = retired_.exchange(nullptr, std::memory_order_acquire);
+    if (node == nullptr)
+    {
+      return;
+    }
+    thread_local std::vector<const void*> hazards;
+    HazardPointer::collect(&hazards);
+    int kept = 0;
+    while (node)
+    {
+      Node* next = node->poolNext.load(std::memory_order_relaxed);
+      if (std::binary_search(hazards.begin(), hazards.end(), node))
+      {
+        pushRetired(node);
+        ++kept;
+      }
+      else
+      {
+        put(node);
+      }
+      node = next;
+    }
+    retiredCount_.fetch_add(kept, std::memory_order_relaxed);
+  }
+
+  std::atomic<uint64_t> freeList_;  // 16-bit tag | 48-bit pointer
+  std::atomic<Node*> retired_;
+  std::atomic<int> retiredCount_;
+  std::atomic<Node*> all_;
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_HAZARDPOINTER_H
@@ -0,0 +1,83 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include <muduo/base/Histogram.h>
+
+#include <algorithm>
+
+#include <stdio.h>
+
+using namespace muduo;
+
+Histogram::Histogram()
+  : count_(0),
+    sum_(0),
+    max_(0)
+{
+  for (auto& bucket : buckets_)
+  {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+int64_t Histogram::upperBoundOf(int bucket)
+{
+  if (bucket < kSubBuckets)
+  {
+    return bucket;
+  }
+  int exponent = (bucket - kSubBuckets) / kSubBuckets + 3;
+  int64_t sub = (bucket - kSubBuckets) % kSubBuckets;
+  int64_t lower = (kSubBuckets + sub) << (exponent - 3);
+  return lower + (int64_t(1) << (exponent - 3)) - 1;
+}
+
+int64_t Histogram::percentile(double p) const
+{
+  int64_t total = count();
+  if (total == 0)
+  {
+    return 0;
+  }
+  int64_t rank = static_cast<int64_t>(static_cast<double>(total) * p / 100.0 + 0.5);
+  rank = std::max<int64_t>(rank, 1);
+  int64_t seen = 0;
+  for (int i = 0; i < kNumBuckets; ++i)
+  {
+    seen += buckets_[i].load(std::memory_order_relaxed);
+    if (seen >= rank)
+    {
+      return std::min(upperBoundOf(i), max());
+    }
+  }
+  return max();
+}
+
+void Histogram::reset()
+{
+  for (auto& bucket : buckets_)
+  {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+  count_.store(0, std::memory_order_relaxed);
+  sum_.store(0, std::memory_order_relaxed);
+  max_.store(0, std::memory_order_relaxed);
+}
+
+string Histogram::toString() const
+{
+  int64_t n = count();
+  char buf[256];
+  snprintf(buf, sizeof buf,
+           "count %lld mean %lld p50 %lld p90 %lld p99 %lld p999 %lld max %lld",
+           static_cast<long long>(n),
+           static_cast<long long>(n > 0 ? sum() / n : 0),
+           static_cast<long long>(percentile(50)),
+           static_cast<long long>(percentile(90)),
+           static_cast<long long>(percentile(99)),
+           static_cast<long long>(percentile(99.9)),
+           static_cast<long long>(max()));
+  return buf;
+}
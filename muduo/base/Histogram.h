@@ -0,0 +1,82 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_HISTOGRAM_H
+#define MUDUO_BASE_HISTOGRAM_H
+
+#include <muduo/base/noncopyable.h>
+#include <muduo/base/Types.h>
+
+#include <atomic>
+
+#include <stdint.h>
+
+namespace muduo
+{
+
+// 对数分桶的直方图，用于统计延迟等非负整数（例如微秒）。
+// 每个 2 的幂区间分成 8 个桶，相对误差不超过 12.5%；
+// add() 只有一次 relaxed 原子加，可以在多个线程中并发调用。
+class Histogram : noncopyable
+{
+ public:
+  static const int kSubBuckets = 8;
+  static const int kMaxExponent = 40;  // 2^40 us ~ 12 days
+  static const int kNumBuckets = kSubBuckets + (kMaxExponent - 3) * kSubBuckets;
+
+  Histogram();
+
+  void add(int64_t value)
+  {
+    buckets_[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+    int64_t max = max_.load(std::memory_order_relaxed);
+    while (value > max &&
+           !max_.compare_exchange_weak(max, value, std::memory_order_relaxed))
+    {
+    }
+  }
+
+  int64_t count() const { return count_.load(std::memory_order_relaxed); }
+  int64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+  int64_t max() const { return max_.load(std::memory_order_relaxed); }
+
+  // p in [0, 100], returns upper bound of the bucket
+  int64_t percentile(double p) const;
+
+  // not atomic with respect to concurrent add()
+  void reset();
+
+  // "count 10 mean 12 p50 8 p90 20 p99 31 p999 31 max 31"
+  string toString() const;
+
+  static int bucketOf(int64_t value)
+  {
+    if (value < kSubBuckets)
+    {
+      return value < 0 ? 0 : static_cast<int>(value);
+    }
+    int exponent = 63 - __builtin_clzll(static_cast<uint64_t>(value));
+    if (exponent >= kMaxExponent)
+    {
+      return kNumBuckets - 1;
+    }
+    int sub = static_cast<int>(value >> (exponent - 3)) & (kSubBuckets - 1);
+    return kSubBuckets + (exponent - 3) * kSubBuckets + sub;
+  }
+
+  static int64_t upperBoundOf(int bucket);
+
+ private:
+  std::atomic<int64_t> buckets_[kNumBuckets];
+  std::atomic<int64_t> count_;
+  std::atomic<int64_t> sum_;
+  std::atomic<int64_t> max_;
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_HISTOGRAM_H
@@ -0,0 +1,246 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_INPLACEFUNCTION_H
+#define MUDUO_BASE_INPLACEFUNCTION_H
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace muduo
+{
+
+template<typename Signature, size_t Capacity = 64>
+class InplaceFunction;
+
+// 只能移动的 std::function 替代品，用于 ThreadPool::Task 和 EventLoop::Functor。
+// 不超过 Capacity 字节、且 nothrow move 的可调用对象直接存放在对象内部，
+// 不分配内存；更大的对象退化为堆上分配。
+// 因为不要求可复制，lambda 可以捕获 std::unique_ptr 等只能移动的对象。
+template<typename R, typename... Args, size_t Capacity>
+class InplaceFunction<R(Args...), Capacity>
+{
+ public:
+  InplaceFunction() noexcept
+    : ops_(nullptr)
+  {
+  }
+
+  InplaceFunction(std::nullptr_t) noexcept
+    : ops_(nullptr)
+  {
+  }
+
+  template<typename F,
+           typename Fn = typename std::decay<F>::type,
+           typename = typename std::enable_if<
+             !std::is_same<Fn, InplaceFunction>::value &&
+             std::is_invocable_r<R, Fn&, Args...>::value>::type>
+  InplaceFunction(F&& f)
+    : ops_(nullptr)
+  {
+    if (isNull(f))
+    {
+      return;
+    }
+    if constexpr (fitsInline<Fn>())
+    {
+      new (&storage_) Fn(std::forward<F>(f));
+      ops_ = &InlineOps<Fn>::kOps;
+    }
+    else
+    {
+      *reinterpret_cast<Fn**>(&storage_) = new Fn(std::forward<F>(f));
+      ops_ = &HeapOps<Fn>::kOps;
+    }
+  }
+
+  InplaceFunction(InplaceFunction&& rhs) noexcept
+    : ops_(rhs.ops_)
+  {
+    if (ops_)
+    {
+      ops_->move(&storage_, &rhs.storage_);
+      rhs.ops_ = nullptr;
+    }
+  }
+
+  ~InplaceFunction()
+  {
+    reset();
+  }
+
+  InplaceFunction& operator=(InplaceFunction&& rhs) noexcept
+  {
+    if (this != &rhs)
+    {
+      reset();
+      if (rhs.ops_)
+      {
+        rhs.ops_->move(&storage_, &rhs.storage_);
+        ops_ = rhs.ops_;
+        rhs.ops_ = nullptr;
+      }
+    }
+    return *this;
+  }
+
+  InplaceFunction& operator=(std::nullptr_t) noexcept
+  {
+    reset();
+    return *this;
+  }
+
+  template<typename F,
+           typename = typename std::enable_if<
+             !std::is_same<typename std::decay<F>::type, InplaceFunction>::value>::type>
+  InplaceFunction& operator=(F&& f)
+  {
+    return *this = InplaceFunction(std::forward<F>(f));
+  }
+
+  InplaceFunction(const InplaceFunction&) = delete;
+  InplaceFunction& operator=(const InplaceFunction&) = delete;
+
+  // 与 std::function 一样，const 对象也可以调用非 const 的 operator()
+  R operator()(Args... args) const
+  {
+    if (ops_ == nullptr)
+    {
+      throw std::bad_function_call();
+    }
+    return ops_->invoke(const_cast<Storage*>(&storage_), std::forward<Args>(args)...);
+  }
+
+  explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+  // false if empty or heap allocated
+  bool isInline() const noexcept { return ops_ != nullptr && ops_->isInline; }
+
+  void swap(InplaceFunction& rhs) noexcept
+  {
+    InplaceFunction tmp(std::move(rhs));
+    rhs = std::move(*this);
+    *this = std::move(tmp);
+  }
+
+ private:
+  typedef typename std::aligned_storage<Capacity, alignof(std::max_align_t)>::type Storage;
+
+  struct Ops
+  {
+    R (*invoke)(void* storage, Args&&... args);
+    void (*move)(void* dst, void* src) noexcept;  // also destroys src
+    void (*destroy)(void* storage) noexcept;
+    bool isInline;
+  };
+
+  template<typename Fn>
+  static constexpr bool fitsInline()
+  {
+    return sizeof(Fn) <= sizeof(Storage) &&
+           alignof(Storage) % alignof(Fn) == 0 &&
+           std::is_nothrow_move_constructible<Fn>::value;
+  }
+
+  template<typename Fn>
+  static R call(Fn& fn, Args&&... args)
+  {
+    if constexpr (std::is_void<R>::value)
+    {
+      std::invoke(fn, std::forward<Args>(args)...);
+    }
+    else
+    {
+      return std::invoke(fn, std::forward<Args>(args)...);
+    }
+  }
+
+  template<typename Fn>
+  struct InlineOps
+  {
+    static Fn* get(void* p) { return std::launder(static_cast<Fn*>(p)); }
+
+    static R invoke(void* p, Args&&... args)
+    {
+      return call(*get(p), std::forward<Args>(args)...);
+    }
+
+    static void move(void* dst, void* src) noexcept
+    {
+      Fn* fn = get(src);
+      new (dst) Fn(std::move(*fn));
+      fn->~Fn();
+    }
+
+    static void destroy(void* p) noexcept
+    {
+      get(p)->~Fn();
+    }
+
+    static constexpr Ops kOps = { &invoke, &move, &destroy, true };
+  };
+
+  template<typename Fn>
+  struct HeapOps
+  {
+    static Fn*& get(void* p) { return *static_cast<Fn**>(p); }
+
+    static R invoke(void* p, Args&&... args)
+    {
+      return call(*get(p), std::forward<Args>(args)...);
+    }
+
+    static void move(void* dst, void* src) noexcept
+    {
+      *static_cast<Fn**>(dst) = get(src);
+    }
+
+    static void destroy(void* p) noexcept
+    {
+      delete get(p);
+    }
+
+    static constexpr Ops kOps = { &invoke, &move, &destroy, false };
+  };
+
+  template<typename F>
+  static bool isNull(const F& f)
+  {
+    if constexpr (std::is_pointer<F>::value || std::is_member_pointer<F>::value)
+    {
+      return f == nullptr;
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+  template<typename Sig>
+  static bool isNull(const std::function<Sig>& f)
+  {
+    return !f;
+  }
+
+  void reset() noexcept
+  {
+    if (ops_)
+    {
+      ops_->destroy(&storage_);
+      ops_ = nullptr;
+    }
+  }
+
+  Storage storage_;
+  const Ops* ops_;
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_INPLACEFUNCTION_H
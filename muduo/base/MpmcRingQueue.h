@@ -0,0 +1,274 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_MPMCRINGQUEUE_H
+#define MUDUO_BASE_MPMCRINGQUEUE_H
+
+#include <muduo/base/Condition.h>
+#include <muduo/base/Mutex.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+#include <stdint.h>
+
+namespace muduo
+{
+
+// 有界多生产者多消费者无锁环形队列，算法来自 Dmitry Vyukov 的 bounded MPMC queue：
+// 每个 cell 带一个序号，生产者/消费者各自用 CAS 推进 enqueuePos_/dequeuePos_，
+// 通过比较 cell 的序号判断 cell 是空还是满，不需要锁。
+//
+// tryPut()/tryTake() 永不阻塞；put()/take() 在队列满/空时先重试，
+// 然后在 Condition 上睡眠（futex），只有存在睡眠者时对端才会去拿锁 notify。
+template<typename T>
+class MpmcRingQueue : noncopyable
+{
+ public:
+  static const size_t kDefaultCapacity = 65536;
+
+  // capacity is rounded up to power of 2
+  explicit MpmcRingQueue(size_t capacity = kDefaultCapacity)
+    : capacity_(roundUp(capacity)),
+      mask_(capacity_ - 1),
+      cells_(new Cell[capacity_]),
+      enqueuePos_(0),
+      dequeuePos_(0),
+      running_(true),
+      waitingProducers_(0),
+      waitingConsumers_(0)
+  {
+    for (size_t i = 0; i < capacity_; ++i)
+    {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  ~MpmcRingQueue()
+  {
+    T x = T();
+    while (tryTake(&x))
+    {
+    }
+  }
+
+  // returns false if full
+  template<typename U>
+  bool tryPut(U&& x)
+  {
+    Cell* cell;
+    size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0)
+      {
+        if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      }
+      else if (diff < 0)
+      {
+        return false;  // full
+      }
+      else
+      {
+        pos = enqueuePos_.load(std::memory_order_relaxed);
+      }
+    }
+    new (&cell->storage) T(std::forward<U>(x));
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    wakeUp(&waitingConsumers_, &notEmpty_);
+    return true;
+  }
+
+  // returns false if empty
+  bool tryTake(T* x)
+  {
+    Cell* cell;
+    size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0)
+      {
+        if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      }
+      else if (diff < 0)
+      {
+        return false;  // empty
+      }
+      else
+      {
+        pos = dequeuePos_.load(std::memory_order_relaxed);
+      }
+    }
+    T* elem = cell->get();
+    *x = std::move(*elem);
+    elem->~T();
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    wakeUp(&waitingProducers_, &notFull_);
+    return true;
+  }
+
+  // blocks while full, returns false if stopped
+  template<typename U>
+  bool put(U&& x)
+  {
+    while (running_.load(std::memory_order_relaxed))
+    {
+      if (tryPut(std::forward<U>(x)))
+      {
+        return true;
+      }
+      // tryPut() 失败时不会移走 x，可以放心重试
+      MutexLockGuard lock(mutex_);
+      waitingProducers_.fetch_add(1);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (!full() || !running_)
+      {
+        waitingProducers_.fetch_sub(1);
+        continue;
+      }
+      notFull_.wait(lock);
+      waitingProducers_.fetch_sub(1);
+    }
+    return false;
+  }
+
+  // blocks while empty, returns false if stopped
+  bool take(T* x)
+  {
+    while (running_.load(std::memory_order_relaxed))
+    {
+      if (tryTake(x))
+      {
+        return true;
+      }
+      MutexLockGuard lock(mutex_);
+      waitingConsumers_.fetch_add(1);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (!empty() || !running_)
+      {
+        waitingConsumers_.fetch_sub(1);
+        continue;
+      }
+      notEmpty_.wait(lock);
+      waitingConsumers_.fetch_sub(1);
+    }
+    return false;
+  }
+
+  // blocks at most seconds while empty, returns false if timeout or stopped
+  bool take(T* x, double seconds)
+  {
+    if (tryTake(x))
+    {
+      return true;
+    }
+    MutexLockGuard lock(mutex_);
+    waitingConsumers_.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    notEmpty_.waitForSeconds(lock, seconds, [this] { return !empty() || !running_; });
+    waitingConsumers_.fetch_sub(1);
+    return running_ && tryTake(x);
+  }
+
+  T take()
+  {
+    T x = T();
+    take(&x);
+    return x;
+  }
+
+  void stop()
+  {
+    running_ = false;
+    MutexLockGuard lock(mutex_);
+    notEmpty_.notifyAll();
+    notFull_.notifyAll();
+  }
+
+  // approximate, may be stale as soon as it returns
+  size_t size() const
+  {
+    size_t dequeue = dequeuePos_.load(std::memory_order_relaxed);
+    size_t enqueue = enqueuePos_.load(std::memory_order_relaxed);
+    return enqueue > dequeue ? std::min(enqueue - dequeue, capacity_) : 0;
+  }
+
+  size_t capacity() const { return capacity_; }
+
+ private:
+  static const size_t kCacheLineSize = 64;
+
+  struct Cell
+  {
+    std::atomic<size_t> sequence;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+    T* get() { return std::launder(reinterpret_cast<T*>(&storage)); }
+  };
+
+  static size_t roundUp(size_t n)
+  {
+    size_t cap = 2;
+    while (cap < n)
+    {
+      cap <<= 1;
+    }
+    return cap;
+  }
+
+  bool full() const
+  {
+    size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    size_t seq = cells_[pos & mask_].sequence.load(std::memory_order_acquire);
+    return static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos) < 0;
+  }
+
+  bool empty() const
+  {
+    size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+    size_t seq = cells_[pos & mask_].sequence.load(std::memory_order_acquire);
+    return static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1) < 0;
+  }
+
+  // 与 put()/take() 中的 fence 配对，保证不会丢失唤醒
+  void wakeUp(std::atomic<int>* waiters, Condition* cond)
+  {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters->load(std::memory_order_relaxed) > 0)
+    {
+      MutexLockGuard lock(mutex_);
+      cond->notify();
+    }
+  }
+
+  const size_t capacity_;
+  const size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+
+  // 生产者和消费者的位置放在不同的 cache line，避免 false sharing
+  alignas(kCacheLineSize) std::atomic<size_t> enqueuePos_;
+  alignas(kCacheLineSize) std::atomic<size_t> dequeuePos_;
+  alignas(kCacheLineSize) std::atomic<bool> running_;
+  std::atomic<int> waitingProducers_;
+  std::atomic<int> waitingConsumers_;
+  MutexLock mutex_;
+  Condition notEmpty_ GUARDED_BY(mutex_);
+  Condition notFull_ GUARDED_BY(mutex_);
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_MPMCRINGQUEUE_H
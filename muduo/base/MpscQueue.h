@@ -0,0 +1,86 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_MPSCQUEUE_H
+#define MUDUO_BASE_MPSCQUEUE_H
+
+#include <muduo/base/noncopyable.h>
+
+#include <atomic>
+
+namespace muduo
+{
+
+// 侵入式多生产者单消费者队列（Dmitry Vyukov 的 intrusive MPSC node-based queue）。
+// Node 必须有成员 std::atomic<Node*> mpscNext，并且可以默认构造（用作哨兵）。
+//
+// push() 是 wait-free 的：一次 exchange 加一次 store，可以在任意线程调用；
+// pop() 只能在一个线程调用。节点的内存由调用者管理。
+//
+// 生产者在 exchange 和 store 之间被抢占时，链表暂时是断开的，
+// 这时 pop() 返回 nullptr，哪怕队列里还有更早放入的节点；
+// 调用者要有办法在 push() 完成之后再次 pop()，例如 push 之后再唤醒消费者。
+template<typename Node>
+class MpscQueue : noncopyable
+{
+ public:
+  MpscQueue()
+    : head_(&stub_),
+      tail_(&stub_)
+  {
+    stub_.mpscNext.store(nullptr, std::memory_order_relaxed);
+  }
+
+  void push(Node* node)
+  {
+    node->mpscNext.store(nullptr, std::memory_order_relaxed);
+    Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+    prev->mpscNext.store(node, std::memory_order_release);
+  }
+
+  // returns nullptr if empty or a push is in progress
+  Node* pop()
+  {
+    Node* tail = tail_;
+    Node* next = tail->mpscNext.load(std::memory_order_acquire);
+    if (tail == &stub_)
+    {
+      if (next == nullptr)
+      {
+        return nullptr;
+      }
+      tail_ = next;
+      tail = next;
+      next = next->mpscNext.load(std::memory_order_acquire);
+    }
+    if (next != nullptr)
+    {
+      tail_ = next;
+      return tail;
+    }
+    if (tail != head_.load(std::memory_order_acquire))
+    {
+      return nullptr;
+    }
+    // tail 是最后一个节点，放回哨兵之后才能把它取出
+    push(&stub_);
+    next = tail->mpscNext.load(std::memory_order_acquire);
+    if (next != nullptr)
+    {
+      tail_ = next;
+      return tail;
+    }
+    return nullptr;
+  }
+
+ private:
+  alignas(64) std::atomic<Node*> head_;  // 生产者一端
+  alignas(64) Node* tail_;               // 消费者一端
+  Node stub_;
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_MPSCQUEUE_H
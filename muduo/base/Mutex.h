@@ -202,6 +202,19 @@ class SCOPED_CAPABILITY MutexLockGuard : noncopyable
 
   std::unique_lock<std::mutex>& getUniqueLock() { return lck_; }
 
+  // 临时放开锁，例如在 Condition::wait 中自旋等待，之后必须再 lock()
+  void unlock() RELEASE()
+  {
+    mutex_.unassignHolder();
+    lck_.unlock();
+  }
+
+  void lock() ACQUIRE()
+  {
+    lck_.lock();
+    mutex_.assignHolder();
+  }
+
  private:
 
   MutexLock& mutex_;
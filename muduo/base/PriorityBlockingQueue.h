@@ -0,0 +1,160 @@
+#ifndef MUDUO_BASE_PRIORITYBLOCKINGQUEUE_H
+#define MUDUO_BASE_PRIORITYBLOCKINGQUEUE_H
+
+#include <muduo/base/Condition.h>
+#include <muduo/base/Mutex.h>
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+namespace muduo
+{
+
+// 与 BlockingQueueForThreadPool 接口相同，但 take() 总是取出最大的元素（按 Compare）。
+// 相同优先级的元素没有先后保证，需要 FIFO 的话由 T 自己在比较中加上序号。
+template <typename T, typename Compare = std::less<T>>
+class PriorityBlockingQueue : noncopyable
+{
+public:
+  PriorityBlockingQueue(int maxsize = 0)
+      : mutex_(), notFull_(), notEmpty_(), maxSize_(maxsize), running_(true) {}
+  ~PriorityBlockingQueue() = default;
+
+  template<typename U>
+  void put(U &&x)
+  {
+    MutexLockGuard lock(mutex_);
+    if (maxSize_ != 0)
+    {
+      while (heap_.size() >= maxSize_ && running_)
+      {
+        notFull_.wait(lock);
+      }
+    }
+
+    if (!running_)
+      return;
+    push(std::forward<U>(x));
+    notEmpty_.notify();
+  }
+
+  void putBatch(std::vector<T> &xs)
+  {
+    MutexLockGuard lock(mutex_);
+    size_t added = 0;
+    for (T &x : xs)
+    {
+      if (maxSize_ != 0)
+      {
+        while (heap_.size() >= maxSize_ && running_)
+        {
+          notifyTakers(heap_.size());
+          notFull_.wait(lock);
+        }
+      }
+      if (!running_)
+        break;
+      push(std::move(x));
+      ++added;
+    }
+    notifyTakers(added);
+  }
+
+  // returns false if full or stopped, x is left untouched
+  template<typename U>
+  bool tryPut(U &&x)
+  {
+    MutexLockGuard lock(mutex_);
+    if (!running_ || (maxSize_ != 0 && heap_.size() >= maxSize_))
+      return false;
+    push(std::forward<U>(x));
+    notEmpty_.notify();
+    return true;
+  }
+
+  // Return a default-constructed T object if the queue is not running
+  T take()
+  {
+    MutexLockGuard lock(mutex_);
+    ++takers_;
+    while (heap_.empty() && running_)
+    {
+      notEmpty_.wait(lock);
+    }
+    --takers_;
+    if (!running_)
+      return T();
+    std::pop_heap(heap_.begin(), heap_.end(), compare_);
+    T top(std::move(heap_.back()));
+    heap_.pop_back();
+    notFull_.notify();
+    return top;
+  }
+
+  // returns false if timeout or stopped
+  bool take(T *x, double seconds)
+  {
+    MutexLockGuard lock(mutex_);
+    ++takers_;
+    notEmpty_.waitForSeconds(lock, seconds, [this] { return !heap_.empty() || !running_; });
+    --takers_;
+    if (!running_ || heap_.empty())
+      return false;
+    std::pop_heap(heap_.begin(), heap_.end(), compare_);
+    *x = std::move(heap_.back());
+    heap_.pop_back();
+    notFull_.notify();
+    return true;
+  }
+
+  size_t size() const
+  {
+    MutexLockGuard lock(mutex_);
+    return heap_.size();
+  }
+
+  void setMaxSize(size_t maxSize)
+  {
+    MutexLockGuard lock(mutex_);
+    maxSize_ = maxSize;
+  }
+
+  void stop() NO_THREAD_SAFETY_ANALYSIS
+  {
+    {
+      MutexLockGuard lock(mutex_);
+      running_ = false;
+    }
+    notFull_.notifyAll();
+    notEmpty_.notifyAll();
+  }
+
+private:
+  // 每个新元素最多唤醒一个消费者
+  void notifyTakers(size_t n) REQUIRES(mutex_)
+  {
+    for (size_t i = std::min(n, takers_); i > 0; --i)
+      notEmpty_.notify();
+  }
+
+  template<typename U>
+  void push(U &&x) REQUIRES(mutex_)
+  {
+    heap_.push_back(std::forward<U>(x));
+    std::push_heap(heap_.begin(), heap_.end(), compare_);
+  }
+
+  std::vector<T> heap_ GUARDED_BY(mutex_);
+  Compare compare_;
+  mutable MutexLock mutex_;
+  Condition notFull_ GUARDED_BY(mutex_);
+  Condition notEmpty_ GUARDED_BY(mutex_);
+  size_t maxSize_; // 0 means no limit
+  bool running_;
+  size_t takers_ = 0;  // 正在 take() 中等待的线程数
+};
+
+} // namespace muduo
+
+#endif  // MUDUO_BASE_PRIORITYBLOCKINGQUEUE_H
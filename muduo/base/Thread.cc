@@ -3,6 +3,7 @@
 //
 // Author: Shuo Chen (chenshuo at chenshuo dot com)
 
+#include <muduo/base/CpuAffinity.h>
 #include <muduo/base/Exception.h>
 #include <muduo/base/Logging.h>
 #include <muduo/base/Thread.h>
@@ -69,6 +70,11 @@ void Thread::runInThread()
   // 为当前线程命名，threadName 的长度
   // 不得超过 16 bytes。当名字长度超过 16 个字节时会默认截断
   ::prctl(PR_SET_NAME, muduo::CurrentThread::t_threadName);
+  // 绑核失败只记日志，线程照常运行
+  if (CpuAffinity::bindCurrentThread(cpus_) && localAlloc_)
+  {
+    CpuAffinity::setLocalMemoryPolicy();
+  }
   try
   {
     func_();
@@ -101,6 +107,19 @@ Thread::Thread(ThreadFunc func, const std::string &name)
     : func_(std::move(func)),
       name_(name),
       tid_(0),
+      localAlloc_(false),
+      thread_(std::bind(&Thread::runInThread, this))
+{
+  ++numCreated_;
+}
+
+Thread::Thread(ThreadFunc func, const std::string &name,
+               std::vector<int> cpus, bool localAlloc)
+    : func_(std::move(func)),
+      name_(name),
+      tid_(0),
+      cpus_(std::move(cpus)),
+      localAlloc_(localAlloc),
       thread_(std::bind(&Thread::runInThread, this))
 {
   ++numCreated_;
@@ -13,6 +13,7 @@
 #include <functional>
 #include <memory>
 #include <thread>
+#include <vector>
 
 namespace muduo
 {
@@ -22,12 +23,17 @@ class Thread : noncopyable {
  public:
   using ThreadFunc = std::function<void()>;
   explicit Thread(ThreadFunc func, const std::string& name = std::string());
+  // 线程启动后、调用 func 之前绑定到 cpus 上（见 CpuAffinity），
+  // localAlloc 为 true 时之后的内存都从本地 NUMA node 分配
+  Thread(ThreadFunc func, const std::string& name,
+         std::vector<int> cpus, bool localAlloc = false);
   ~Thread();
   Thread(Thread&& rhs) noexcept;
   Thread& operator=(Thread&& rhs) noexcept;
   void join();
   const string& name() const { return name_; }
   pid_t tid() const { return tid_; }
+  const std::vector<int>& cpus() const { return cpus_; }
   static inline int numCreated() { return numCreated_.load(); }
 
  private:
@@ -36,6 +42,8 @@ class Thread : noncopyable {
   ThreadFunc func_;
   string     name_;
   pid_t      tid_;
+  std::vector<int> cpus_;
+  bool       localAlloc_;
   //线程实体
   std::thread thread_;
   void runInThread();
@@ -7,15 +7,49 @@
 
 #include <muduo/base/Exception.h>
 
+#include <algorithm>
+
 #include <assert.h>
+#include <stdint.h>
 #include <stdio.h>
 
 using namespace muduo;
 
+namespace
+{
+// 当前线程所属的线程池及其 worker 下标，用于把 worker 提交的任务放进自己的 deque
+thread_local ThreadPool* t_pool = nullptr;
+thread_local size_t t_workerIndex = 0;
+}  // namespace
+
 ThreadPool::ThreadPool(const string& nameArg)
   : name_(nameArg),
     queue_(),
-    running_(false)
+    running_(false),
+    mode_(kSharedQueue),
+    maxQueueSize_(0),
+    pending_(0),
+    idle_(0),
+    next_(0),
+    admission_(kAdmitAll),
+    codelTarget_(5000),
+    codelInterval_(100 * 1000),
+    minDelay_(INT64_MAX),
+    intervalEnd_(0),
+    overloaded_(false),
+    sequence_(0),
+    droppedExpired_(0),
+    droppedOverloaded_(0),
+    rejected_(0),
+    elastic_(false),
+    minThreads_(0),
+    maxThreads_(0),
+    spawnDelay_(0),
+    idleTimeout_(0),
+    numThreads_(0),
+    idleWorkers_(0),
+    lastDequeue_(0),
+    lastSojourn_(0)
 {
 }
 
@@ -30,14 +64,39 @@ ThreadPool::~ThreadPool()
 void ThreadPool::start(int numThreads)
 {
   assert(threads_.empty() && numThreads >= 0);
+  assert(!elastic_ || mode_ == kSharedQueue);
+  if (elastic_)
+  {
+    numThreads = std::min(std::max(numThreads, minThreads_), maxThreads_);
+  }
   running_ = true;
-  threads_.reserve(numThreads);
+  if (mode_ == kWorkStealing && numThreads > 0)
+  {
+    deques_.reserve(numThreads);
+    for (int i = 0; i < numThreads; ++i)
+    {
+      deques_.emplace_back(new WorkStealingDeque<Entry>);
+    }
+    // tasks submitted before start()
+    while (queue_.size() > 0)
+    {
+      put(queue_.take());
+    }
+  }
+  threads_.reserve(elastic_ ? maxThreads_ : numThreads);
   for (int i = 0; i < numThreads; ++i)
   {
     char id[32];
     snprintf(id, sizeof id, "%d", i+1);
     threads_.emplace_back(new muduo::Thread(
-          std::bind(&ThreadPool::runInThread, this), name_+id));
+          std::bind(&ThreadPool::runInThread, this, i), name_+id,
+          affinity_.cpusFor(i), affinity_.localAlloc()));
+  }
+  numThreads_ = numThreads;
+  if (elastic_)
+  {
+    monitor_.reset(new muduo::Thread(
+          std::bind(&ThreadPool::runMonitor, this), name_+"Monitor"));
   }
   if (numThreads == 0 && threadInitCallback_)
   {
@@ -49,43 +108,554 @@ void ThreadPool::stop()
 {
   running_ = false;
   queue_.stop();
+  {
+    MutexLockGuard lock(mutex_);
+    notEmpty_.notifyAll();
+    notFull_.notifyAll();
+  }
+  if (monitor_)
+  {
+    {
+      MutexLockGuard lock(elasticMutex_);
+      monitorCond_.notifyAll();
+    }
+    monitor_->join();
+  }
   for (auto& thr : threads_)
   {
-    thr->join();
+    if (thr)
+    {
+      thr->join();
+    }
   }
 }
 
+void ThreadPool::setElastic(int minThreads, int maxThreads,
+                            double spawnDelaySeconds,
+                            double idleTimeoutSeconds)
+{
+  assert(0 < minThreads && minThreads <= maxThreads);
+  elastic_ = true;
+  minThreads_ = minThreads;
+  maxThreads_ = maxThreads;
+  spawnDelay_ = static_cast<int64_t>(spawnDelaySeconds * Timestamp::kMicroSecondsPerSecond);
+  idleTimeout_ = idleTimeoutSeconds;
+}
+
+void ThreadPool::runMonitor()
+{
+  const double spawnDelay = static_cast<double>(spawnDelay_) / Timestamp::kMicroSecondsPerSecond;
+  const double tick = std::max(0.001, std::min(spawnDelay, idleTimeout_) / 2);
+  bool waiting = false;  // 连续两次检查都有任务在等才扩容，避免对瞬时突发过度反应
+  MutexLockGuard lock(elasticMutex_);
+  while (running_)
+  {
+    monitorCond_.waitForSeconds(lock, tick);
+    for (size_t index : exited_)
+    {
+      threads_[index]->join();
+      threads_[index].reset();
+    }
+    exited_.clear();
+    if (!running_)
+    {
+      break;
+    }
+
+    bool starved = false;
+    if (numThreads_ < maxThreads_ && idleWorkers_ == 0 && queue_.size() > 0)
+    {
+      int64_t now = Timestamp::now().microSecondsSinceEpoch();
+      starved = lastSojourn_ > spawnDelay_ || now - lastDequeue_ > spawnDelay_;
+    }
+    if (starved && waiting)
+    {
+      spawnThread();
+      starved = false;
+    }
+    waiting = starved;
+  }
+}
+
+void ThreadPool::spawnThread()
+{
+  size_t index = 0;
+  while (index < threads_.size() && threads_[index])
+  {
+    ++index;
+  }
+  if (index == threads_.size())
+  {
+    threads_.emplace_back();
+  }
+  char id[32];
+  snprintf(id, sizeof id, "%zu", index+1);
+  ++numThreads_;
+  threads_[index].reset(new muduo::Thread(
+        std::bind(&ThreadPool::runInThread, this, index), name_+id,
+        affinity_.cpusFor(static_cast<int>(index)), affinity_.localAlloc()));
+}
+
+bool ThreadPool::retire(size_t index)
+{
+  MutexLockGuard lock(elasticMutex_);
+  if (numThreads_ > minThreads_)
+  {
+    --numThreads_;
+    exited_.push_back(index);
+    return true;
+  }
+  return false;
+}
+
 size_t ThreadPool::queueSize() const
 {
+  if (!deques_.empty())
+  {
+    return pending_.load();
+  }
   return queue_.size();
 }
 
+void ThreadPool::setAdmission(Admission admission,
+                              double targetSeconds,
+                              double intervalSeconds)
+{
+  admission_ = admission;
+  codelTarget_ = static_cast<int64_t>(targetSeconds * Timestamp::kMicroSecondsPerSecond);
+  codelInterval_ = static_cast<int64_t>(intervalSeconds * Timestamp::kMicroSecondsPerSecond);
+}
+
 void ThreadPool::run(Task &&task) 
 {
-  queue_.put(std::forward<Task>(task));
+  enqueue(makeEntry(std::move(task)));
 }
 
-void ThreadPool::runInThread()
+bool ThreadPool::run(Task&& task, TaskOptions&& options)
 {
-  try
+  Entry entry(makeEntry(std::move(task)));
+  if (entry.enqueueTime != 0 && !admit(entry.enqueueTime))
   {
-    if (threadInitCallback_)
+    ++rejected_;
+    return false;
+  }
+  entry.schedule.reset(new Schedule);
+  entry.schedule->onDrop = std::move(options.onDrop);
+  entry.schedule->deadline = options.deadline.microSecondsSinceEpoch();
+  entry.schedule->priority = options.priority;
+  enqueue(std::move(entry));
+  return true;
+}
+
+ThreadPool::Entry ThreadPool::makeEntry(Task&& task)
+{
+  Entry entry;
+  entry.task = std::move(task);
+  if (measureDelay())
+  {
+    entry.enqueueTime = Timestamp::now().microSecondsSinceEpoch();
+  }
+  if (queue_.backend() == SyncQueueBase::kPriorityQueue)
+  {
+    entry.sequence = sequence_.fetch_add(1, std::memory_order_relaxed);
+  }
+  return entry;
+}
+
+bool ThreadPool::admit(int64_t now)
+{
+  // 过载状态在出队时更新；如果很久没有出队（例如全部被拒绝），状态已经过期
+  return !overloaded_.load(std::memory_order_relaxed) ||
+         now > intervalEnd_.load(std::memory_order_relaxed) + codelInterval_;
+}
+
+void ThreadPool::enqueue(Entry&& entry)
+{
+  if (!deques_.empty())
+  {
+    put(std::move(entry));
+  }
+  else if (t_pool == this)
+  {
+    // worker 在队列满时不能阻塞等待自己，直接在当前线程执行
+    if (!queue_.tryPut(std::move(entry)) && running_)
     {
-      threadInitCallback_();
+      runEntry(entry);
+    }
+  }
+  else
+  {
+    queue_.put(std::move(entry));
+  }
+}
+
+void ThreadPool::runEntry(Entry& entry)
+{
+  const int64_t deadline = entry.schedule ? entry.schedule->deadline : 0;
+  if (entry.enqueueTime == 0 && deadline == 0)
+  {
+    entry.task();
+    return;
+  }
+
+  int64_t now = Timestamp::now().microSecondsSinceEpoch();
+  if (entry.enqueueTime != 0)
+  {
+    int64_t sojourn = now - entry.enqueueTime;
+    queueDelay_.add(sojourn);
+    if (elastic_)
+    {
+      lastDequeue_.store(now, std::memory_order_relaxed);
+      lastSojourn_.store(sojourn, std::memory_order_relaxed);
+    }
+    if (admission_ == kCoDel)
+    {
+      updateCoDel(now, sojourn);
+      if (overloaded_.load(std::memory_order_relaxed) && sojourn > 2 * codelTarget_)
+      {
+        drop(entry, kOverloaded);
+        return;
+      }
+    }
+  }
+  if (deadline != 0 && now > deadline)
+  {
+    drop(entry, kExpired);
+    return;
+  }
+  entry.task();
+}
+
+void ThreadPool::drop(Entry& entry, DropReason reason)
+{
+  if (reason == kExpired)
+  {
+    ++droppedExpired_;
+  }
+  else
+  {
+    ++droppedOverloaded_;
+  }
+  if (entry.schedule && entry.schedule->onDrop)
+  {
+    entry.schedule->onDrop(reason);
+  }
+}
+
+void ThreadPool::updateCoDel(int64_t now, int64_t sojourn)
+{
+  int64_t minDelay = minDelay_.load(std::memory_order_relaxed);
+  while (sojourn < minDelay &&
+         !minDelay_.compare_exchange_weak(minDelay, sojourn, std::memory_order_relaxed))
+  {
+  }
+
+  int64_t end = intervalEnd_.load(std::memory_order_relaxed);
+  if (now >= end &&
+      intervalEnd_.compare_exchange_strong(end, now + codelInterval_, std::memory_order_relaxed))
+  {
+    // 一个 interval 结束，只有一个线程进行结算
+    int64_t observed = minDelay_.exchange(INT64_MAX, std::memory_order_relaxed);
+    overloaded_.store(observed > codelTarget_, std::memory_order_relaxed);
+  }
+}
+
+void ThreadPool::runBatch(std::vector<Task>&& tasks)
+{
+  if (tasks.empty())
+  {
+    return;
+  }
+  std::vector<Entry> entries;
+  entries.reserve(tasks.size());
+  for (Task& task : tasks)
+  {
+    entries.push_back(makeEntry(std::move(task)));
+  }
+  if (!deques_.empty())
+  {
+    putBatch(entries);
+  }
+  else if (t_pool == this)
+  {
+    // worker 不能阻塞，逐个 tryPut，放不下的就地执行
+    for (Entry& entry : entries)
+    {
+      enqueue(std::move(entry));
+    }
+  }
+  else
+  {
+    queue_.putBatch(entries);
+  }
+}
+
+namespace
+{
+
+struct ParallelForState : noncopyable
+{
+  ParallelForState(size_t chunks, const InplaceFunction<void(size_t)>* fn)
+    : next(0),
+      numChunks(chunks),
+      runChunk(fn),
+      done(0)
+  {
+  }
+
+  // 领取并执行 chunk，直到全部被领取
+  void work()
+  {
+    size_t finished = 0;
+    for (;;)
+    {
+      size_t c = next.fetch_add(1);
+      if (c >= numChunks)
+      {
+        break;
+      }
+      // 领到了 chunk 说明调用者还在等待，runChunk 仍然有效
+      try
+      {
+        (*runChunk)(c);
+      }
+      catch (...)
+      {
+        MutexLockGuard lock(mutex);
+        if (!exception)
+        {
+          exception = std::current_exception();
+        }
+      }
+      ++finished;
     }
-    while (running_)
+    if (finished > 0)
     {
-      Task task = queue_.take();
-      if (task)
+      MutexLockGuard lock(mutex);
+      done += finished;
+      if (done == numChunks)
       {
-        task();
+        cond.notifyAll();
       }
-      else
+    }
+  }
+
+  std::atomic<size_t> next;
+  const size_t numChunks;
+  const InplaceFunction<void(size_t)>* runChunk;
+  MutexLock mutex;
+  Condition cond GUARDED_BY(mutex);
+  size_t done GUARDED_BY(mutex);
+  std::exception_ptr exception GUARDED_BY(mutex);
+};
+
+}  // namespace
+
+void ThreadPool::parallelForChunks(size_t numChunks,
+                                   const InplaceFunction<void(size_t)>& runChunk)
+{
+  // helper 可能在 parallelFor 返回之后才被取出，所以状态放在堆上
+  auto state = std::make_shared<ParallelForState>(numChunks, &runChunk);
+  // threads_ 可能正被 monitor 线程修改，这里只读原子的 numThreads_
+  size_t numHelpers = std::min(static_cast<size_t>(numThreads_.load()), numChunks - 1);
+  if (numHelpers > 0)
+  {
+    std::vector<Task> helpers;
+    helpers.reserve(numHelpers);
+    for (size_t i = 0; i < numHelpers; ++i)
+    {
+      helpers.emplace_back([state] { state->work(); });
+    }
+    runBatch(std::move(helpers));
+  }
+
+  state->work();
+
+  MutexLockGuard lock(state->mutex);
+  while (state->done < numChunks)
+  {
+    state->cond.wait(lock);
+  }
+  if (state->exception)
+  {
+    std::rethrow_exception(state->exception);
+  }
+}
+
+void ThreadPool::put(Entry&& entry)
+{
+  const bool inWorker = (t_pool == this);
+  // worker 自己提交的任务不受 maxQueueSize_ 限制，否则所有 worker 都可能阻塞在这里
+  if (maxQueueSize_ > 0 && !inWorker)
+  {
+    MutexLockGuard lock(mutex_);
+    while (pending_.load() >= maxQueueSize_ && running_)
+    {
+      notFull_.wait(lock);
+    }
+  }
+  if (!running_)
+  {
+    return;
+  }
+  // 先占位再入队，worker 看到 pending_ > 0 时任务可能还没放进 deque，它会重试
+  ++pending_;
+  size_t index = inWorker ? t_workerIndex : next_.fetch_add(1) % deques_.size();
+  deques_[index]->push(std::move(entry));
+  if (idle_.load() > 0)
+  {
+    MutexLockGuard lock(mutex_);
+    notEmpty_.notify();
+  }
+}
+
+void ThreadPool::putBatch(std::vector<Entry>& entries)
+{
+  const bool inWorker = (t_pool == this);
+  if (maxQueueSize_ > 0 && !inWorker)
+  {
+    MutexLockGuard lock(mutex_);
+    while (pending_.load() >= maxQueueSize_ && running_)
+    {
+      notFull_.wait(lock);
+    }
+  }
+  if (!running_)
+  {
+    return;
+  }
+  const size_t n = entries.size();
+  pending_ += n;
+  if (inWorker)
+  {
+    // 空闲的 worker 会从这里窃取一半
+    deques_[t_workerIndex]->pushBatch(entries.begin(), entries.end());
+  }
+  else
+  {
+    // 切成连续的几段，每个 deque 加一次锁
+    const size_t numDeques = deques_.size();
+    const size_t slice = (n + numDeques - 1) / numDeques;
+    size_t index = next_.fetch_add(1);
+    for (size_t first = 0; first < n; first += slice, ++index)
+    {
+      size_t last = std::min(first + slice, n);
+      deques_[index % numDeques]->pushBatch(entries.begin() + static_cast<ptrdiff_t>(first),
+                                            entries.begin() + static_cast<ptrdiff_t>(last));
+    }
+  }
+  if (idle_.load() > 0)
+  {
+    // 每个任务最多唤醒一个空闲 worker
+    MutexLockGuard lock(mutex_);
+    for (size_t i = std::min(n, static_cast<size_t>(idle_.load())); i > 0; --i)
+    {
+      notEmpty_.notify();
+    }
+  }
+}
+
+bool ThreadPool::take(size_t index, Entry* entry)
+{
+  if (deques_[index]->pop(entry) || steal(index, entry))
+  {
+    --pending_;
+    if (maxQueueSize_ > 0)
+    {
+      MutexLockGuard lock(mutex_);
+      notFull_.notify();
+    }
+    return true;
+  }
+
+  MutexLockGuard lock(mutex_);
+  ++idle_;
+  while (pending_.load() == 0 && running_)
+  {
+    notEmpty_.wait(lock);
+  }
+  --idle_;
+  return false;
+}
+
+bool ThreadPool::steal(size_t index, Entry* entry)
+{
+  const size_t n = deques_.size();
+  for (size_t i = 1; i < n; ++i)
+  {
+    if (deques_[(index + i) % n]->steal(entry, deques_[index].get()))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::runSharedQueue(size_t index)
+{
+  t_pool = this;
+  while (running_)
+  {
+    Entry entry;
+    if (elastic_)
+    {
+      ++idleWorkers_;
+      bool taken = queue_.take(&entry, idleTimeout_);
+      --idleWorkers_;
+      if (!taken)
       {
-        // std::this_thread::yield();
-        std::this_thread::sleep_for(std::chrono::milliseconds(10)); // 休眠10ms，避免无任务时空转
+        // 空闲超时，线程数多于下限时退出
+        if (running_ && retire(index))
+        {
+          break;
+        }
+        continue;
       }
     }
+    else
+    {
+      // take() 在队列为空时阻塞，stop() 之后返回空任务
+      entry = queue_.take();
+    }
+    if (entry.task)
+    {
+      runEntry(entry);
+    }
+  }
+  t_pool = nullptr;
+}
+
+void ThreadPool::runWorkStealing(size_t index)
+{
+  t_pool = this;
+  t_workerIndex = index;
+  while (running_)
+  {
+    Entry entry;
+    if (take(index, &entry) && entry.task)
+    {
+      runEntry(entry);
+    }
+  }
+  t_pool = nullptr;
+}
+
+void ThreadPool::runInThread(size_t index)
+{
+  try
+  {
+    if (threadInitCallback_)
+    {
+      threadInitCallback_();
+    }
+    if (deques_.empty())
+    {
+      runSharedQueue(index);
+    }
+    else
+    {
+      runWorkStealing(index);
+    }
   }
   catch (const Exception& ex)
   {
@@ -9,102 +9,286 @@
 #include <muduo/base/Thread.h>
 #include <muduo/base/Types.h>
 #include <muduo/base/BlockingQueueForThreadPool.h>
-#include <muduo/base/LockFreeQueue.h>
+#include <muduo/base/CpuAffinity.h>
+#include <muduo/base/Future.h>
+#include <muduo/base/Histogram.h>
+#include <muduo/base/InplaceFunction.h>
+#include <muduo/base/MpmcRingQueue.h>
+#include <muduo/base/PriorityBlockingQueue.h>
+#include <muduo/base/Timestamp.h>
+#include <muduo/base/WorkStealingDeque.h>
 
 #include <atomic>
 #include <vector>
 
-#define use_lock_free 0 // 0: use Blocking Queue, 1: use Lock-Free Queue
-
 namespace muduo
 {
 
+class SyncQueueBase
+{
+ public:
+  enum Backend
+  {
+    kBlockingQueue,  // mutex + deque, maxsize 0 means unbounded
+    kRingQueue,      // lock-free bounded ring, maxsize 0 means kDefaultCapacity
+    kPriorityQueue,  // mutex + binary heap, takes the largest T first
+  };
+};
+
 // 同步队列，供线程池使用，负责任务队列的同步操作
+// 后端在运行时选择，各后端都支持 size()/setMaxSize()/stop()，take() 在队列为空时阻塞。
+// kPriorityQueue 要求 T 支持 operator<。
 template <typename T>
-class SyncQueue
+class SyncQueue : public SyncQueueBase
 {
 public:
-  SyncQueue(int maxsize = 0)
+  SyncQueue(int maxsize = 0, Backend backend = kBlockingQueue)
+    : backend_(backend),
+      maxSize_(maxsize),
+      blocking_queue_(maxsize)
   {
-#if use_lock_free
-    //LockFreeQueue<T> lock_free_queue;
-#else
-    BlockingQueueForThreadPool<T> blocking_queue(maxsize);
-#endif
+    resetBackend();
   }
 
   ~SyncQueue() = default;
 
+  // Must be called before use.
+  void setBackend(Backend backend)
+  {
+    assert(size() == 0);
+    backend_ = backend;
+    resetBackend();
+  }
+
+  Backend backend() const { return backend_; }
+
+  // 只对 kBlockingQueue 生效。Must be called before use.
+  void setWaitStrategy(const WaitStrategy& strategy) { blocking_queue_.setWaitStrategy(strategy); }
+  const WaitStats& waitStats() const { return blocking_queue_.waitStats(); }
+
   template<typename U>
   void put(U&& x)
   {
-#if use_lock_free
-    lock_free_queue_.push(std::forward<U>(x));
-#else
-    blocking_queue_.put(std::forward<U>(x));
-#endif
+    switch (backend_)
+    {
+      case kRingQueue:
+        ring_queue_->put(std::forward<U>(x));
+        break;
+      case kPriorityQueue:
+        priority_queue_->put(std::forward<U>(x));
+        break;
+      default:
+        blocking_queue_.put(std::forward<U>(x));
+    }
+  }
+
+  // blocks while full
+  void putBatch(std::vector<T>& xs)
+  {
+    switch (backend_)
+    {
+      case kRingQueue:
+        for (T& x : xs)
+        {
+          if (!ring_queue_->put(std::move(x)))
+          {
+            break;
+          }
+        }
+        break;
+      case kPriorityQueue:
+        priority_queue_->putBatch(xs);
+        break;
+      default:
+        blocking_queue_.putBatch(xs);
+    }
+  }
+
+  // returns false if full or stopped, x is left untouched
+  template<typename U>
+  bool tryPut(U&& x)
+  {
+    switch (backend_)
+    {
+      case kRingQueue:
+        return ring_queue_->tryPut(std::forward<U>(x));
+      case kPriorityQueue:
+        return priority_queue_->tryPut(std::forward<U>(x));
+      default:
+        return blocking_queue_.tryPut(std::forward<U>(x));
+    }
   }
 
+  // returns T() if stopped
   T take()
   {
-#if use_lock_free
-    std::unique_ptr<T> ptr = lock_free_queue_.pop();
-    return ptr ? *ptr : T();
-#else
-    return blocking_queue_.take();
-#endif
+    switch (backend_)
+    {
+      case kRingQueue:
+        return ring_queue_->take();
+      case kPriorityQueue:
+        return priority_queue_->take();
+      default:
+        return blocking_queue_.take();
+    }
+  }
+
+  // returns false if timeout or stopped
+  bool take(T* x, double seconds)
+  {
+    switch (backend_)
+    {
+      case kRingQueue:
+        return ring_queue_->take(x, seconds);
+      case kPriorityQueue:
+        return priority_queue_->take(x, seconds);
+      default:
+        return blocking_queue_.take(x, seconds);
+    }
   }
 
   size_t size() const
   {
-#if use_lock_free
-    // LockFreeQueue does not support size() function
-    return 0;
-#else
-    return blocking_queue_.size();
-#endif
+    switch (backend_)
+    {
+      case kRingQueue:
+        return ring_queue_->size();
+      case kPriorityQueue:
+        return priority_queue_->size();
+      default:
+        return blocking_queue_.size();
+    }
   }
 
+  // For kRingQueue, the capacity is fixed once allocated,
+  // so it must be called before use.
   void setMaxSize(size_t maxSize)
   {
-#if use_lock_free
-    // LockFreeQueue does not support setMaxSize() function
-#else
-    blocking_queue_.setMaxSize(maxSize);
-#endif
+    maxSize_ = maxSize;
+    switch (backend_)
+    {
+      case kRingQueue:
+        assert(size() == 0);
+        ring_queue_.reset(newRingQueue());
+        break;
+      case kPriorityQueue:
+        priority_queue_->setMaxSize(maxSize);
+        break;
+      default:
+        blocking_queue_.setMaxSize(maxSize);
+    }
   }
 
   void stop()
   {
-#if use_lock_free
-    // LockFreeQueue does not support stop() function
-#else
-    blocking_queue_.stop();
-#endif
+    switch (backend_)
+    {
+      case kRingQueue:
+        ring_queue_->stop();
+        break;
+      case kPriorityQueue:
+        priority_queue_->stop();
+        break;
+      default:
+        blocking_queue_.stop();
+    }
   }
 
 private:
-#if use_lock_free
-  LockFreeQueue<T> lock_free_queue_;
-#else
+  MpmcRingQueue<T>* newRingQueue() const
+  {
+    return new MpmcRingQueue<T>(maxSize_ > 0 ? maxSize_ : MpmcRingQueue<T>::kDefaultCapacity);
+  }
+
+  void resetBackend()
+  {
+    ring_queue_.reset(backend_ == kRingQueue ? newRingQueue() : nullptr);
+    priority_queue_.reset(backend_ == kPriorityQueue
+                          ? new PriorityBlockingQueue<T>(static_cast<int>(maxSize_))
+                          : nullptr);
+  }
+
+  Backend backend_;
+  size_t maxSize_;
   BlockingQueueForThreadPool<T> blocking_queue_;
-#endif
+  std::unique_ptr<MpmcRingQueue<T>> ring_queue_;
+  std::unique_ptr<PriorityBlockingQueue<T>> priority_queue_;
 };
 
   // 线程池
   // 上层通过调用 run 函数将任务添加到同步层中，
   // 异步层中的线程的 runInThread 则会在空闲的时候将任务取出并执行。
+  //
+  // kWorkStealing 模式下每个 worker 有自己的 deque：
+  // worker 线程里提交的任务进入自己的 deque，其他线程提交的任务轮流分给各个 worker，
+  // 空闲的 worker 从别人的 deque 里窃取任务，从而避免所有线程争抢同一把锁。
   class ThreadPool : noncopyable
   {
   public:
-    using Task = std::function<void()>;
+    // 小于 64 字节的任务不分配内存，见 InplaceFunction
+    using Task = InplaceFunction<void()>;
+    using ThreadInitCallback = std::function<void()>;
+
+    enum Mode
+    {
+      kSharedQueue,
+      kWorkStealing,
+    };
+
+    enum Admission
+    {
+      kAdmitAll,
+      // CoDel：以任务在队列中的等待时间（sojourn time）而不是队列长度判断过载。
+      // 一个 interval 内最小的等待时间都超过 target 即认为过载：
+      // 拒绝新任务，并丢弃等待超过 2 * target 的任务。
+      kCoDel,
+    };
+
+    enum DropReason
+    {
+      kExpired,     // deadline passed before the task ran
+      kOverloaded,  // shed by CoDel
+    };
+    typedef std::function<void(DropReason)> DropCallback;
+
+    struct TaskOptions
+    {
+      int priority = 0;     // larger runs first, needs kPriorityQueue backend
+      Timestamp deadline;   // invalid means no deadline
+      DropCallback onDrop;  // called in a worker thread if the task is dropped
+    };
 
     explicit ThreadPool(const string &nameArg = string("ThreadPool"));
     ~ThreadPool();
 
     // Must be called before start().
-    void setMaxQueueSize(int maxSize) { queue_.setMaxSize(maxSize); }
-    void setThreadInitCallback(const Task &cb)
+    void setMode(Mode mode) { mode_ = mode; }
+    // Must be called before start(), used by kSharedQueue mode.
+    void setQueueBackend(SyncQueueBase::Backend backend) { queue_.setBackend(backend); }
+    // worker 取任务时的等待策略，只对 kSharedQueue + kBlockingQueue 生效。
+    // Must be called before start().
+    void setWaitStrategy(const WaitStrategy& strategy) { queue_.setWaitStrategy(strategy); }
+    // Must be called before start().
+    void setMaxQueueSize(int maxSize)
+    {
+      maxQueueSize_ = maxSize;
+      queue_.setMaxSize(maxSize);
+    }
+    // 弹性模式，仅用于 kSharedQueue：线程数在 [minThreads, maxThreads] 之间变化。
+    // 有任务排队超过 spawnDelay 且没有空闲 worker 时增加一个线程，
+    // worker 空闲超过 idleTimeout 后退出。
+    // Must be called before start().
+    void setElastic(int minThreads, int maxThreads,
+                    double spawnDelaySeconds = 0.01,
+                    double idleTimeoutSeconds = 60.0);
+    // Must be called before start().
+    void setAdmission(Admission admission,
+                      double targetSeconds = 0.005,
+                      double intervalSeconds = 0.1);
+    // 第 i 个 worker 绑定到 affinity.cpusFor(i)，弹性模式下新增的线程同样处理。
+    // Must be called before start().
+    void setAffinity(const CpuAffinity& affinity) { affinity_ = affinity; }
+    void setThreadInitCallback(const ThreadInitCallback &cb)
     {
       threadInitCallback_ = cb;
     }
@@ -122,13 +306,160 @@ private:
     // Could block if maxQueueSize > 0
     void run(Task&& f);
 
+    // 带优先级和截止时间的任务，超过 deadline 的任务在执行前被丢弃。
+    // returns false if rejected by admission control, onDrop is not called then.
+    bool run(Task&& f, TaskOptions&& options);
+
+    // 与 run() 相同，但返回任务的结果；任务抛出的异常由 Future::get() 重新抛出
+    template<typename F>
+    auto submit(F&& f)
+      -> Future<typename std::invoke_result<typename std::decay<F>::type&>::type>
+    {
+      typedef typename std::invoke_result<typename std::decay<F>::type&>::type Result;
+      Promise<Result> promise;
+      Future<Result> future(promise.getFuture());
+      run([promise = std::move(promise), fn = std::forward<F>(f)]() mutable
+          {
+            promise.run(fn);
+          });
+      return future;
+    }
+
+    // 一次加锁放入全部任务，每个等待中的 worker 最多被唤醒一次。
+    // Could block if maxQueueSize > 0, kWorkStealing 模式下可能超出上限一个批次。
+    void runBatch(std::vector<Task>&& tasks);
+
+    // 把 [begin, end) 按 grain 切块，在线程池中并行执行 fn(i)，调用线程也参与执行，
+    // 全部完成后返回，可以在 worker 线程中嵌套调用。fn 抛出的第一个异常在调用线程重新抛出。
+    template<typename Index, typename Fn>
+    void parallelFor(Index begin, Index end, Index grain, Fn&& fn)
+    {
+      if (!(begin < end))
+      {
+        return;
+      }
+      if (grain < 1)
+      {
+        grain = 1;
+      }
+      const size_t total = static_cast<size_t>(end - begin);
+      const size_t chunk = static_cast<size_t>(grain);
+      parallelForChunks((total + chunk - 1) / chunk, [&](size_t c)
+          {
+            Index first = static_cast<Index>(begin + static_cast<Index>(c * chunk));
+            Index last = (c + 1) * chunk >= total ? end : static_cast<Index>(first + grain);
+            for (Index i = first; i < last; ++i)
+            {
+              fn(i);
+            }
+          });
+    }
+
+    Mode mode() const { return mode_; }
+
+    // current number of workers
+    int numThreads() const { return numThreads_.load(); }
+    // worker 在共享队列上等待任务的自旋/park 统计
+    const WaitStats& waitStats() const { return queue_.waitStats(); }
+    // 任务的排队时间（微秒），只在 kCoDel 或弹性模式下统计
+    const Histogram& queueDelay() const { return queueDelay_; }
+
+    bool overloaded() const { return overloaded_.load(std::memory_order_relaxed); }
+    int64_t droppedExpired() const { return droppedExpired_.load(); }
+    int64_t droppedOverloaded() const { return droppedOverloaded_.load(); }
+    int64_t rejected() const { return rejected_.load(); }
+
   private:
-    void runInThread();
+    // 只有带 TaskOptions 的任务才需要的信息，单独分配，保持 Entry 小巧
+    struct Schedule
+    {
+      DropCallback onDrop;
+      int64_t deadline = 0;  // microseconds, 0 means none
+      int priority = 0;
+    };
+
+    // 队列中的元素，任务加上调度所需的信息
+    struct Entry
+    {
+      Task task;
+      int64_t enqueueTime = 0;  // microseconds, 0 if not measured
+      uint64_t sequence = 0;    // for kPriorityQueue
+      std::unique_ptr<Schedule> schedule;
+
+      int priority() const { return schedule ? schedule->priority : 0; }
+
+      // for kPriorityQueue: higher priority first, FIFO within the same priority
+      bool operator<(const Entry& rhs) const
+      {
+        int p = priority();
+        int q = rhs.priority();
+        return p < q || (p == q && sequence > rhs.sequence);
+      }
+    };
+
+    bool measureDelay() const { return admission_ == kCoDel || elastic_; }
+    Entry makeEntry(Task&& task);
+    bool admit(int64_t now);
+    void enqueue(Entry&& entry);
+    void runEntry(Entry& entry);
+    void drop(Entry& entry, DropReason reason);
+    void updateCoDel(int64_t now, int64_t sojourn);
+
+    void runInThread(size_t index);
+    void runMonitor();
+    void spawnThread();
+    bool retire(size_t index);
+    void runSharedQueue(size_t index);
+    void runWorkStealing(size_t index);
+    void parallelForChunks(size_t numChunks, const InplaceFunction<void(size_t)>& runChunk);
+    // for kWorkStealing
+    void put(Entry&& entry);
+    void putBatch(std::vector<Entry>& entries);
+    bool take(size_t index, Entry* entry);
+    bool steal(size_t index, Entry* entry);
+
     std::string name_;
-    Task threadInitCallback_;
+    ThreadInitCallback threadInitCallback_;
+    CpuAffinity affinity_;
     std::vector<std::unique_ptr<Thread>> threads_;
-    SyncQueue<Task> queue_;
+    SyncQueue<Entry> queue_;
     std::atomic<bool> running_;
+    Mode mode_;
+    size_t maxQueueSize_;
+
+    std::vector<std::unique_ptr<WorkStealingDeque<Entry>>> deques_;
+    std::atomic<size_t> pending_;  // 所有 deque 中的任务数，入队前先占位
+    std::atomic<int> idle_;        // 正在 notEmpty_ 上等待的 worker 数
+    std::atomic<size_t> next_;     // 非 worker 线程提交任务时轮流选择 deque
+    MutexLock mutex_;
+    Condition notEmpty_ GUARDED_BY(mutex_);
+    Condition notFull_ GUARDED_BY(mutex_);
+
+    Admission admission_;
+    int64_t codelTarget_;    // microseconds
+    int64_t codelInterval_;  // microseconds
+    std::atomic<int64_t> minDelay_;      // 当前 interval 内最小的等待时间
+    std::atomic<int64_t> intervalEnd_;
+    std::atomic<bool> overloaded_;
+    std::atomic<uint64_t> sequence_;     // for kPriorityQueue
+    std::atomic<int64_t> droppedExpired_;
+    std::atomic<int64_t> droppedOverloaded_;
+    std::atomic<int64_t> rejected_;
+
+    bool elastic_;
+    int minThreads_;
+    int maxThreads_;
+    int64_t spawnDelay_;   // microseconds
+    double idleTimeout_;   // seconds
+    std::atomic<int> numThreads_;
+    std::atomic<int> idleWorkers_;        // 在 queue_.take() 中等待的 worker 数
+    std::atomic<int64_t> lastDequeue_;    // microseconds
+    std::atomic<int64_t> lastSojourn_;    // microseconds
+    Histogram queueDelay_;
+    std::unique_ptr<Thread> monitor_;     // 负责增减线程
+    MutexLock elasticMutex_;
+    Condition monitorCond_ GUARDED_BY(elasticMutex_);
+    std::vector<size_t> exited_ GUARDED_BY(elasticMutex_);  // 已退出、待 join 的 worker
   };
 
 } // namespace muduo
@@ -0,0 +1,154 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_WAITSTRATEGY_H
+#define MUDUO_BASE_WAITSTRATEGY_H
+
+#include <muduo/base/Types.h>
+
+#include <atomic>
+
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+
+namespace muduo
+{
+
+// 一个等待者的统计，同时保存自适应的自旋上限。
+// 只在等待的慢路径上更新（条件一开始就满足的不计入）。
+struct WaitStats
+{
+  std::atomic<int64_t> waits{0};      // 进入慢路径的次数
+  std::atomic<int64_t> spinHits{0};   // 在自旋阶段等到
+  std::atomic<int64_t> yieldHits{0};  // 在 sched_yield 阶段等到
+  std::atomic<int64_t> parks{0};      // 最终睡在 futex 上
+  std::atomic<int> spinLimit{-1};     // -1 表示还没开始自适应
+
+  double hitRate() const
+  {
+    int64_t n = waits.load(std::memory_order_relaxed);
+    return n == 0 ? 0.0 : static_cast<double>(n - parks.load(std::memory_order_relaxed)) / static_cast<double>(n);
+  }
+
+  // "waits 100 spin 80 yield 5 park 15"
+  string toString() const
+  {
+    char buf[128];
+    snprintf(buf, sizeof buf, "waits %lld spin %lld yield %lld park %lld",
+             static_cast<long long>(waits.load(std::memory_order_relaxed)),
+             static_cast<long long>(spinHits.load(std::memory_order_relaxed)),
+             static_cast<long long>(yieldHits.load(std::memory_order_relaxed)),
+             static_cast<long long>(parks.load(std::memory_order_relaxed)));
+    return buf;
+  }
+};
+
+// 等待策略：先不持锁自旋最多 spins 次（每次一条 pause），再 sched_yield 最多 yields 次，
+// 条件仍不满足才睡在条件变量上。默认（0, 0）就是原来的直接 park。
+//
+// 生产者和消费者在不同 CPU 上、交接间隔只有几微秒时，自旋可以省掉两次上下文切换；
+// CPU 紧张（线程数多于核数）时自旋只是浪费，应当用默认策略。
+// 实际的自旋次数在 [kMinSpins, spins] 之间自适应：自旋成功时向成功所需次数的两倍靠拢，
+// park 时减少 1/8，类似 glibc 的 PTHREAD_MUTEX_ADAPTIVE_NP。
+class WaitStrategy
+{
+ public:
+  static const int kMinSpins = 16;
+
+  enum Result
+  {
+    kSpun,
+    kYielded,
+    kTimedOut,
+  };
+
+  WaitStrategy()
+    : spins_(0),
+      yields_(0)
+  {
+  }
+
+  WaitStrategy(int spins, int yields)
+    : spins_(spins),
+      yields_(yields)
+  {
+  }
+
+  static WaitStrategy blocking() { return WaitStrategy(); }
+  static WaitStrategy spinThenPark(int spins = 4000, int yields = 8)
+  {
+    return WaitStrategy(spins, yields);
+  }
+
+  int spins() const { return spins_; }
+  int yields() const { return yields_; }
+  bool parksImmediately() const { return spins_ <= 0 && yields_ <= 0; }
+
+  // 不持锁调用，ready 必须是无锁的检查（通常读一个原子计数），只作为提示。
+  template<typename Ready>
+  Result spinUntil(Ready ready, WaitStats* stats) const
+  {
+    int limit = stats->spinLimit.load(std::memory_order_relaxed);
+    if (limit < 0 || limit > spins_)
+    {
+      limit = spins_;
+    }
+    for (int i = 0; i < limit; ++i)
+    {
+      if (ready())
+      {
+        adapt(stats, limit + (2 * i + kMinSpins - limit) / 8);
+        return kSpun;
+      }
+      cpuRelax();
+    }
+    if (spins_ > 0)
+    {
+      adapt(stats, limit - limit / 8);
+    }
+    for (int i = 0; i < yields_; ++i)
+    {
+      ::sched_yield();
+      if (ready())
+      {
+        return kYielded;
+      }
+    }
+    return kTimedOut;
+  }
+
+  static void cpuRelax()
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#else
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+  }
+
+ private:
+  void adapt(WaitStats* stats, int limit) const
+  {
+    if (limit < kMinSpins)
+    {
+      limit = kMinSpins;
+    }
+    if (limit > spins_)
+    {
+      limit = spins_;
+    }
+    stats->spinLimit.store(limit, std::memory_order_relaxed);
+  }
+
+  int spins_;
+  int yields_;
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_WAITSTRATEGY_H
@@ -0,0 +1,104 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_WORKSTEALINGDEQUE_H
+#define MUDUO_BASE_WORKSTEALINGDEQUE_H
+
+#include <muduo/base/Mutex.h>
+
+#include <deque>
+
+namespace muduo
+{
+
+// 工作窃取线程池中每个 worker 私有的任务队列。
+// owner 与窃取者都从队头取任务（FIFO），避免本地任务在高负载下被饿死；
+// 每个 deque 有独立的锁，只有窃取时才会跨线程竞争同一把锁。
+template<typename T>
+class WorkStealingDeque : noncopyable
+{
+ public:
+  WorkStealingDeque()
+    : mutex_(),
+      queue_()
+  {
+  }
+
+  template<typename U>
+  void push(U&& x)
+  {
+    MutexLockGuard lock(mutex_);
+    queue_.push_back(std::forward<U>(x));
+  }
+
+  // moves [first, last) in with one lock
+  template<typename Iterator>
+  void pushBatch(Iterator first, Iterator last)
+  {
+    MutexLockGuard lock(mutex_);
+    for (; first != last; ++first)
+    {
+      queue_.push_back(std::move(*first));
+    }
+  }
+
+  // called by owner
+  bool pop(T* x)
+  {
+    MutexLockGuard lock(mutex_);
+    if (queue_.empty())
+    {
+      return false;
+    }
+    *x = std::move(queue_.front());
+    queue_.pop_front();
+    return true;
+  }
+
+  // called by thief, moves about half of the tasks into thief's deque,
+  // returns the first one in *x.
+  bool steal(T* x, WorkStealingDeque* thief)
+  {
+    std::deque<T> stolen;
+    {
+      MutexLockGuard lock(mutex_);
+      if (queue_.empty())
+      {
+        return false;
+      }
+      size_t n = (queue_.size() + 1) / 2;
+      for (size_t i = 0; i < n; ++i)
+      {
+        stolen.push_back(std::move(queue_.front()));
+        queue_.pop_front();
+      }
+    }
+    *x = std::move(stolen.front());
+    stolen.pop_front();
+    if (!stolen.empty())
+    {
+      MutexLockGuard lock(thief->mutex_);
+      for (auto& t : stolen)
+      {
+        thief->queue_.push_back(std::move(t));
+      }
+    }
+    return true;
+  }
+
+  size_t size() const
+  {
+    MutexLockGuard lock(mutex_);
+    return queue_.size();
+  }
+
+ private:
+  mutable MutexLock mutex_;
+  std::deque<T> queue_ GUARDED_BY(mutex_);
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_WORKSTEALINGDEQUE_H
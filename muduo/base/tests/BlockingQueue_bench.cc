@@ -1,21 +1,32 @@
 #include <muduo/base/BlockingQueue.h>
 #include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Histogram.h>
 #include <muduo/base/Thread.h>
 #include <muduo/base/Timestamp.h>
+#include <muduo/base/WaitStrategy.h>
 
-#include <map>
 #include <string>
 #include <vector>
 #include <stdio.h>
+#include <time.h>
 #include <unistd.h>
 
+int64_t nowNanos()
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// 生产者每隔 intervalUs 放入一个时间戳，消费者取出后记录交接延迟（纳秒）
 class Bench
 {
  public:
-  Bench(int numThreads)
+  Bench(int numThreads, const muduo::WaitStrategy& strategy)
     : latch_(numThreads),
       threads_()
   {
+    queue_.setWaitStrategy(strategy);
     for (int i = 0; i < numThreads; ++i)
     {
       char name[32];
@@ -25,16 +36,16 @@ class Bench
     }
   }
 
-  void run(int times)
+  void run(int times, int intervalUs)
   {
-    printf("waiting for count down latch\n");
     latch_.wait();
-    printf("all threads started\n");
     for (int i = 0; i < times; ++i)
     {
-      muduo::Timestamp now(muduo::Timestamp::now());
-      queue_.put(now);
-      usleep(1000);
+      queue_.put(nowNanos());
+      if (intervalUs > 0)
+      {
+        usleep(intervalUs);
+      }
     }
   }
 
@@ -42,7 +53,7 @@ class Bench
   {
     for (size_t i = 0; i < threads_.size(); ++i)
     {
-      queue_.put(muduo::Timestamp::invalid());
+      queue_.put(-1);
     }
 
     for (auto& thr : threads_)
@@ -51,52 +62,58 @@ class Bench
     }
   }
 
+  void report(const char* name) const
+  {
+    printf("%-16s p50 %6lld p90 %6lld p99 %7lld p999 %7lld max %8lld ns  %s\n", name,
+           static_cast<long long>(delays_.percentile(50)),
+           static_cast<long long>(delays_.percentile(90)),
+           static_cast<long long>(delays_.percentile(99)),
+           static_cast<long long>(delays_.percentile(99.9)),
+           static_cast<long long>(delays_.max()),
+           queue_.waitStats().toString().c_str());
+  }
+
  private:
 
   void threadFunc()
   {
-    printf("tid=%d, %s started\n",
-           muduo::CurrentThread::tid(),
-           muduo::CurrentThread::name());
-
-    std::map<int, int> delays;
     latch_.countDown();
     bool running = true;
     while (running)
     {
-      muduo::Timestamp t(queue_.take());
-      muduo::Timestamp now(muduo::Timestamp::now());
-      if (t.valid())
+      int64_t t = queue_.take();
+      int64_t now = nowNanos();
+      if (t >= 0)
       {
-        int delay = static_cast<int>(timeDifference(now, t) * 1000000);
-        // printf("tid=%d, latency = %d us\n",
-        //        muduo::CurrentThread::tid(), delay);
-        ++delays[delay];
+        delays_.add(now - t);
       }
-      running = t.valid();
-    }
-
-    printf("tid=%d, %s stopped\n",
-           muduo::CurrentThread::tid(),
-           muduo::CurrentThread::name());
-    for (const auto& delay : delays)
-    {
-      printf("tid = %d, delay = %d, count = %d\n",
-             muduo::CurrentThread::tid(),
-             delay.first, delay.second);
+      running = t >= 0;
     }
   }
 
-  muduo::BlockingQueue<muduo::Timestamp> queue_;
+  muduo::BlockingQueue<int64_t> queue_;
   muduo::CountDownLatch latch_;
   std::vector<std::unique_ptr<muduo::Thread>> threads_;
+  muduo::Histogram delays_;
 };
 
+void bench(const char* name, const muduo::WaitStrategy& strategy,
+           int threads, int intervalUs)
+{
+  Bench t(threads, strategy);
+  t.run(10000, intervalUs);
+  t.joinAll();
+  t.report(name);
+}
+
 int main(int argc, char* argv[])
 {
   int threads = argc > 1 ? atoi(argv[1]) : 1;
+  int intervalUs = argc > 2 ? atoi(argv[2]) : 1000;
+  printf("%d consumer(s), one put every %d us\n", threads, intervalUs);
 
-  Bench t(threads);
-  t.run(10000);
-  t.joinAll();
+  bench("blocking", muduo::WaitStrategy::blocking(), threads, intervalUs);
+  bench("spin+yield", muduo::WaitStrategy::spinThenPark(), threads, intervalUs);
+  bench("spin-long", muduo::WaitStrategy::spinThenPark(100000, 0), threads, intervalUs);
+  bench("yield-only", muduo::WaitStrategy(0, 64), threads, intervalUs);
 }
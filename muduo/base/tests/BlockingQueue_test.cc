@@ -5,6 +5,7 @@
 #include <memory>
 #include <string>
 #include <vector>
+#include <assert.h>
 #include <stdio.h>
 #include <unistd.h>
 
@@ -89,6 +90,35 @@ void testMove()
   printf("took %d\n", *y);
 }
 
+void testWaitStrategy()
+{
+  // 自旋等待不能丢元素，统计要对得上
+  muduo::BlockingQueue<int> queue;
+  queue.setWaitStrategy(muduo::WaitStrategy::spinThenPark(1000, 4));
+  muduo::CountDownLatch latch(1);
+  latch.setWaitStrategy(muduo::WaitStrategy::spinThenPark());
+  const int kCount = 100000;
+  int64_t sum = 0;
+  muduo::Thread consumer([&queue, &latch, &sum] {
+    for (int i = 0; i < kCount; ++i)
+    {
+      sum += queue.take();
+    }
+    latch.countDown();
+  });
+  for (int i = 0; i < kCount; ++i)
+  {
+    queue.put(i);
+  }
+  latch.wait();
+  consumer.join();
+  assert(sum == static_cast<int64_t>(kCount) * (kCount - 1) / 2);
+  const muduo::WaitStats& stats = queue.waitStats();
+  assert(stats.waits == stats.spinHits + stats.yieldHits + stats.parks);
+  printf("queue: %s, latch: %s\n",
+         stats.toString().c_str(), latch.waitStats().toString().c_str());
+}
+
 int main()
 {
   printf("pid=%d, tid=%d\n", ::getpid(), muduo::CurrentThread::tid());
@@ -97,6 +127,7 @@ int main()
   t.joinAll();
 
   testMove();
+  testWaitStrategy();
 
   printf("number of created threads %d\n", muduo::Thread::numCreated());
 }
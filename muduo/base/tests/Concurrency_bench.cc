@@ -0,0 +1,498 @@
+// 统一的队列/线程池基准测试。
+// 对每种队列和线程池配置，扫描生产者数、消费者数、负载大小和批量大小，
+// 输出吞吐量和交接延迟（从 put 到被消费者取出）的 p50/p99/p999，格式为 CSV 或 JSON。
+//
+// usage: concurrency_bench [--json] [--quick] [--items=N] [--filter=substring]
+
+#include <muduo/base/BlockingQueue.h>
+#include <muduo/base/BlockingQueueForThreadPool.h>
+#include <muduo/base/BoundedBlockingQueue.h>
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Histogram.h>
+#include <muduo/base/LockFreeQueue.h>
+#include <muduo/base/MpmcRingQueue.h>
+#include <muduo/base/PriorityBlockingQueue.h>
+#include <muduo/base/Thread.h>
+#include <muduo/base/ThreadPool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+using muduo::Histogram;
+
+const int64_t kStop = INT64_MAX;
+const int kCapacity = 1024;  // 有界队列的容量
+
+int64_t nowNanos()
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+struct Item
+{
+  int64_t sent = 0;
+  std::string payload;
+
+  // 先放入的先出，kStop 排在最后
+  bool operator<(const Item& rhs) const { return sent > rhs.sent; }
+};
+
+struct Config
+{
+  int producers;
+  int consumers;
+  int payload;  // bytes
+  int batch;
+  int items;    // total
+};
+
+class Reporter
+{
+ public:
+  explicit Reporter(bool json)
+    : json_(json),
+      rows_(0)
+  {
+    if (json_)
+    {
+      printf("[\n");
+    }
+    else
+    {
+      printf("name,producers,consumers,payload,batch,items,seconds,"
+             "ops_per_sec,p50_ns,p99_ns,p999_ns,max_ns\n");
+    }
+  }
+
+  ~Reporter()
+  {
+    if (json_)
+    {
+      printf("\n]\n");
+    }
+  }
+
+  void report(const char* name, const Config& c, int64_t items,
+              double seconds, const Histogram& latency)
+  {
+    double ops = seconds > 0 ? static_cast<double>(items) / seconds : 0;
+    long long p50 = latency.percentile(50);
+    long long p99 = latency.percentile(99);
+    long long p999 = latency.percentile(99.9);
+    long long max = latency.max();
+    if (json_)
+    {
+      printf("%s  {\"name\": \"%s\", \"producers\": %d, \"consumers\": %d, "
+             "\"payload\": %d, \"batch\": %d, \"items\": %lld, \"seconds\": %.6f, "
+             "\"ops_per_sec\": %.0f, \"p50_ns\": %lld, \"p99_ns\": %lld, "
+             "\"p999_ns\": %lld, \"max_ns\": %lld}",
+             rows_ > 0 ? ",\n" : "", name, c.producers, c.consumers, c.payload,
+             c.batch, static_cast<long long>(items), seconds, ops, p50, p99, p999, max);
+    }
+    else
+    {
+      printf("%s,%d,%d,%d,%d,%lld,%.6f,%.0f,%lld,%lld,%lld,%lld\n",
+             name, c.producers, c.consumers, c.payload, c.batch,
+             static_cast<long long>(items), seconds, ops, p50, p99, p999, max);
+    }
+    fflush(stdout);
+    ++rows_;
+  }
+
+ private:
+  bool json_;
+  int rows_;
+};
+
+// 各种队列统一成 put/putBatch/take 三个操作
+
+class BlockingAdapter
+{
+ public:
+  explicit BlockingAdapter(const muduo::WaitStrategy& strategy = muduo::WaitStrategy())
+  {
+    queue_.setWaitStrategy(strategy);
+  }
+  void put(Item&& x) { queue_.put(std::move(x)); }
+  void putBatch(std::vector<Item>& xs)
+  {
+    for (Item& x : xs)
+    {
+      queue_.put(std::move(x));
+    }
+  }
+  void take(Item* x) { *x = queue_.take(); }
+
+ private:
+  muduo::BlockingQueue<Item> queue_;
+};
+
+class SpinningBlockingAdapter : public BlockingAdapter
+{
+ public:
+  SpinningBlockingAdapter()
+    : BlockingAdapter(muduo::WaitStrategy::spinThenPark())
+  {
+  }
+};
+
+class BoundedAdapter
+{
+ public:
+  BoundedAdapter() : queue_(kCapacity) {}
+  void put(Item&& x) { queue_.put(x); }
+  void putBatch(std::vector<Item>& xs)
+  {
+    for (Item& x : xs)
+    {
+      queue_.put(x);
+    }
+  }
+  void take(Item* x) { *x = queue_.take(); }
+
+ private:
+  muduo::BoundedBlockingQueue<Item> queue_;
+};
+
+template<typename Queue>
+class ThreadPoolQueueAdapter
+{
+ public:
+  ThreadPoolQueueAdapter() : queue_(kCapacity) {}
+  void put(Item&& x) { queue_.put(std::move(x)); }
+  void putBatch(std::vector<Item>& xs) { queue_.putBatch(xs); }
+  void take(Item* x) { *x = queue_.take(); }
+
+ private:
+  Queue queue_;
+};
+
+class RingAdapter
+{
+ public:
+  RingAdapter() : queue_(kCapacity) {}
+  void put(Item&& x) { queue_.put(std::move(x)); }
+  void putBatch(std::vector<Item>& xs)
+  {
+    for (Item& x : xs)
+    {
+      queue_.put(std::move(x));
+    }
+  }
+  void take(Item* x) { queue_.take(x); }
+
+ private:
+  muduo::MpmcRingQueue<Item> queue_;
+};
+
+class LockFreeAdapter
+{
+ public:
+  void put(Item&& x) { queue_.push(std::move(x)); }
+  void putBatch(std::vector<Item>& xs)
+  {
+    for (Item& x : xs)
+    {
+      queue_.push(std::move(x));
+    }
+  }
+  // 无界、不阻塞，空的时候只能让出 CPU
+  void take(Item* x)
+  {
+    std::optional<Item> item;
+    while (!(item = queue_.pop()))
+    {
+      std::this_thread::yield();
+    }
+    *x = std::move(*item);
+  }
+
+ private:
+  muduo::LockFreeQueue<Item> queue_;
+};
+
+// 所有线程就绪后同时开始
+class StartGate
+{
+ public:
+  explicit StartGate(int numThreads)
+    : ready_(numThreads),
+      go_(1)
+  {
+  }
+  void arrive()
+  {
+    ready_.countDown();
+    go_.wait();
+  }
+  int64_t open()
+  {
+    ready_.wait();
+    int64_t start = nowNanos();
+    go_.countDown();
+    return start;
+  }
+
+ private:
+  muduo::CountDownLatch ready_;
+  muduo::CountDownLatch go_;
+};
+
+template<typename Adapter>
+void benchQueue(const char* name, const Config& c, Reporter* reporter)
+{
+  Adapter queue;
+  Histogram latency;
+  StartGate gate(c.producers + c.consumers);
+  int perProducer = c.items / c.producers;
+
+  std::vector<std::unique_ptr<muduo::Thread>> consumers;
+  for (int i = 0; i < c.consumers; ++i)
+  {
+    consumers.emplace_back(new muduo::Thread([&] {
+      gate.arrive();
+      Item x;
+      for (;;)
+      {
+        queue.take(&x);
+        if (x.sent == kStop)
+        {
+          break;
+        }
+        latency.add(nowNanos() - x.sent);
+      }
+    }, "consumer"));
+  }
+
+  std::vector<std::unique_ptr<muduo::Thread>> producers;
+  for (int i = 0; i < c.producers; ++i)
+  {
+    producers.emplace_back(new muduo::Thread([&] {
+      gate.arrive();
+      std::vector<Item> batch;
+      batch.reserve(c.batch);
+      for (int n = 0; n < perProducer; ++n)
+      {
+        Item x;
+        x.payload.assign(c.payload, 'x');
+        if (c.batch <= 1)
+        {
+          x.sent = nowNanos();
+          queue.put(std::move(x));
+          continue;
+        }
+        batch.push_back(std::move(x));
+        if (static_cast<int>(batch.size()) == c.batch || n + 1 == perProducer)
+        {
+          int64_t now = nowNanos();
+          for (Item& item : batch)
+          {
+            item.sent = now;
+          }
+          queue.putBatch(batch);
+          batch.clear();
+        }
+      }
+    }, "producer"));
+  }
+
+  int64_t start = gate.open();
+  for (auto& thr : producers)
+  {
+    thr->join();
+  }
+  for (int i = 0; i < c.consumers; ++i)
+  {
+    Item stop;
+    stop.sent = kStop;
+    queue.put(std::move(stop));
+  }
+  for (auto& thr : consumers)
+  {
+    thr->join();
+  }
+  double seconds = static_cast<double>(nowNanos() - start) / 1e9;
+  reporter->report(name, c, static_cast<int64_t>(perProducer) * c.producers, seconds, latency);
+}
+
+// 线程池：生产者调用 run()/runBatch()，消费者就是 worker
+struct PoolState
+{
+  Histogram latency;
+  std::atomic<int64_t> done{0};
+  int64_t total = 0;
+  muduo::CountDownLatch finished{1};
+
+  void onTask(int64_t sent)
+  {
+    latency.add(nowNanos() - sent);
+    if (done.fetch_add(1, std::memory_order_relaxed) + 1 == total)
+    {
+      finished.countDown();
+    }
+  }
+};
+
+void benchPool(const char* name, const Config& c,
+               const std::function<void(muduo::ThreadPool*)>& setup,
+               Reporter* reporter)
+{
+  muduo::ThreadPool pool("BenchPool");
+  pool.setMaxQueueSize(kCapacity);
+  setup(&pool);
+  pool.start(c.consumers);
+
+  PoolState state;
+  int perProducer = c.items / c.producers;
+  state.total = static_cast<int64_t>(perProducer) * c.producers;
+  StartGate gate(c.producers);
+  PoolState* s = &state;
+
+  std::vector<std::unique_ptr<muduo::Thread>> producers;
+  for (int i = 0; i < c.producers; ++i)
+  {
+    producers.emplace_back(new muduo::Thread([&, s] {
+      gate.arrive();
+      if (c.batch <= 1)
+      {
+        for (int n = 0; n < perProducer; ++n)
+        {
+          std::string payload(c.payload, 'x');
+          int64_t sent = nowNanos();
+          pool.run([s, sent, payload = std::move(payload)] { s->onTask(sent); });
+        }
+        return;
+      }
+      std::vector<muduo::ThreadPool::Task> batch;
+      for (int n = 0; n < perProducer; n += c.batch)
+      {
+        int count = std::min(c.batch, perProducer - n);
+        std::vector<std::string> payloads(count, std::string(c.payload, 'x'));
+        // 同一批的时间戳在放入时统一设置
+        int64_t sent = nowNanos();
+        batch.reserve(count);
+        for (auto& payload : payloads)
+        {
+          batch.emplace_back([s, sent, payload = std::move(payload)] { s->onTask(sent); });
+        }
+        pool.runBatch(std::move(batch));
+        batch.clear();
+      }
+    }, "producer"));
+  }
+
+  int64_t start = gate.open();
+  for (auto& thr : producers)
+  {
+    thr->join();
+  }
+  state.finished.wait();
+  double seconds = static_cast<double>(nowNanos() - start) / 1e9;
+  pool.stop();
+  reporter->report(name, c, state.total, seconds, state.latency);
+}
+
+bool selected(const char* name, const char* filter)
+{
+  return filter == nullptr || strstr(name, filter) != nullptr;
+}
+
+void runAll(const Config& c, const char* filter, Reporter* reporter)
+{
+  typedef muduo::BlockingQueueForThreadPool<Item> PoolQueue;
+  typedef muduo::PriorityBlockingQueue<Item> PriorityQueue;
+
+#define BENCH_QUEUE(name, Adapter) \
+  if (selected(name, filter)) benchQueue<Adapter>(name, c, reporter)
+
+  BENCH_QUEUE("BlockingQueue", BlockingAdapter);
+  BENCH_QUEUE("BlockingQueue/spin", SpinningBlockingAdapter);
+  BENCH_QUEUE("BoundedBlockingQueue", BoundedAdapter);
+  BENCH_QUEUE("BlockingQueueForThreadPool", ThreadPoolQueueAdapter<PoolQueue>);
+  BENCH_QUEUE("PriorityBlockingQueue", ThreadPoolQueueAdapter<PriorityQueue>);
+  BENCH_QUEUE("MpmcRingQueue", RingAdapter);
+  BENCH_QUEUE("LockFreeQueue", LockFreeAdapter);
+#undef BENCH_QUEUE
+
+  typedef muduo::ThreadPool Pool;
+  struct PoolVariant
+  {
+    const char* name;
+    std::function<void(Pool*)> setup;
+  } pools[] = {
+    { "ThreadPool/blocking", [](Pool*) {} },
+    { "ThreadPool/blocking+spin", [](Pool* p) {
+        p->setWaitStrategy(muduo::WaitStrategy::spinThenPark()); } },
+    { "ThreadPool/ring", [](Pool* p) {
+        p->setQueueBackend(muduo::SyncQueueBase::kRingQueue);
+        p->setMaxQueueSize(kCapacity); } },
+    { "ThreadPool/priority", [](Pool* p) {
+        p->setQueueBackend(muduo::SyncQueueBase::kPriorityQueue);
+        p->setMaxQueueSize(kCapacity); } },
+    { "ThreadPool/workstealing", [](Pool* p) {
+        p->setMode(Pool::kWorkStealing); } },
+  };
+  for (const auto& pool : pools)
+  {
+    if (selected(pool.name, filter))
+    {
+      benchPool(pool.name, c, pool.setup, reporter);
+    }
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  bool json = false;
+  bool quick = false;
+  int items = 0;
+  const char* filter = nullptr;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "--json") == 0)
+      json = true;
+    else if (strcmp(argv[i], "--quick") == 0)
+      quick = true;
+    else if (strncmp(argv[i], "--items=", 8) == 0)
+      items = atoi(argv[i] + 8);
+    else if (strncmp(argv[i], "--filter=", 9) == 0)
+      filter = argv[i] + 9;
+    else
+    {
+      fprintf(stderr, "usage: %s [--json] [--quick] [--items=N] [--filter=substring]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  std::vector<int> threads = quick ? std::vector<int>{1, 2} : std::vector<int>{1, 2, 4, 8};
+  std::vector<int> payloads = quick ? std::vector<int>{16} : std::vector<int>{16, 256, 4096};
+  std::vector<int> batches = quick ? std::vector<int>{1, 16} : std::vector<int>{1, 16, 128};
+  if (items <= 0)
+  {
+    items = quick ? 20000 : 200000;
+  }
+
+  Reporter reporter(json);
+  for (int producers : threads)
+    for (int consumers : threads)
+      for (int payload : payloads)
+        for (int batch : batches)
+        {
+          Config c = { producers, consumers, payload, batch, items };
+          runAll(c, filter, &reporter);
+        }
+}
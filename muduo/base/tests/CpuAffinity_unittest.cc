@@ -0,0 +1,88 @@
+#include <muduo/base/CpuAffinity.h>
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/ThreadPool.h>
+
+#include <assert.h>
+#include <sched.h>
+#include <stdio.h>
+
+using muduo::CpuAffinity;
+
+typedef std::vector<int> Cpus;
+
+void testParse()
+{
+  Cpus cpus;
+  assert(CpuAffinity::parseCpuList("0-3,8,10-11\n", &cpus));
+  assert(cpus == Cpus({0, 1, 2, 3, 8, 10, 11}));
+  assert(CpuAffinity::parseCpuList("", &cpus) && cpus.empty());
+  assert(CpuAffinity::parseCpuList("5", &cpus) && cpus == Cpus({5}));
+  assert(!CpuAffinity::parseCpuList("3-1", &cpus));
+  assert(!CpuAffinity::parseCpuList("a", &cpus));
+  assert(!CpuAffinity::parseCpuList("1;2", &cpus));
+}
+
+void testPolicies()
+{
+  // 两个 node，CPU 数不同
+  CpuAffinity::Nodes nodes = { {0, 1, 2, 3}, {4, 5} };
+
+  CpuAffinity none;
+  assert(none.cpusFor(0, nodes).empty());
+
+  CpuAffinity compact = CpuAffinity::compact();
+  assert(compact.cpusFor(0, nodes) == Cpus({0}));
+  assert(compact.cpusFor(3, nodes) == Cpus({3}));
+  assert(compact.cpusFor(4, nodes) == Cpus({4}));
+  assert(compact.cpusFor(6, nodes) == Cpus({0}));
+
+  CpuAffinity scatter = CpuAffinity::scatter();
+  int expected[] = { 0, 4, 1, 5, 2, 3, 0 };
+  for (int i = 0; i < 7; ++i)
+  {
+    assert(scatter.cpusFor(i, nodes) == Cpus({expected[i]}));
+  }
+
+  CpuAffinity perNode = CpuAffinity::perNode();
+  assert(perNode.cpusFor(0, nodes) == nodes[0]);
+  assert(perNode.cpusFor(1, nodes) == nodes[1]);
+  assert(perNode.cpusFor(2, nodes) == nodes[0]);
+
+  CpuAffinity list = CpuAffinity::explicitCpus({7, 9});
+  assert(list.cpusFor(0, nodes) == Cpus({7}));
+  assert(list.cpusFor(3, nodes) == Cpus({9}));
+  (void)expected;
+}
+
+void testSystem()
+{
+  const CpuAffinity::Nodes& nodes = CpuAffinity::systemNodes();
+  assert(!nodes.empty() && !nodes[0].empty());
+  printf("%zu numa node(s), node 0 has %zu cpu(s)\n", nodes.size(), nodes[0].size());
+
+  // 在线程池里绑核，每个 worker 应该跑在分配给它的 CPU 上
+  muduo::ThreadPool pool("Pinned");
+  pool.setAffinity(CpuAffinity::scatter().setLocalAlloc(true));
+  pool.start(2);
+  muduo::CountDownLatch latch(2);
+  for (int i = 0; i < 2; ++i)
+  {
+    pool.run([&latch] {
+      int cpu = CpuAffinity::currentCpu();
+      assert(cpu == ::sched_getcpu());
+      assert(CpuAffinity::nodeOfCpu(cpu) >= 0);
+      (void)cpu;
+      latch.countDown();
+    });
+  }
+  latch.wait();
+  pool.stop();
+}
+
+int main()
+{
+  testParse();
+  testPolicies();
+  testSystem();
+  printf("All passed\n");
+}
@@ -1,5 +1,6 @@
 #include <muduo/base/Date.h>
 #include <assert.h>
+#include <time.h>
 #include <stdio.h>
 
 using muduo::Date;
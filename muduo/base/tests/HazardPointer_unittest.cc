@@ -0,0 +1,79 @@
+// 超过一块 record 的线程同时持有 HazardPointer：record 表要能扩展，
+// collect() 要看到所有块里登记的指针；LockFreeQueue 在这么多线程下不丢不重。
+
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/HazardPointer.h>
+#include <muduo/base/LockFreeQueue.h>
+#include <muduo/base/Thread.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+
+using namespace muduo;
+
+// 多于原来固定的 512 个 record
+const int kThreads = 600;
+const int kPerThread = 100;
+
+int main()
+{
+  std::vector<int> slots(kThreads);
+  LockFreeQueue<int> queue;
+  CountDownLatch published(kThreads);
+  CountDownLatch done(1);
+  std::vector<int> popped(kThreads * kPerThread, 0);
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int i = 0; i < kThreads; ++i)
+  {
+    threads.emplace_back(new Thread([&, i] {
+      for (int j = 0; j < kPerThread; ++j)
+      {
+        queue.push(i * kPerThread + j);
+      }
+      for (int j = 0; j < kPerThread; ++j)
+      {
+        std::optional<int> v = queue.pop();
+        if (v)
+        {
+          // 每个值由哪个线程取到不确定，但只能取到一次
+          __atomic_fetch_add(&popped[*v], 1, __ATOMIC_RELAXED);
+        }
+      }
+      // 所有线程同时持有一个登记了的 record
+      HazardPointer hp;
+      hp.set(&slots[i]);
+      published.countDown();
+      done.wait();
+    }, "hazard"));
+  }
+  published.wait();
+
+  printf("%d records for %d threads\n", HazardPointer::numRecords(), kThreads);
+  assert(HazardPointer::numRecords() >= kThreads);
+  std::vector<const void*> hazards;
+  HazardPointer::collect(&hazards);
+  for (int i = 0; i < kThreads; ++i)
+  {
+    assert(std::binary_search(hazards.begin(), hazards.end(), &slots[i]));
+  }
+  done.countDown();
+  for (auto& thr : threads)
+  {
+    thr->join();
+  }
+
+  while (std::optional<int> v = queue.pop())
+  {
+    ++popped[*v];
+  }
+  for (int count : popped)
+  {
+    assert(count == 1);
+    (void)count;
+  }
+  printf("%d values popped exactly once\n", kThreads * kPerThread);
+}
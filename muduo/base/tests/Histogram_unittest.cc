@@ -0,0 +1,51 @@
+#include <muduo/base/Histogram.h>
+
+#include <assert.h>
+#include <stdio.h>
+
+using muduo::Histogram;
+
+void testBuckets()
+{
+  // 每个值都落在上界不小于它、且相对误差不超过 1/8 的桶里
+  for (int64_t v = 0; v < 1000000; v += (v < 1000 ? 1 : 997))
+  {
+    int bucket = Histogram::bucketOf(v);
+    int64_t upper = Histogram::upperBoundOf(bucket);
+    assert(upper >= v);
+    assert(upper - v <= v / 8 + 1);
+    assert(bucket == 0 || Histogram::upperBoundOf(bucket - 1) < v);
+    (void)upper;
+  }
+  assert(Histogram::bucketOf(-1) == 0);
+  assert(Histogram::bucketOf(INT64_MAX) == Histogram::kNumBuckets - 1);
+}
+
+void testPercentile()
+{
+  Histogram h;
+  assert(h.percentile(50) == 0);
+  for (int64_t v = 1; v <= 1000; ++v)
+  {
+    h.add(v);
+  }
+  assert(h.count() == 1000);
+  assert(h.max() == 1000);
+  int64_t p50 = h.percentile(50);
+  int64_t p99 = h.percentile(99);
+  assert(p50 >= 500 && p50 <= 500 + 500 / 8);
+  assert(p99 >= 990 && p99 <= 1000);
+  assert(h.percentile(100) == 1000);
+  printf("%s\n", h.toString().c_str());
+  (void)p50;
+  (void)p99;
+
+  h.reset();
+  assert(h.count() == 0 && h.max() == 0);
+}
+
+int main()
+{
+  testBuckets();
+  testPercentile();
+}
@@ -0,0 +1,141 @@
+#include <muduo/base/InplaceFunction.h>
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/ThreadPool.h>
+#include <muduo/base/Timestamp.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// 统计全局 operator new 的调用次数
+std::atomic<int64_t> g_allocations(0);
+
+void* operator new(size_t size)
+{
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  void* p = malloc(size);
+  if (p == nullptr)
+  {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) noexcept
+{
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+  free(p);
+}
+
+const int kTasks = 1000 * 1000;
+
+// 模拟 TcpConnection::send 跨线程的捕获：一个 shared_ptr 加一个 string
+struct Connection
+{
+  int64_t bytes = 0;
+  void send(const std::string& message) { bytes += static_cast<int64_t>(message.size()); }
+};
+
+template<typename Function>
+void benchFunction(const char* name)
+{
+  std::shared_ptr<Connection> conn(new Connection);
+  std::string message(40, 'x');
+  std::vector<Function> queue;
+  queue.reserve(kTasks);
+
+  int64_t before = g_allocations.load();
+  muduo::Timestamp start(muduo::Timestamp::now());
+  for (int i = 0; i < kTasks; ++i)
+  {
+    // message 拷贝本身也会分配一次，两边相同
+    queue.push_back([conn, message] { conn->send(message); });
+  }
+  for (auto& f : queue)
+  {
+    Function task(std::move(f));
+    task();
+  }
+  double seconds = timeDifference(muduo::Timestamp::now(), start);
+  int64_t allocations = g_allocations.load() - before;
+  printf("%-24s %.2f allocations/task %6.1f ns/task\n", name,
+         static_cast<double>(allocations) / kTasks, seconds * 1e9 / kTasks);
+  assert(conn->bytes == static_cast<int64_t>(kTasks) * 40);
+}
+
+void benchThreadPool()
+{
+  muduo::ThreadPool pool("BenchPool");
+  pool.start(1);
+  std::shared_ptr<Connection> conn(new Connection);
+  std::string message(40, 'x');
+  muduo::CountDownLatch latch(1);
+  std::atomic<int> done(0);
+
+  int64_t before = g_allocations.load();
+  muduo::Timestamp start(muduo::Timestamp::now());
+  for (int i = 0; i < kTasks; ++i)
+  {
+    pool.run([conn, message, &latch, &done] {
+      conn->send(message);
+      if (++done == kTasks)
+      {
+        latch.countDown();
+      }
+    });
+  }
+  latch.wait();
+  double seconds = timeDifference(muduo::Timestamp::now(), start);
+  int64_t allocations = g_allocations.load() - before;
+  printf("%-24s %.2f allocations/task %6.1f ns/task\n", "ThreadPool::run",
+         static_cast<double>(allocations) / kTasks, seconds * 1e9 / kTasks);
+  pool.stop();
+}
+
+void testSemantics()
+{
+  typedef muduo::InplaceFunction<int(int)> Function;
+
+  Function empty;
+  assert(!empty);
+
+  // move-only capture
+  std::unique_ptr<int> p(new int(42));
+  Function f([p = std::move(p)](int x) { return *p + x; });
+  assert(f && f.isInline());
+  assert(f(1) == 43);
+
+  Function g(std::move(f));
+  assert(!f && g(2) == 44);
+
+  // too large for the inline buffer
+  char big[128] = { 1 };
+  Function h([big](int x) { return big[0] + x; });
+  assert(h && !h.isInline());
+  assert(h(1) == 2);
+  g = std::move(h);
+  assert(g(2) == 3);
+
+  int (*fp)(int) = nullptr;
+  Function null(fp);
+  assert(!null);
+  (void)null;
+}
+
+int main()
+{
+  testSemantics();
+  benchFunction<std::function<void()>>("std::function");
+  benchFunction<muduo::InplaceFunction<void()>>("InplaceFunction");
+  benchThreadPool();
+}
@@ -0,0 +1,189 @@
+#include <muduo/base/InplaceFunction.h>
+
+#include <memory>
+
+#include <assert.h>
+#include <stdio.h>
+
+using muduo::InplaceFunction;
+
+typedef InplaceFunction<int(int)> Function;
+
+// 统计活着的对象个数，检查 move 之后既没有重复析构也没有泄漏
+struct Tracker
+{
+  static int live;
+
+  Tracker() { ++live; }
+  Tracker(const Tracker&) { ++live; }
+  Tracker(Tracker&&) noexcept { ++live; }
+  ~Tracker() { --live; }
+};
+
+int Tracker::live = 0;
+
+// sizeof(Sized<N>) == N
+template<size_t N>
+struct Sized
+{
+  Tracker tracker;
+  char pad[N - sizeof(Tracker)] = {};
+
+  int operator()(int x) { return x + pad[0] + static_cast<int>(N); }
+};
+
+static_assert(sizeof(Sized<64>) == 64, "Sized<64>");
+static_assert(sizeof(Sized<65>) == 65, "Sized<65>");
+
+// 小而 move 可能抛异常的，也放在堆上
+struct ThrowingMove
+{
+  ThrowingMove() = default;
+  ThrowingMove(ThrowingMove&&) {}
+  int operator()(int x) { return -x; }
+};
+
+void testBoundary()
+{
+  {
+    Function f{Sized<64>()};
+    Function g{Sized<65>()};
+    Function h{ThrowingMove()};
+    assert(f.isInline());
+    assert(!g.isInline());
+    assert(!h.isInline());
+    assert(f(1) == 65);
+    assert(g(1) == 66);
+    assert(h(1) == -1);
+    // 临时对象都已析构，各剩一份
+    assert(Tracker::live == 2);
+  }
+  assert(Tracker::live == 0);
+}
+
+void testMove(bool large)
+{
+  {
+    Function f = large ? Function(Sized<65>()) : Function(Sized<64>());
+    assert(f.isInline() == !large);
+    const int expected = f(0);
+    assert(Tracker::live == 1);
+
+    // move 构造
+    Function g(std::move(f));
+    assert(!f);
+    assert(!f.isInline());
+    assert(g.isInline() == !large);
+    assert(g(0) == expected);
+    assert(Tracker::live == 1);
+
+    // move 赋值给空的
+    f = std::move(g);
+    assert(!g);
+    assert(f(0) == expected);
+    assert(Tracker::live == 1);
+
+    // move 赋值覆盖非空的，原来的析构掉
+    Function h{Sized<64>()};
+    Function k{Sized<65>()};
+    assert(Tracker::live == 3);
+    h = std::move(f);
+    assert(Tracker::live == 2);
+    assert(h(0) == expected);
+    k = std::move(h);
+    assert(Tracker::live == 1);
+    assert(k(0) == expected);
+
+    // 自己 move 给自己不变
+    Function& self = k;
+    k = std::move(self);
+    assert(k);
+    assert(k(0) == expected);
+    assert(Tracker::live == 1);
+
+    // inline 与堆上的交换
+    Function other = large ? Function(Sized<64>()) : Function(Sized<65>());
+    other.swap(k);
+    assert(other(0) == expected);
+    assert(k.isInline() == large);
+    assert(Tracker::live == 2);
+
+    // 赋值 nullptr 立即析构
+    k = nullptr;
+    assert(!k);
+    assert(Tracker::live == 1);
+    (void)expected;
+  }
+  assert(Tracker::live == 0);
+}
+
+void testMoveOnly()
+{
+  std::unique_ptr<int> small(new int(42));
+  Function f([p = std::move(small)](int x) { return *p + x; });
+  assert(f.isInline());
+  assert(f(1) == 43);
+
+  std::unique_ptr<int> big(new int(7));
+  char pad[100] = {};
+  Function g([p = std::move(big), pad](int x) { return *p + x + pad[0]; });
+  assert(!g.isInline());
+  assert(g(1) == 8);
+
+  Function h(std::move(g));
+  assert(h(2) == 9);
+  f = std::move(h);
+  assert(f(3) == 10);
+}
+
+bool callThrows(const Function& f)
+{
+  try
+  {
+    f(0);
+  }
+  catch (const std::bad_function_call&)
+  {
+    return true;
+  }
+  return false;
+}
+
+void testEmpty()
+{
+  Function f;
+  assert(!f);
+  assert(!f.isInline());
+  assert(callThrows(f));
+
+  Function g(nullptr);
+  assert(!g);
+  assert(callThrows(g));
+
+  // 空的函数指针和空的 std::function 也得到空的 InplaceFunction
+  int (*fp)(int) = nullptr;
+  Function h(fp);
+  assert(!h);
+  assert(callThrows(h));
+
+  std::function<int(int)> sf;
+  Function k(sf);
+  assert(!k);
+  assert(callThrows(k));
+
+  // move 之后的源对象是空的
+  Function m([](int x) { return x; });
+  Function n(std::move(m));
+  assert(callThrows(m));
+  assert(!callThrows(n));
+}
+
+int main()
+{
+  testBoundary();
+  testMove(false);
+  testMove(true);
+  testMoveOnly();
+  testEmpty();
+  printf("All tests passed\n");
+}
@@ -1,8 +1,13 @@
 #include <muduo/base/LockFreeQueue.h>
+#include <muduo/base/LockFree.h>
+#include <muduo/base/tests/RefCountLockFreeQueue.h>
 #include <iostream>
 #include <thread>
 #include <vector>
 #include <functional>
+#include <chrono>
+#include <optional>
+#include <assert.h>
 
 using Task = std::function<void()>;
 
@@ -16,7 +21,7 @@ void producer(muduo::LockFreeQueue<Task> &queue, int id) {
 void consumer(muduo::LockFreeQueue<Task> &queue, int id) {
   for (int i = 0; i < 1000; ++i) {
     while (true) {
-      std::unique_ptr<Task> task = queue.pop();
+      std::optional<Task> task = queue.pop();
       if (task) {
         (*task)();
         printf("Consumer %d executed task\n", id);
@@ -29,6 +34,79 @@ void consumer(muduo::LockFreeQueue<Task> &queue, int id) {
   }
 }
 
+// 元素统一转成 std::optional<int>，兼容新旧两个版本的 pop() 返回值
+std::optional<int> popInt(muduo::LockFreeQueue<int> &queue) {
+  return queue.pop();
+}
+
+std::optional<int> popInt(muduo::RefCountLockFreeQueue<int> &queue) {
+  std::unique_ptr<int> p = queue.pop();
+  return p ? std::optional<int>(*p) : std::nullopt;
+}
+
+// 多生产者多消费者争用，统计出队的元素；生产者结束后队列仍为空则认为元素丢失
+template<typename Queue>
+int64_t bench(const char *name, int numThreads) {
+  const int perThread = 400000 / numThreads;
+  const int64_t total = static_cast<int64_t>(numThreads) * perThread;
+  Queue queue;
+  std::atomic<int64_t> popped(0);
+  std::atomic<int> producing(numThreads);
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < numThreads; ++i) {
+    threads.emplace_back([&queue, &producing, perThread] {
+      for (int j = 1; j <= perThread; ++j) {
+        queue.push(j);
+      }
+      --producing;
+    });
+    threads.emplace_back([&queue, &popped, &producing, total] {
+      while (popped < total) {
+        if (popInt(queue)) {
+          ++popped;
+        } else if (producing == 0 && !popInt(queue)) {
+          break;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto &thr : threads) {
+    thr.join();
+  }
+  auto end = std::chrono::steady_clock::now();
+  printf("%-24s %2d producers %2d consumers %6ld ms, lost %ld\n", name, numThreads, numThreads,
+         static_cast<long>(std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()),
+         static_cast<long>(total - popped));
+  return total - popped;
+}
+
+void testStack() {
+  muduo::lock_free_stack<int> stack;
+  std::vector<std::thread> threads;
+  std::atomic<int> popped(0);
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&stack, &popped] {
+      for (int j = 0; j < 100000; ++j) {
+        stack.push(j);
+        if (stack.pop()) {
+          ++popped;
+        }
+      }
+    });
+  }
+  for (auto &thr : threads) {
+    thr.join();
+  }
+  while (stack.pop()) {
+    ++popped;
+  }
+  assert(popped == 400000);
+  printf("lock_free_stack popped %d\n", popped.load());
+}
+
 int main() {
   muduo::LockFreeQueue<Task> queue;
 
@@ -52,7 +130,7 @@ int main() {
   // queue.pop();
   // queue.pop();
 
-  // std::unique_ptr<Task> task = queue.pop();
+  // std::optional<Task> task = queue.pop();
   // if (task) {
   //   (*task)();
   //   printf("executed task\n");
@@ -83,5 +161,14 @@ int main() {
     consumer_thread.join();
   }
 
+  testStack();
+
+  for (int n = 1; n <= 8; n *= 2) {
+    int64_t lost = bench<muduo::LockFreeQueue<int>>("hazard pointer", n);
+    assert(lost == 0);
+    (void)lost;
+    bench<muduo::RefCountLockFreeQueue<int>>("split refcount", n);
+  }
+
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,99 @@
+// MpscQueue：多个生产者各 push 一串节点，一个消费者 pop，
+// 每个节点恰好取到一次，同一个生产者的节点保持 push 的顺序。
+// pop() 在 push 进行到一半时可能返回 nullptr，消费者继续重试。
+
+#include <muduo/base/MpscQueue.h>
+#include <muduo/base/Thread.h>
+
+#include <memory>
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+
+using namespace muduo;
+
+struct Node
+{
+  std::atomic<Node*> mpscNext;
+  int producer = -1;
+  int seq = -1;
+};
+
+void testEmpty()
+{
+  MpscQueue<Node> queue;
+  assert(queue.pop() == nullptr);
+  Node a, b;
+  queue.push(&a);
+  assert(queue.pop() == &a);
+  assert(queue.pop() == nullptr);
+  // 取空之后哨兵重新入队，还能继续使用
+  queue.push(&a);
+  queue.push(&b);
+  assert(queue.pop() == &a);
+  assert(queue.pop() == &b);
+  assert(queue.pop() == nullptr);
+}
+
+void testProducers(int numProducers, int perProducer)
+{
+  MpscQueue<Node> queue;
+  std::vector<std::unique_ptr<Node[]>> nodes;
+  for (int p = 0; p < numProducers; ++p)
+  {
+    nodes.emplace_back(new Node[perProducer]);
+  }
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int p = 0; p < numProducers; ++p)
+  {
+    threads.emplace_back(new Thread([&queue, &nodes, p, perProducer] {
+      for (int i = 0; i < perProducer; ++i)
+      {
+        Node* node = &nodes[p][i];
+        node->producer = p;
+        node->seq = i;
+        queue.push(node);
+      }
+    }, "producer"));
+  }
+
+  std::vector<int> next(numProducers, 0);
+  int64_t total = static_cast<int64_t>(numProducers) * perProducer;
+  int64_t received = 0;
+  int64_t nulls = 0;
+  while (received < total)
+  {
+    Node* node = queue.pop();
+    if (node == nullptr)
+    {
+      ++nulls;
+      continue;
+    }
+    // 同一个生产者的节点按顺序到达，不重复不遗漏
+    assert(node->producer >= 0 && node->producer < numProducers);
+    assert(node->seq == next[node->producer]);
+    ++next[node->producer];
+    ++received;
+  }
+  for (auto& thr : threads)
+  {
+    thr->join();
+  }
+  assert(queue.pop() == nullptr);
+  for (int n : next)
+  {
+    assert(n == perProducer);
+    (void)n;
+  }
+  printf("%d producers x %d nodes, %lld empty pops\n",
+         numProducers, perProducer, static_cast<long long>(nulls));
+}
+
+int main()
+{
+  testEmpty();
+  testProducers(1, 1000000);
+  testProducers(8, 200000);
+  testProducers(64, 10000);
+}
@@ -1,4 +1,6 @@
 #include <muduo/base/ThreadPool.h>
+#include <muduo/base/LockFreeQueue.h>
+#include <muduo/base/tests/RefCountLockFreeQueue.h>
 #include <muduo/base/CountDownLatch.h>
 #include <muduo/base/CurrentThread.h>
 #include <muduo/base/Logging.h>
@@ -56,6 +58,172 @@ void onDelete(int divide) {
   }
 }
 
+// 模拟 sudoku 的 CPU offload：若干 IO 线程向线程池提交小任务，
+// 每个任务里可能再向线程池提交子任务（fan-out），统计不同线程数下的吞吐量。
+const int kPoolTasks = 200000;
+const int kPoolProducers = 4;
+
+void spin(int n) {
+  volatile int x = 0;
+  for (int i = 0; i < n; ++i) {
+    x = x + i;
+  }
+}
+
+int BenchThreadPool(muduo::ThreadPool::Mode mode, int numThreads,
+                    muduo::SyncQueueBase::Backend backend = muduo::SyncQueueBase::kBlockingQueue) {
+  muduo::ThreadPool pool("BenchPool");
+  pool.setMode(mode);
+  pool.setQueueBackend(backend);
+  pool.start(numThreads);
+
+  const int total = kPoolTasks * 2;
+  muduo::CountDownLatch latch(1);
+  std::atomic<int> done(0);
+  auto finish = [&] {
+    if (++done == total) {
+      latch.countDown();
+    }
+  };
+
+  auto t1 = std::chrono::steady_clock::now();
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kPoolProducers; ++p) {
+    producers.emplace_back([&] {
+      for (int i = 0; i < kPoolTasks / kPoolProducers; ++i) {
+        pool.run([&] {
+          spin(200);
+          pool.run([&] {
+            spin(200);
+            finish();
+          });
+          finish();
+        });
+      }
+    });
+  }
+  for (auto& thr : producers) {
+    thr.join();
+  }
+  latch.wait();
+  auto t2 = std::chrono::steady_clock::now();
+  pool.stop();
+  return std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
+}
+
+void TestThreadPoolScaling() {
+  std::cout << "ThreadPool scaling, " << kPoolTasks * 2 << " tasks, "
+            << kPoolProducers << " producers\n";
+  std::cout << "threads\tshared(ms)\tring(ms)\tstealing(ms)\n";
+  for (int n = 1; n <= kMaxThreads; n *= 2) {
+    int shared = BenchThreadPool(muduo::ThreadPool::kSharedQueue, n);
+    int ring = BenchThreadPool(muduo::ThreadPool::kSharedQueue, n,
+                               muduo::SyncQueueBase::kRingQueue);
+    int stealing = BenchThreadPool(muduo::ThreadPool::kWorkStealing, n);
+    std::cout << n << "\t" << shared << "\t\t" << ring << "\t\t" << stealing << "\n";
+  }
+  std::cout << "\n";
+}
+
+// 数据并行：把 kBatchItems 个元素分成小块，比较逐个 run()、runBatch() 和 parallelFor()
+const int kBatchItems = 1000000;
+const int kGrain = 100;
+
+int BenchBatch(int numThreads, int how) {
+  muduo::ThreadPool pool("BatchPool");
+  pool.start(numThreads);
+  std::vector<int> data(kBatchItems);
+  auto chunk = [&data](int first) {
+    for (int i = first; i < first + kGrain; ++i) {
+      data[i] = i;
+    }
+  };
+
+  auto t1 = std::chrono::steady_clock::now();
+  if (how == 2) {
+    pool.parallelFor(0, kBatchItems, kGrain, [&data](int i) { data[i] = i; });
+  } else {
+    muduo::CountDownLatch latch(kBatchItems / kGrain);
+    if (how == 0) {
+      for (int first = 0; first < kBatchItems; first += kGrain) {
+        pool.run([&chunk, &latch, first] { chunk(first); latch.countDown(); });
+      }
+    } else {
+      std::vector<muduo::ThreadPool::Task> tasks;
+      tasks.reserve(kBatchItems / kGrain);
+      for (int first = 0; first < kBatchItems; first += kGrain) {
+        tasks.emplace_back([&chunk, &latch, first] { chunk(first); latch.countDown(); });
+      }
+      pool.runBatch(std::move(tasks));
+    }
+    latch.wait();
+  }
+  auto t2 = std::chrono::steady_clock::now();
+  pool.stop();
+  return std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
+}
+
+void TestBatchSubmit() {
+  std::cout << "Data-parallel, " << kBatchItems << " items, grain " << kGrain << "\n";
+  std::cout << "threads\trun(ms)\t\trunBatch(ms)\tparallelFor(ms)\n";
+  for (int n = 1; n <= kMaxThreads; n *= 2) {
+    int run = BenchBatch(n, 0);
+    int batch = BenchBatch(n, 1);
+    int parallel = BenchBatch(n, 2);
+    std::cout << n << "\t" << run << "\t\t" << batch << "\t\t" << parallel << "\n";
+  }
+  std::cout << "\n";
+}
+
+// 无锁队列本身的争用开销：N 个生产者、N 个消费者，非阻塞 push/pop
+const int kQueueOps = 1000000;
+
+bool TryPop(muduo::LockFreeQueue<int>& queue) {
+  return queue.pop().has_value();
+}
+
+bool TryPop(muduo::RefCountLockFreeQueue<int>& queue) {
+  return queue.pop() != nullptr;
+}
+
+template<typename Queue>
+int BenchLockFreeQueue(int numThreads) {
+  Queue queue;
+  const int perThread = kQueueOps / numThreads;
+  std::vector<std::thread> threads;
+  auto t1 = std::chrono::steady_clock::now();
+  for (int i = 0; i < numThreads; ++i) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < perThread; ++j) {
+        queue.push(j);
+      }
+    });
+    threads.emplace_back([&] {
+      for (int j = 0; j < perThread; ++j) {
+        while (!TryPop(queue)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto& thr : threads) {
+    thr.join();
+  }
+  auto t2 = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
+}
+
+void TestLockFreeQueues() {
+  std::cout << "LockFreeQueue contention, " << kQueueOps << " elements\n";
+  std::cout << "threads\thazard(ms)\trefcount(ms)\n";
+  for (int n = 1; n <= kMaxThreads; n *= 2) {
+    int hazard = BenchLockFreeQueue<muduo::LockFreeQueue<int>>(n);
+    int refcount = BenchLockFreeQueue<muduo::RefCountLockFreeQueue<int>>(n);
+    std::cout << n << "\t" << hazard << "\t\t" << refcount << "\n";
+  }
+  std::cout << "\n";
+}
+
 void TestConcurrentInsert() {
   //int old_size = q.size();
   std::vector<std::thread> threads;
@@ -147,8 +315,18 @@ void TestConcurrentInsertAndDequeue() {
 }
 
 int main(int argc, char const* argv[]) {
-  (void)argc;
-  (void)argv;
+  if (argc > 1 && std::string(argv[1]) == "ring") {
+    // 插入测试中没有消费者，环形队列必须能装下全部元素
+    q.setBackend(muduo::SyncQueueBase::kRingQueue);
+    q.setMaxSize(kElements3);
+  }
+  std::cout << "SyncQueue backend: "
+            << (q.backend() == muduo::SyncQueueBase::kRingQueue ? "ring" : "blocking")
+            << "\n";
+
+  TestThreadPoolScaling();
+  TestBatchSubmit();
+  TestLockFreeQueues();
 
   std::cout << "Benchmark with " << kMaxThreads << " threads:"
             << "\n";
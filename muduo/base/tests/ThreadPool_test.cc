@@ -24,10 +24,13 @@ void longTask(int num)
 }
 
 
-void test(int maxSize)
+void test(int maxSize,
+          muduo::SyncQueueBase::Backend backend = muduo::SyncQueueBase::kBlockingQueue)
 {
-  LOG_WARN << "Test ThreadPool with max queue size = " << maxSize;
+  LOG_WARN << "Test ThreadPool with max queue size = " << maxSize
+           << ", backend = " << backend;
   muduo::ThreadPool pool("MainThreadPool");
+  pool.setQueueBackend(backend);
   pool.setMaxQueueSize(maxSize);
   pool.start(5);
 
@@ -76,6 +79,196 @@ void test2()
   LOG_WARN << "test2 Done";
 }
 
+void testWorkStealing(int maxSize)
+{
+  LOG_WARN << "Test work-stealing ThreadPool with max queue size = " << maxSize;
+  muduo::ThreadPool pool("StealingPool");
+  pool.setMode(muduo::ThreadPool::kWorkStealing);
+  pool.setMaxQueueSize(maxSize);
+  pool.run(print);  // before start()
+  pool.start(4);
+
+  const int kTasks = 1000;
+  muduo::CountDownLatch latch(kTasks * 2);
+  for (int i = 0; i < kTasks; ++i)
+  {
+    pool.run([&pool, &latch]
+    {
+      // submitted from a worker, goes to its local deque
+      pool.run(std::bind(&muduo::CountDownLatch::countDown, &latch));
+      latch.countDown();
+    });
+  }
+  latch.wait();
+  LOG_WARN << "now queueSize = " << pool.queueSize();
+  assert(pool.queueSize() == 0);
+  pool.stop();
+}
+
+void testSubmit(muduo::ThreadPool::Mode mode)
+{
+  LOG_WARN << "Test submit/runBatch/parallelFor, mode = " << mode;
+  muduo::ThreadPool pool("SubmitPool");
+  pool.setMode(mode);
+  pool.start(4);
+
+  muduo::Future<int> f1 = pool.submit([] { return 42; });
+  muduo::Future<std::string> f2 = pool.submit([] { return std::string("hello"); });
+  muduo::Future<void> f3 = pool.submit([] { throw std::runtime_error("oops"); });
+  assert(f1.get() == 42);
+  assert(f2.get() == "hello");
+  bool caught = false;
+  try
+  {
+    f3.get();
+  }
+  catch (const std::runtime_error&)
+  {
+    caught = true;
+  }
+  assert(caught);
+  (void)caught;
+
+  const int kTasks = 1000;
+  muduo::CountDownLatch latch(kTasks);
+  std::vector<muduo::ThreadPool::Task> tasks;
+  for (int i = 0; i < kTasks; ++i)
+  {
+    tasks.emplace_back([&latch] { latch.countDown(); });
+  }
+  pool.runBatch(std::move(tasks));
+  latch.wait();
+
+  std::vector<int> data(100000);
+  pool.parallelFor(0, static_cast<int>(data.size()), 1000, [&data](int i) { data[i] = i; });
+  for (size_t i = 0; i < data.size(); ++i)
+  {
+    assert(data[i] == static_cast<int>(i));
+  }
+
+  // nested in a worker, the caller takes part so it cannot deadlock
+  std::atomic<int64_t> sum(0);
+  muduo::Future<void> nested = pool.submit([&pool, &sum]
+  {
+    pool.parallelFor<size_t>(0, 10000, 10, [&sum](size_t i) { sum += static_cast<int64_t>(i); });
+  });
+  nested.get();
+  assert(sum == 10000LL * 9999 / 2);
+  pool.stop();
+}
+
+void testPriorityAndDeadline()
+{
+  LOG_WARN << "Test priority and deadline";
+  muduo::ThreadPool pool("PriorityPool");
+  pool.setQueueBackend(muduo::SyncQueueBase::kPriorityQueue);
+  pool.start(1);
+
+  // 先让唯一的 worker 阻塞，再放入不同优先级的任务
+  muduo::CountDownLatch gate(1);
+  pool.run([&gate] { gate.wait(); });
+  muduo::CurrentThread::sleepUsec(10 * 1000);
+
+  std::vector<int> order;
+  for (int priority : { 1, 3, 2 })
+  {
+    muduo::ThreadPool::TaskOptions options;
+    options.priority = priority;
+    pool.run([&order, priority] { order.push_back(priority); }, std::move(options));
+  }
+
+  int dropped = 0;
+  muduo::ThreadPool::TaskOptions expired;
+  expired.priority = 10;
+  expired.deadline = muduo::addTime(muduo::Timestamp::now(), 0.001);
+  expired.onDrop = [&dropped](muduo::ThreadPool::DropReason reason)
+  {
+    assert(reason == muduo::ThreadPool::kExpired);
+    ++dropped;
+  };
+  pool.run([] { assert(false); }, std::move(expired));
+
+  muduo::CountDownLatch done(1);
+  muduo::ThreadPool::TaskOptions last;
+  last.priority = -1;
+  pool.run([&done] { done.countDown(); }, std::move(last));
+
+  muduo::CurrentThread::sleepUsec(10 * 1000);
+  gate.countDown();
+  done.wait();
+  assert((order == std::vector<int>{ 3, 2, 1 }));
+  assert(dropped == 1 && pool.droppedExpired() == 1);
+  pool.stop();
+}
+
+void testCoDel()
+{
+  LOG_WARN << "Test CoDel admission";
+  muduo::ThreadPool pool("CoDelPool");
+  pool.setAdmission(muduo::ThreadPool::kCoDel, 0.001, 0.01);
+  pool.start(1);
+
+  const int kTasks = 100;
+  muduo::CountDownLatch latch(kTasks);
+  int rejected = 0;
+  for (int i = 0; i < kTasks; ++i)
+  {
+    muduo::ThreadPool::TaskOptions options;
+    options.onDrop = [&latch](muduo::ThreadPool::DropReason) { latch.countDown(); };
+    bool admitted = pool.run([&latch]
+    {
+      muduo::CurrentThread::sleepUsec(2000);
+      latch.countDown();
+    }, std::move(options));
+    if (!admitted)
+    {
+      ++rejected;
+      latch.countDown();
+    }
+  }
+  latch.wait();
+  LOG_WARN << "dropped " << pool.droppedOverloaded() << ", rejected " << rejected;
+  // 每个任务 2ms，排队时间很快超过 target
+  assert(pool.droppedOverloaded() > 0);
+  pool.stop();
+}
+
+void testElastic()
+{
+  LOG_WARN << "Test elastic ThreadPool";
+  muduo::ThreadPool pool("ElasticPool");
+  pool.setElastic(1, 4, 0.01, 0.2);
+  pool.start(0);
+  assert(pool.numThreads() == 1);
+
+  // 阻塞型任务，一个线程处理不过来
+  const int kTasks = 8;
+  muduo::CountDownLatch latch(kTasks);
+  for (int i = 0; i < kTasks; ++i)
+  {
+    pool.run([&latch]
+    {
+      muduo::CurrentThread::sleepUsec(100 * 1000);
+      latch.countDown();
+    });
+  }
+  latch.wait();
+  LOG_WARN << "grown to " << pool.numThreads() << " threads, queue delay "
+           << pool.queueDelay().toString();
+  assert(pool.numThreads() > 1);
+  assert(pool.queueDelay().count() == kTasks);
+
+  muduo::CurrentThread::sleepUsec(600 * 1000);
+  LOG_WARN << "shrunk to " << pool.numThreads() << " threads";
+  assert(pool.numThreads() == 1);
+
+  // still works after shrinking
+  muduo::CountDownLatch done(1);
+  pool.run([&done] { done.countDown(); });
+  done.wait();
+  pool.stop();
+}
+
 int main()
 {
   test(0);
@@ -83,5 +276,14 @@ int main()
   test(5);
   test(10);
   test(50);
+  test(0, muduo::SyncQueueBase::kRingQueue);
+  test(4, muduo::SyncQueueBase::kRingQueue);
   test2();
+  testWorkStealing(0);
+  testWorkStealing(10);
+  testSubmit(muduo::ThreadPool::kSharedQueue);
+  testSubmit(muduo::ThreadPool::kWorkStealing);
+  testPriorityAndDeadline();
+  testCoDel();
+  testElastic();
 }
@@ -27,12 +27,14 @@ Acceptor::Acceptor(EventLoop* loop, const InetAddress& listenAddr, bool reusepor
     acceptSocket_(sockets::createNonblockingOrDie(listenAddr.family())), // 1. 调用socket(2)
     acceptChannel_(loop, acceptSocket_.fd()),
     listenning_(false),
+    maxAcceptsPerRead_(1),
     idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC))
 {
   assert(idleFd_ >= 0);
   acceptSocket_.setReuseAddr(true);
   acceptSocket_.setReusePort(reuseport);
   acceptSocket_.bindAddress(listenAddr); // 2. 调用bind(2)
+  acceptChannel_.setName("acceptor");
   acceptChannel_.setReadCallback(
       std::bind(&Acceptor::handleRead, this));
 }
@@ -55,36 +57,45 @@ void Acceptor::listen()
 void Acceptor::handleRead()
 {
   loop_->assertInLoopThread();
-  InetAddress peerAddr; // 存放对方的地址
-  // 每次仅accept(2)一个socket。muduo是为长连接服务优化的，因此这里用了最简单的办法。
-  int connfd = acceptSocket_.accept(&peerAddr); // 4. 调用accept(2)
-  if (connfd >= 0)
+  // 默认每次仅accept(2)一个socket。muduo是为长连接服务优化的，因此默认用了最简单的办法。
+  // 短连接多时可以用 setMaxAcceptsPerRead() 一次取完，以 EAGAIN 结束。
+  for (int i = 0; i < maxAcceptsPerRead_; ++i)
   {
-    // string hostport = peerAddr.toIpPort();
-    // LOG_TRACE << "Accepts of " << hostport;
-    if (newConnectionCallback_)
+    InetAddress peerAddr; // 存放对方的地址
+    int connfd = acceptSocket_.accept(&peerAddr); // 4. 调用accept(2)
+    if (connfd >= 0)
     {
-      // 这里直接把socket fd传给callback，这种传递int句柄的做法不够理想
-      // 在C++11中可以先创建Socket对象，再用移动语义把Socket对象std::move()给回调函数，确保资源的安全释放。
-      newConnectionCallback_(connfd, peerAddr);
+      // string hostport = peerAddr.toIpPort();
+      // LOG_TRACE << "Accepts of " << hostport;
+      if (newConnectionCallback_)
+      {
+        // 这里直接把socket fd传给callback，这种传递int句柄的做法不够理想
+        // 在C++11中可以先创建Socket对象，再用移动语义把Socket对象std::move()给回调函数，确保资源的安全释放。
+        newConnectionCallback_(connfd, peerAddr);
+      }
+      else
+      {
+        sockets::close(connfd);
+      }
     }
     else
     {
-      sockets::close(connfd);
-    }
-  }
-  else
-  {
-    LOG_SYSERR << "in Acceptor::handleRead";
-    // Read the section named "The special problem of
-    // accept()ing when you can't" in libev's doc.
-    // By Marc Lehmann, author of libev.
-    if (errno == EMFILE)
-    {
-      ::close(idleFd_);
-      idleFd_ = ::accept(acceptSocket_.fd(), NULL, NULL);
-      ::close(idleFd_);
-      idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+      if (errno == EAGAIN && i > 0)
+      {
+        break;
+      }
+      LOG_SYSERR << "in Acceptor::handleRead";
+      // Read the section named "The special problem of
+      // accept()ing when you can't" in libev's doc.
+      // By Marc Lehmann, author of libev.
+      if (errno == EMFILE)
+      {
+        ::close(idleFd_);
+        idleFd_ = ::accept(acceptSocket_.fd(), NULL, NULL);
+        ::close(idleFd_);
+        idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+      }
+      break;
     }
   }
 }
@@ -42,6 +42,18 @@ class Acceptor : noncopyable
   bool listenning() const { return listenning_; }
   void listen();
 
+  // 每次可读事件最多 accept(2) 多少个连接，直到 EAGAIN 为止，默认 1。
+  // 短连接多时调大可以省掉 poll 的往返。
+  void setMaxAcceptsPerRead(int n)
+  {
+    assert(n > 0);
+    maxAcceptsPerRead_ = n;
+  }
+
+  // 见 Socket::setReusePortCpuMap，listen() 之后调用
+  bool setReusePortCpuMap(const std::vector<int>& indexOfCpu)
+  { return acceptSocket_.setReusePortCpuMap(indexOfCpu); }
+
  private:
   void handleRead();
 
@@ -50,6 +62,7 @@ class Acceptor : noncopyable
   Channel acceptChannel_;
   NewConnectionCallback newConnectionCallback_;
   bool listenning_;
+  int maxAcceptsPerRead_;
   int idleFd_;
 };
 
@@ -0,0 +1,134 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include <muduo/net/ChainBuffer.h>
+
+#include <muduo/net/SocketsOps.h>
+
+#include <algorithm>
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/uio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t BlockPool::kBlockSize;
+const size_t BlockPool::kMaxFreeBlocks;
+const int ChainBuffer::kMaxIovecs;
+
+BlockPool::BlockPool()
+  : inUse_(0)
+{
+}
+
+BlockPool::~BlockPool()
+{
+  for (char* block : free_)
+  {
+    delete[] block;
+  }
+}
+
+char* BlockPool::get()
+{
+  ++inUse_;
+  if (free_.empty())
+  {
+    return new char[kBlockSize];
+  }
+  char* block = free_.back();
+  free_.pop_back();
+  return block;
+}
+
+void BlockPool::put(char* block)
+{
+  // 迁移过来的连接会还回别的 pool 分配的块，inUse_ 可能为负
+  --inUse_;
+  if (free_.size() < kMaxFreeBlocks)
+  {
+    free_.push_back(block);
+  }
+  else
+  {
+    delete[] block;
+  }
+}
+
+ChainBuffer::ChainBuffer(BlockPool* pool)
+  : pool_(pool),
+    readable_(0)
+{
+}
+
+ChainBuffer::~ChainBuffer()
+{
+  for (const Block& block : blocks_)
+  {
+    delete[] block.data;
+  }
+}
+
+void ChainBuffer::append(const void* data, size_t len)
+{
+  const char* p = static_cast<const char*>(data);
+  readable_ += len;
+  while (len > 0)
+  {
+    if (blocks_.empty() || blocks_.back().writerIndex == BlockPool::kBlockSize)
+    {
+      blocks_.push_back(Block{ pool_->get(), 0, 0 });
+    }
+    Block& last = blocks_.back();
+    size_t n = std::min(len, BlockPool::kBlockSize - last.writerIndex);
+    memcpy(last.data + last.writerIndex, p, n);
+    last.writerIndex += n;
+    p += n;
+    len -= n;
+  }
+}
+
+void ChainBuffer::retrieve(size_t len)
+{
+  assert(len <= readable_);
+  readable_ -= len;
+  while (len > 0)
+  {
+    Block& first = blocks_.front();
+    size_t n = std::min(len, first.writerIndex - first.readerIndex);
+    first.readerIndex += n;
+    len -= n;
+    if (first.readerIndex == first.writerIndex)
+    {
+      pool_->put(first.data);
+      blocks_.pop_front();
+    }
+  }
+}
+
+ssize_t ChainBuffer::writeFd(int fd, int* savedErrno)
+{
+  struct iovec vec[kMaxIovecs];
+  int iovcnt = 0;
+  for (auto it = blocks_.begin(); it != blocks_.end() && iovcnt < kMaxIovecs; ++it)
+  {
+    vec[iovcnt].iov_base = it->data + it->readerIndex;
+    vec[iovcnt].iov_len = it->writerIndex - it->readerIndex;
+    ++iovcnt;
+  }
+  const ssize_t n = sockets::writev(fd, vec, iovcnt);
+  if (n < 0)
+  {
+    *savedErrno = errno;
+  }
+  else
+  {
+    retrieve(n);
+  }
+  return n;
+}
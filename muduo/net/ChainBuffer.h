@@ -0,0 +1,101 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_CHAINBUFFER_H
+#define MUDUO_NET_CHAINBUFFER_H
+
+#include <muduo/base/noncopyable.h>
+#include <muduo/base/Types.h>
+
+#include <deque>
+#include <vector>
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Free list of fixed size blocks for ChainBuffer, one per EventLoop,
+/// see EventLoop::blockPool().
+///
+/// Not thread safe, only used in its loop thread.
+class BlockPool : noncopyable
+{
+ public:
+  static const size_t kBlockSize = 16 * 1024;
+  // 每个 loop 最多缓存 4 MiB，多出来的块直接释放
+  static const size_t kMaxFreeBlocks = 256;
+
+  BlockPool();
+  ~BlockPool();
+
+  char* get();
+  void put(char* block);
+
+  size_t numFree() const { return free_.size(); }
+  /// get() 减去 put() 的次数。~ChainBuffer 直接释放的块不会减回来，
+  /// 所以 ChainBuffer 要在析构之前 retrieveAll()，TcpConnection::connectDestroyed() 就是这样做的。
+  int64_t numInUse() const { return inUse_; }
+
+ private:
+  std::vector<char*> free_;
+  int64_t inUse_;
+};
+
+///
+/// Output buffer made of a chain of BlockPool::kBlockSize blocks.
+///
+/// append() fills the last block and takes new ones from the pool,
+/// it never moves the data already in the buffer like Buffer::makeSpace().
+/// writeFd() sends up to kMaxIovecs blocks with one writev(2),
+/// blocks fully sent go back to the pool.
+///
+/// Not thread safe, used in the loop thread of its pool.
+class ChainBuffer : noncopyable
+{
+ public:
+  // 一次 writev 最多 1 MiB
+  static const int kMaxIovecs = 64;
+
+  explicit ChainBuffer(BlockPool* pool);
+  // 可能在任何线程析构，剩下的块直接释放，不还给 pool，也不修改 pool 的 numInUse()；
+  // 要还给 pool 就先在 loop 线程里 retrieveAll()
+  ~ChainBuffer();
+
+  size_t readableBytes() const { return readable_; }
+  size_t numBlocks() const { return blocks_.size(); }
+
+  void append(const void* data, size_t len);
+
+  void retrieve(size_t len);
+  void retrieveAll() { retrieve(readable_); }
+
+  /// Writes as much as possible with writev(2), retrieves what was written.
+  ssize_t writeFd(int fd, int* savedErrno);
+
+  /// 迁移到另一个 loop 之后改用它的 pool，在新 loop 线程里调用。
+  /// 原来 pool 的块写完之后还给新的 pool，块的大小都一样。
+  void setPool(BlockPool* pool) { pool_ = pool; }
+
+ private:
+  struct Block
+  {
+    char* data;
+    size_t readerIndex;
+    size_t writerIndex;
+  };
+
+  BlockPool* pool_;
+  std::deque<Block> blocks_;
+  size_t readable_;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_CHAINBUFFER_H
@@ -28,6 +28,10 @@ Channel::Channel(EventLoop* loop, int fd__)
     revents_(0),
     index_(-1),
     logHup_(true),
+    edgeTriggered_(false),
+    numHandled_(0),
+    handledMicroSeconds_(0),
+    maxHandledMicroSeconds_(0),
     tied_(false),
     eventHandling_(false),
     addedToLoop_(false)
@@ -63,6 +67,14 @@ void Channel::remove()
   loop_->removeChannel(this);
 }
 
+void Channel::setLoop(EventLoop* loop)
+{
+  loop_->assertInLoopThread();
+  assert(!addedToLoop_);
+  assert(!eventHandling_);
+  loop_ = loop;
+}
+
 void Channel::handleEvent(Timestamp receiveTime)
 {
   std::shared_ptr<void> guard;
@@ -111,6 +123,7 @@ void Channel::handleEventWithGuard(Timestamp receiveTime)
     if (writeCallback_) writeCallback_();
   }
   eventHandling_ = false;
+  loop_->afterCallback(this);
 }
 
 string Channel::reventsToString() const
@@ -80,8 +80,38 @@ class Channel : noncopyable
 
   void doNotLogHup() { logHup_ = false; }
 
+  /// Shown in slow callback warnings and EventLoop::channelStats(),
+  /// e.g. name of the TcpConnection.
+  void setName(const string& name) { name_ = name; }
+  const string& name() const { return name_; }
+
+  // 回调的次数和耗时（微秒），由 EventLoop::afterCallback() 累计
+  void addHandled(int64_t microSeconds)
+  {
+    ++numHandled_;
+    handledMicroSeconds_ += microSeconds;
+    if (microSeconds > maxHandledMicroSeconds_)
+    {
+      maxHandledMicroSeconds_ = microSeconds;
+    }
+  }
+  int64_t numHandled() const { return numHandled_; }
+  int64_t handledMicroSeconds() const { return handledMicroSeconds_; }
+  int64_t maxHandledMicroSeconds() const { return maxHandledMicroSeconds_; }
+
+  // 回调每次都会把 fd 读/写到 EAGAIN（或者一次就能清空，如 eventfd/timerfd），
+  // 因此只需要边沿通知。Poller 可以据此使用更便宜的注册方式，
+  // 例如 EPollPoller 的 EPOLLET、IoUringPoller 的 multishot poll。
+  // PollPoller 忽略它，见 Poller::edgeTriggeredSupported()。
+  // Must be called before enabling events.
+  void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+  bool edgeTriggered() const { return edgeTriggered_; }
+
   EventLoop* ownerLoop() { return loop_; }
   void remove();
+  /// 换到另一个 EventLoop，用于 TcpConnection::migrateTo()。
+  /// Must be called in the old loop thread, after remove().
+  void setLoop(EventLoop* loop);
 
  private:
   static string eventsToString(int fd, int ev);
@@ -100,6 +130,11 @@ class Channel : noncopyable
   int        revents_; // 目前活动的IO事件，由Poller设置。bit pattern
   int        index_; // used by Poller. 在PollPoller中表示 pollfds_ 数组中的下标，在EPollPoller中被挪用为标记此Channel是否位于epoll的关注列表之中
   bool       logHup_;
+  bool       edgeTriggered_;
+  string     name_;
+  int64_t    numHandled_;
+  int64_t    handledMicroSeconds_;
+  int64_t    maxHandledMicroSeconds_;
 
   std::weak_ptr<void> tie_;
   bool tied_;
@@ -8,15 +8,19 @@
 
 #include <muduo/net/EventLoop.h>
 
+#include <muduo/base/CpuAffinity.h>
 #include <muduo/base/Logging.h>
 #include <muduo/base/Mutex.h>
+#include <muduo/net/ChainBuffer.h>
 #include <muduo/net/Channel.h>
 #include <muduo/net/Poller.h>
 #include <muduo/net/SocketsOps.h>
 #include <muduo/net/TimerQueue.h>
+#include <muduo/net/poller/IoUringPoller.h>
 
 #include <algorithm>
 
+#include <errno.h>
 #include <signal.h>
 #include <sys/eventfd.h>
 #include <unistd.h>
@@ -31,6 +35,7 @@ namespace
 thread_local EventLoop* t_loopInThisThread = 0;
 
 const int kPollTimeMs = 10000;
+const double kSlowCallbackSeconds = 0.1;
 
 int createEventfd()
 {
@@ -70,13 +75,28 @@ EventLoop::EventLoop()
     callingPendingFunctors_(false),
     iteration_(0),
     threadId_(CurrentThread::tid()),
+    cpu_(CpuAffinity::currentCpu()),
+    numaNode_(CpuAffinity::nodeOfCpu(cpu_)),
+    busyPollUs_(0),
+    pollStats_(),
+    slowCallbackUs_(static_cast<int64_t>(
+        kSlowCallbackSeconds * Timestamp::kMicroSecondsPerSecond)),
+    numConnections_(0),
+    busyMicroSeconds_(0),
     poller_(Poller::newDefaultPoller(this)),
     timerQueue_(new TimerQueue(this)),
+    blockPool_(new BlockPool),
+    completionIo_(NULL),
     wakeupFd_(createEventfd()),
     wakeupChannel_(new Channel(this, wakeupFd_)),
-    currentActiveChannel_(NULL)
+    currentActiveChannel_(NULL),
+    numPendingFunctors_(0),
+    wakeupPending_(false),
+    wakeups_(0),
+    wakeupTime_(0)
 {
-  LOG_DEBUG << "EventLoop created " << this << " in thread " << threadId_;
+  LOG_DEBUG << "EventLoop created " << this << " in thread " << threadId_
+            << " on cpu " << cpu_;
   if (t_loopInThisThread)
   {
     LOG_FATAL << "Another EventLoop " << t_loopInThisThread
@@ -86,9 +106,17 @@ EventLoop::EventLoop()
   {
     t_loopInThisThread = this;
   }
+  IoUringPoller* uring = dynamic_cast<IoUringPoller*>(poller_.get());
+  if (uring && uring->completionIo())
+  {
+    completionIo_ = uring;
+  }
+  wakeupChannel_->setName("wakeup");
   wakeupChannel_->setReadCallback(
       std::bind(&EventLoop::handleRead, this));
   // we are always reading the wakeupfd
+  // 一次 read 就清零了 eventfd 的计数，边沿通知足够
+  wakeupChannel_->setEdgeTriggered(true);
   wakeupChannel_->enableReading();
 }
 
@@ -99,6 +127,12 @@ EventLoop::~EventLoop()
   wakeupChannel_->disableAll();
   wakeupChannel_->remove();
   ::close(wakeupFd_);
+  // 节点由 pendingPool_ 析构时统一释放
+  while (PendingFunctor* pending = pendingFunctors_.pop())
+  {
+    pending->functor = nullptr;
+    pendingPool_.put(pending);
+  }
   t_loopInThisThread = NULL;
 }
 
@@ -107,34 +141,78 @@ void EventLoop::loop()
   assert(!looping_);
   assertInLoopThread();
   looping_ = true;
-  quit_ = false;  // FIXME: what if someone calls quit() before loop() ?
+  // quit() 可能在 loop() 之前调用，例如 EventLoopThread 刚启动就析构，
+  // 所以在退出时而不是进入时清除 quit_，loop() 仍然可以再次调用
   LOG_TRACE << "EventLoop " << this << " start looping";
 
+  // 上一阶段的结束时刻就是下一阶段的开始时刻，每轮只多调用 1 + 活动 Channel 数次 now()
+  Timestamp pollStart(Timestamp::now());
   while (!quit_)
   {
     activeChannels_.clear();
-    pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
+    pollReturnTime_ = pollWithBusyPoll();
     ++iteration_;
+    loopStats_.pollWait.add(pollReturnTime_.microSecondsSinceEpoch()
+                            - pollStart.microSecondsSinceEpoch());
+    loopStats_.eventsPerWakeup.add(static_cast<int64_t>(activeChannels_.size()));
     if (Logger::logLevel() <= Logger::TRACE)
     {
       printActiveChannels();
     }
     // TODO sort channel by priority
     eventHandling_ = true;
+    // afterCallback() 把它推进到每个回调的结束时刻
+    loopStats_.callbackStart.store(pollReturnTime_.microSecondsSinceEpoch(),
+                                   std::memory_order_relaxed);
     for (Channel* channel : activeChannels_)
     {
       currentActiveChannel_ = channel;
+      loopStats_.callbackFd.store(channel->fd(), std::memory_order_relaxed);
       currentActiveChannel_->handleEvent(pollReturnTime_);
     }
     currentActiveChannel_ = NULL;
     eventHandling_ = false;
-    doPendingFunctors();
+    int64_t functorsStart = loopStats_.callbackStart.exchange(0, std::memory_order_relaxed);
+    loopStats_.callbackFd.store(-1, std::memory_order_relaxed);
+    int64_t functors = doPendingFunctors();
+    pollStart = Timestamp::now();
+    loopStats_.functorsPerBatch.add(functors);
+    loopStats_.functorBatch.add(pollStart.microSecondsSinceEpoch() - functorsStart);
+    busyMicroSeconds_.store(busyMicroSeconds_.load(std::memory_order_relaxed)
+                            + pollStart.microSecondsSinceEpoch()
+                            - pollReturnTime_.microSecondsSinceEpoch(),
+                            std::memory_order_relaxed);
   }
 
   LOG_TRACE << "EventLoop " << this << " stop looping";
+  quit_ = false;
   looping_ = false;
 }
 
+Timestamp EventLoop::pollWithBusyPoll()
+{
+  if (busyPollUs_ > 0)
+  {
+    int64_t start = Timestamp::now().microSecondsSinceEpoch();
+    int64_t elapsed = 0;
+    do
+    {
+      Timestamp now(poller_->poll(0, &activeChannels_));
+      elapsed = now.microSecondsSinceEpoch() - start;
+      if (!activeChannels_.empty())
+      {
+        ++pollStats_.spinHits;
+        pollStats_.spinMicroSeconds += elapsed;
+        return now;
+      }
+      ++pollStats_.spins;
+    } while (elapsed < busyPollUs_ && !quit_);
+    pollStats_.spinMicroSeconds += elapsed;
+  }
+  ++pollStats_.blockingPolls;
+  return poller_->poll(kPollTimeMs, &activeChannels_);
+}
+
 void EventLoop::quit()
 {
   quit_ = true;
@@ -161,15 +239,19 @@ void EventLoop::runInLoop(Functor cb)
 
 void EventLoop::queueInLoop(Functor cb)
 {
-  {
-  MutexLockGuard lock(mutex_);
-  pendingFunctors_.push_back(std::move(cb));
-  }
+  numPendingFunctors_.fetch_add(1, std::memory_order_relaxed);
+  PendingFunctor* pending = pendingPool_.get();
+  pending->functor = std::move(cb);
+  pendingFunctors_.push(pending);
 
   // 如果调用queueInLoop()的线程不是EventLoop所属的线程，那么唤醒是必需的；
   // 如果在IO线程调用queueInLoop()，而此时正在调用pending functor，那么也必须唤醒，否则新加的cb就不能被及时调用了
   // 换句话说，只有在IO线程的事件回调中调用queueInLoop()才无须wakeup()。
-  if (!isInLoopThread() || callingPendingFunctors_)
+  // 已经有人唤醒、而 loop 还没有开始 doPendingFunctors() 时，不必再写 eventfd：
+  // doPendingFunctors() 先清除 wakeupPending_ 再取队列，
+  // 清除之前 push 的一定能取到，之后 push 的会看到 false 而再唤醒一次。
+  if ((!isInLoopThread() || callingPendingFunctors_) &&
+      !wakeupPending_.exchange(true, std::memory_order_acq_rel))
   {
     wakeup();
   }
@@ -177,25 +259,24 @@ void EventLoop::queueInLoop(Functor cb)
 
 size_t EventLoop::queueSize() const
 {
-  MutexLockGuard lock(mutex_);
-  return pendingFunctors_.size();
+  return numPendingFunctors_.load(std::memory_order_relaxed);
 }
 
-TimerId EventLoop::runAt(Timestamp time, TimerCallback cb)
+TimerId EventLoop::runAt(Timestamp time, TimerCallback cb, double slack)
 {
-  return timerQueue_->addTimer(std::move(cb), time, 0.0);
+  return timerQueue_->addTimer(std::move(cb), time, 0.0, slack);
 }
 
-TimerId EventLoop::runAfter(double delay, TimerCallback cb)
+TimerId EventLoop::runAfter(double delay, TimerCallback cb, double slack)
 {
   Timestamp time(addTime(Timestamp::now(), delay));
-  return runAt(time, std::move(cb));
+  return runAt(time, std::move(cb), slack);
 }
 
-TimerId EventLoop::runEvery(double interval, TimerCallback cb)
+TimerId EventLoop::runEvery(double interval, TimerCallback cb, double slack)
 {
   Timestamp time(addTime(Timestamp::now(), interval));
-  return timerQueue_->addTimer(std::move(cb), time, interval);
+  return timerQueue_->addTimer(std::move(cb), time, interval, slack);
 }
 
 void EventLoop::cancel(TimerId timerId)
@@ -203,10 +284,77 @@ void EventLoop::cancel(TimerId timerId)
   return timerQueue_->cancel(timerId);
 }
 
+void EventLoop::setTimingWheel(double tickSeconds)
+{
+  timerQueue_->setTimingWheel(tickSeconds);
+}
+
+const EventLoop::TimerStats& EventLoop::timerStats() const
+{
+  return timerQueue_->stats();
+}
+
+EventLoop::PollStats EventLoop::pollStats() const
+{
+  PollStats stats = pollStats_;
+  stats.interestSyscalls = poller_->interestSyscalls();
+  return stats;
+}
+
+void EventLoop::setSlowCallbackThreshold(double seconds)
+{
+  slowCallbackUs_ = static_cast<int64_t>(seconds * Timestamp::kMicroSecondsPerSecond);
+}
+
+std::vector<EventLoop::ChannelStats> EventLoop::channelStats(size_t limit) const
+{
+  assert(isInLoopThread());
+  Poller::ChannelList channels;
+  poller_->getChannels(&channels);
+  limit = std::min(limit, channels.size());
+  std::partial_sort(channels.begin(), channels.begin() + limit, channels.end(),
+                    [](const Channel* lhs, const Channel* rhs) {
+                      return lhs->handledMicroSeconds() > rhs->handledMicroSeconds();
+                    });
+  std::vector<ChannelStats> result;
+  result.reserve(limit);
+  for (size_t i = 0; i < limit; ++i)
+  {
+    const Channel* channel = channels[i];
+    result.push_back({ channel->fd(), channel->name(), channel->numHandled(),
+                       channel->handledMicroSeconds(),
+                       channel->maxHandledMicroSeconds() });
+  }
+  return result;
+}
+
+void EventLoop::afterCallback(Channel* channel)
+{
+  int64_t start = loopStats_.callbackStart.load(std::memory_order_relaxed);
+  if (start == 0)
+  {
+    // 不是由 loop() 调用的
+    return;
+  }
+  int64_t end = Timestamp::now().microSecondsSinceEpoch();
+  int64_t elapsed = end - start;
+  loopStats_.callback.add(elapsed);
+  channel->addHandled(elapsed);
+  if (slowCallbackUs_ > 0 && elapsed >= slowCallbackUs_)
+  {
+    loopStats_.slowCallbacks.fetch_add(1, std::memory_order_relaxed);
+    LOG_WARN << "EventLoop " << this << " slow callback " << elapsed << " us, "
+             << (channel->name().empty() ? "fd" : channel->name().c_str())
+             << " {" << channel->reventsToString() << "}";
+  }
+  loopStats_.callbackStart.store(end, std::memory_order_relaxed);
+}
+
 void EventLoop::updateChannel(Channel* channel)
 {
   assert(channel->ownerLoop() == this);
   assertInLoopThread();
+  ++pollStats_.channelUpdates;
   poller_->updateChannel(channel);
 }
 
@@ -219,6 +367,7 @@ void EventLoop::removeChannel(Channel* channel)
     assert(currentActiveChannel_ == channel ||
         std::find(activeChannels_.begin(), activeChannels_.end(), channel) == activeChannels_.end());
   }
+  ++pollStats_.channelUpdates;
   poller_->removeChannel(channel);
 }
 
@@ -229,6 +378,11 @@ bool EventLoop::hasChannel(Channel* channel)
   return poller_->hasChannel(channel);
 }
 
+bool EventLoop::edgeTriggeredSupported() const
+{
+  return poller_->edgeTriggeredSupported();
+}
+
 void EventLoop::abortNotInLoopThread()
 {
   LOG_FATAL << "EventLoop::abortNotInLoopThread - EventLoop " << this
@@ -239,6 +393,8 @@ void EventLoop::abortNotInLoopThread()
 void EventLoop::wakeup()
 {
   uint64_t one = 1;
+  wakeups_.fetch_add(1, std::memory_order_relaxed);
+  wakeupTime_.store(Timestamp::now().microSecondsSinceEpoch(), std::memory_order_release);
   ssize_t n = sockets::write(wakeupFd_, &one, sizeof one);
   if (n != sizeof one)
   {
@@ -250,30 +406,55 @@ void EventLoop::handleRead()
 {
   uint64_t one = 1;
   ssize_t n = sockets::read(wakeupFd_, &one, sizeof one);
+  if (n < 0 && errno == EAGAIN)
+  {
+    // 边沿触发：上一次 read() 之前的几次 write() 各自产生一次通知，
+    // 晚到的那些看到的计数已经清零了
+    return;
+  }
   if (n != sizeof one)
   {
     LOG_ERROR << "EventLoop::handleRead() reads " << n << " bytes instead of 8";
   }
+  // 几次 wakeup() 合并成一次时只统计最后一次
+  int64_t latency = pollReturnTime_.microSecondsSinceEpoch()
+      - wakeupTime_.load(std::memory_order_acquire);
+  if (latency >= 0)
+  {
+    ++pollStats_.wakeupsHandled;
+    pollStats_.wakeupLatencyMicroSeconds += latency;
+    pollStats_.maxWakeupLatencyMicroSeconds =
+        std::max(pollStats_.maxWakeupLatencyMicroSeconds, latency);
+  }
 }
 
-void EventLoop::doPendingFunctors()
+int64_t EventLoop::doPendingFunctors()
 {
-  std::vector<Functor> functors;
   callingPendingFunctors_ = true;
-
-  // 不是简单地在临界区内依次调用Functor，而是把回调列表swap()到局部变量functors中，
-  // 这样一方面减小了临界区的长度（意味着不会阻塞其他线程调用queueInLoop()）
-  // 另一方面也避免了死锁（因为Functor可能再调用queueInLoop()）。
-  {
-  MutexLockGuard lock(mutex_);
-  functors.swap(pendingFunctors_);
-  }
-
-  for (const Functor& functor : functors)
+  wakeupPending_.exchange(false, std::memory_order_acq_rel);
+
+  // 只执行本轮开始时已经在队列中的 functor，执行过程中新加入的留到下一轮，
+  // 否则一个不断 queueInLoop() 自己的 functor 会让 loop 永远回不到 poll()。
+  // 队列无锁，Functor 再调用 queueInLoop() 也不会死锁。
+  size_t n = numPendingFunctors_.load(std::memory_order_relaxed);
+  int64_t executed = 0;
+  for (size_t i = 0; i < n; ++i)
   {
+    // 生产者 push 到一半时取不到，它随后会看到 wakeupPending_ 为 false 而唤醒我们
+    PendingFunctor* pending = pendingFunctors_.pop();
+    if (pending == nullptr)
+    {
+      break;
+    }
+    numPendingFunctors_.fetch_sub(1, std::memory_order_relaxed);
+    // 先把节点还回去，functor 里再 queueInLoop() 可以直接复用
+    Functor functor(std::move(pending->functor));
+    pendingPool_.put(pending);
     functor();
+    ++executed;
   }
   callingPendingFunctors_ = false;
+  return executed;
 }
 
 void EventLoop::printActiveChannels() const
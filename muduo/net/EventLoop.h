@@ -18,6 +18,10 @@
 
 #include <muduo/base/Mutex.h>
 #include <muduo/base/CurrentThread.h>
+#include <muduo/base/Histogram.h>
+#include <muduo/base/InplaceFunction.h>
+#include <muduo/base/HazardPointer.h>
+#include <muduo/base/MpscQueue.h>
 #include <muduo/base/Timestamp.h>
 #include <muduo/net/Callbacks.h>
 #include <muduo/net/TimerId.h>
@@ -28,7 +32,9 @@ namespace net
 {
 
 // 前向声明，简化了头文件之间的依赖关系
+class BlockPool;
 class Channel;
+class IoUringPoller;
 class Poller;
 class TimerQueue;
 
@@ -39,7 +45,8 @@ class TimerQueue;
 class EventLoop : noncopyable
 {
  public:
-  typedef std::function<void()> Functor;
+  // move-only, captures up to 64 bytes are stored inline
+  typedef InplaceFunction<void()> Functor;
 
   EventLoop();
   ~EventLoop();  // force out-line dtor, for std::unique_ptr members.
@@ -75,6 +82,12 @@ class EventLoop : noncopyable
 
   int64_t iteration() const { return iteration_; }
 
+  /// CPU the loop thread is bound to (or was running on) when the loop was
+  /// constructed, see CpuAffinity. Valid in ThreadInitCallback.
+  int cpu() const { return cpu_; }
+  /// index into CpuAffinity::systemNodes(), -1 if unknown
+  int numaNode() const { return numaNode_; }
+
   /// Runs callback immediately in the loop thread.
   /// It wakes up the loop, and run the cb.
   /// If in the same loop thread, cb is run within the function.
@@ -87,36 +100,146 @@ class EventLoop : noncopyable
 
   size_t queueSize() const;
 
+  /// number of eventfd writes, a burst of cross-thread queueInLoop()
+  /// before the loop drains costs only one.
+  int64_t wakeups() const { return wakeups_.load(std::memory_order_relaxed); }
+
+  /// Busy-poll：进入阻塞等待之前，先用零超时的 poll 自旋 microseconds 微秒。
+  /// 这期间来的事件不必经过一次 futex/epoll 唤醒，代价是占着一个 CPU。
+  /// 0 (default) means always block.
+  /// Must be called in the loop thread, or before loop().
+  void setBusyPoll(int microseconds) { busyPollUs_ = microseconds; }
+  int busyPoll() const { return busyPollUs_; }
+
+  struct PollStats
+  {
+    int64_t spins;             // 没有等到事件的零超时 poll
+    int64_t spinHits;          // 自旋期间等到了事件，省掉一次阻塞等待
+    int64_t blockingPolls;
+    int64_t spinMicroSeconds;  // 自旋消耗的 CPU 时间
+    // 跨线程 wakeup() 到 poll 返回的时间
+    int64_t wakeupsHandled;
+    int64_t wakeupLatencyMicroSeconds;  // 总和
+    int64_t maxWakeupLatencyMicroSeconds;
+    // Channel::update()/remove() 的次数，以及实际的 epoll_ctl(2) 次数，
+    // 后者少于前者的部分是合并掉的修改
+    int64_t channelUpdates;
+    int64_t interestSyscalls;
+  };
+  /// for tuning setBusyPoll().
+  /// Not thread safe, call it in the loop thread, e.g. with runInLoop().
+  PollStats pollStats() const;
+
   // timers
+  //
+  // slack：允许 Timer 晚多少秒执行。窗口重叠的 Timer 在同一次 timerfd 超时里执行，
+  // 新 Timer 的窗口包含已经设置的超时时刻时也不必再调用 timerfd_settime()。
 
   ///
   /// Runs callback at 'time'.
   /// Safe to call from other threads.
   ///
-  TimerId runAt(Timestamp time, TimerCallback cb);
+  TimerId runAt(Timestamp time, TimerCallback cb, double slack = 0.0);
   ///
   /// Runs callback after @c delay seconds.
   /// Safe to call from other threads.
   ///
-  TimerId runAfter(double delay, TimerCallback cb);
+  TimerId runAfter(double delay, TimerCallback cb, double slack = 0.0);
   ///
   /// Runs callback every @c interval seconds.
   /// Safe to call from other threads.
   ///
-  TimerId runEvery(double interval, TimerCallback cb);
+  TimerId runEvery(double interval, TimerCallback cb, double slack = 0.0);
   ///
   /// Cancels the timer.
   /// Safe to call from other threads.
   ///
   void cancel(TimerId timerId);
+  ///
+  /// Uses a hierarchical timing wheel for timers of this loop,
+  /// for millions of timers, eg. per-connection idle timeouts.
+  /// add/cancel are O(1), timers fire up to @c tickSeconds late.
+  /// Must be called in the loop thread before adding any timer,
+  /// eg. in EventLoopThread's ThreadInitCallback.
+  ///
+  void setTimingWheel(double tickSeconds);
+
+  struct TimerStats
+  {
+    int64_t timerfdWakeups;
+    int64_t timersFired;
+    int64_t timerfdResets;       // timerfd_settime() calls
+    int64_t timerfdResetsSaved;  // 新 Timer 比原定的超时早、但是 slack 容得下
+  };
+  /// Counters since the loop was created, sample them periodically for rates.
+  /// Not thread safe, call it in the loop thread, e.g. with runInLoop().
+  const TimerStats& timerStats() const;
+
+  // instrumentation
+
+  /// Always on, histograms are in microseconds unless noted otherwise.
+  /// Histogram::add() 只是几次 relaxed 原子加，可以在任意线程读取，例如 Inspector。
+  struct LoopStats
+  {
+    Histogram pollWait;          // 进入 poll 到返回，包括 busy poll 自旋
+    Histogram eventsPerWakeup;   // 每次 poll 返回的活动 Channel 数，个
+    Histogram callback;          // 每次 Channel::handleEvent()
+    Histogram functorsPerBatch;  // 每轮 doPendingFunctors() 执行的个数，个
+    Histogram functorBatch;      // 每轮 doPendingFunctors() 的耗时
+    Histogram timerLateness;     // Timer 到期到开始执行
+    std::atomic<int64_t> slowCallbacks{0};
+    // 正在执行的 Channel 回调的开始时刻和 fd，没有则为 0 和 -1，
+    // 别的线程据此可以发现卡住的 loop
+    std::atomic<int64_t> callbackStart{0};
+    std::atomic<int> callbackFd{-1};
+  };
+  /// Thread safe.
+  const LoopStats& loopStats() const { return loopStats_; }
+
+  /// Logs a warning with Channel::name() when one callback takes longer.
+  /// 0 disables it, default 0.1 second.
+  /// Must be called in the loop thread, or before loop().
+  void setSlowCallbackThreshold(double seconds);
+
+  struct ChannelStats
+  {
+    int fd;
+    string name;
+    int64_t calls;
+    int64_t microSeconds;
+    int64_t maxMicroSeconds;
+  };
+  /// Registered channels with the most total callback time first, at most @c limit.
+  /// Not thread safe, call it in the loop thread, e.g. with runInLoop().
+  std::vector<ChannelStats> channelStats(size_t limit) const;
+
+  // load, for EventLoopThreadPool placement policies
+
+  /// TcpConnections of this loop, counted from construction to connectDestroyed(),
+  /// so a connection counts as soon as it's placed. Thread safe.
+  int numConnections() const { return numConnections_.load(std::memory_order_relaxed); }
+  /// Total microseconds spent outside poll, i.e. in callbacks and functors,
+  /// updated once per iteration. Thread safe.
+  int64_t busyMicroSeconds() const { return busyMicroSeconds_.load(std::memory_order_relaxed); }
 
   // internal usage
+  void addConnections(int delta) { numConnections_.fetch_add(delta, std::memory_order_relaxed); }
   void wakeup();
   void updateChannel(Channel* channel);
   void removeChannel(Channel* channel);
   bool hasChannel(Channel* channel);
-
-  // pid_t threadId() const { return threadId_; }
+  /// true if the poller honours Channel::setEdgeTriggered().
+  bool edgeTriggeredSupported() const;
+  /// non-null if TcpConnection should use the completion-based data path,
+  /// see MUDUO_USE_IO_URING=completion
+  IoUringPoller* completionIo() const { return completionIo_; }
+  /// blocks of TcpConnection::setChainedOutput(), only used in the loop thread
+  BlockPool* blockPool() const { return blockPool_.get(); }
+  /// called by Channel::handleEvent() when a callback returns
+  void afterCallback(Channel* channel);
+  void addTimerLateness(int64_t microSeconds) { loopStats_.timerLateness.add(microSeconds); }
+
+  pid_t threadId() const { return threadId_; }
   // bool callingPendingFunctors() const { return callingPendingFunctors_; }
   bool eventHandling() const { return eventHandling_; }
 
@@ -134,7 +257,8 @@ class EventLoop : noncopyable
  private:
   void abortNotInLoopThread();
   void handleRead();  // waked up
-  void doPendingFunctors();
+  int64_t doPendingFunctors();  // returns number of functors run
+  Timestamp pollWithBusyPoll();
 
   void printActiveChannels() const; // DEBUG
 
@@ -146,13 +270,23 @@ class EventLoop : noncopyable
   bool callingPendingFunctors_; /* atomic */
   int64_t iteration_;
   const pid_t threadId_; // 本对象所属的线程ID。在构造函数中被赋值。
+  const int cpu_;
+  const int numaNode_;
   Timestamp pollReturnTime_;
+  int busyPollUs_;
+  PollStats pollStats_;
+  LoopStats loopStats_;
+  int64_t slowCallbackUs_;
+  std::atomic<int> numConnections_;
+  std::atomic<int64_t> busyMicroSeconds_;  // 只在 loop 线程写
   // 通过unique_ptr间接持有Poller，因此EventLoop不需要知道Poller的具体实现。
   // 即不需要包含Poller.h，只需要前向声明即可。
   // 为此，EventLoop的析构函数必须在EventLoop.cc中显式定义。
   // TimerQueue 同理。
   std::unique_ptr<Poller> poller_; 
   std::unique_ptr<TimerQueue> timerQueue_;
+  std::unique_ptr<BlockPool> blockPool_;
+  IoUringPoller* completionIo_;  // points into poller_
   int wakeupFd_;
   // unlike in TimerQueue, which is an internal class,
   // we don't expose Channel to client.
@@ -163,8 +297,26 @@ class EventLoop : noncopyable
   ChannelList activeChannels_;
   Channel* currentActiveChannel_;
 
-  mutable MutexLock mutex_;
-  std::vector<Functor> pendingFunctors_ GUARDED_BY(mutex_);
+  struct PendingFunctor
+  {
+    std::atomic<PendingFunctor*> mpscNext;
+    Functor functor;
+    std::atomic<PendingFunctor*> poolNext;  // for pendingPool_
+    PendingFunctor* poolAll;
+  };
+
+  // 任意线程 push，只在 loop 线程 pop，不需要加锁
+  MpscQueue<PendingFunctor> pendingFunctors_;
+  // 节点的 freelist：生产者 get()，loop 线程执行前 put() 回去，
+  // 稳定之后 queueInLoop() 不再分配内存。只用它的 get()/put()，不涉及 hazard pointer。
+  HazardNodePool<PendingFunctor> pendingPool_;
+  std::atomic<size_t> numPendingFunctors_;
+  // 已经写过 eventfd、loop 还没有开始处理 pending functors，
+  // 这期间其他线程的 queueInLoop() 不必再写 eventfd
+  std::atomic<bool> wakeupPending_;
+  std::atomic<int64_t> wakeups_;
+  // 最近一次 wakeup() 的时刻，用于统计唤醒延迟
+  std::atomic<int64_t> wakeupTime_;
 };
 
 }  // namespace net
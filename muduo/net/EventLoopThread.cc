@@ -25,6 +25,21 @@ EventLoopThread::EventLoopThread(const ThreadInitCallback& cb,
 {
 }
 
+EventLoopThread::EventLoopThread(const ThreadInitCallback& cb,
+                                 const string& name,
+                                 std::vector<int> cpus,
+                                 bool localAlloc)
+  : loop_(nullptr),
+    mutex_(),
+    cond_(),
+    exiting_(false),
+    canGetLoop_(true),
+    callback_(cb),
+    thread_(std::bind(&EventLoopThread::threadFunc, this), name,
+            std::move(cpus), localAlloc)
+{
+}
+
 EventLoopThread::~EventLoopThread()
 {
   exiting_ = true;
@@ -62,6 +77,7 @@ void EventLoopThread::threadFunc()
   // 这里EventLoop的生命期与线程主函数的作用域相同，
   // 因此在threadFunc()退出之后这个指针就失效了。
   // 好在服务程序一般不要求能安全地退出，这应该不是什么大问题。
+  // 此时线程已经绑核，栈上的 EventLoop 及其缓冲区都在本地 node 上首次访问。
   EventLoop loop;
 
   if (callback_)
@@ -29,6 +29,11 @@ class EventLoopThread : noncopyable
 
   EventLoopThread(const ThreadInitCallback& cb = ThreadInitCallback(),
                   const string& name = string());
+  // 线程绑定到 cpus 上之后才构造 EventLoop，见 CpuAffinity
+  EventLoopThread(const ThreadInitCallback& cb,
+                  const string& name,
+                  std::vector<int> cpus,
+                  bool localAlloc);
   ~EventLoopThread();
   EventLoop* getLoop();
 
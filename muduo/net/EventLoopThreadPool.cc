@@ -11,17 +11,52 @@
 #include <muduo/net/EventLoop.h>
 #include <muduo/net/EventLoopThread.h>
 
+#include <algorithm>
+
 #include <stdio.h>
+#include <math.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
+const double EventLoopThreadPool::kLoadSampleSeconds = 0.1;
+
+namespace
+{
+
+// busy 相差不到 1% 时按连接数比较，空闲时的一批新连接不至于都落在同一个 loop 上
+const double kBusyTolerance = 0.01;
+
+bool fewerConnections(const EventLoopThreadPool::LoopLoad& a,
+                      const EventLoopThreadPool::LoopLoad& b)
+{
+  if (a.connections != b.connections)
+  {
+    return a.connections < b.connections;
+  }
+  return a.busy < b.busy;
+}
+
+bool lessBusy(const EventLoopThreadPool::LoopLoad& a,
+              const EventLoopThreadPool::LoopLoad& b)
+{
+  if (::fabs(a.busy - b.busy) > kBusyTolerance)
+  {
+    return a.busy < b.busy;
+  }
+  return a.connections < b.connections;
+}
+
+}  // namespace
+
 EventLoopThreadPool::EventLoopThreadPool(EventLoop* baseLoop, const string& nameArg)
   : baseLoop_(baseLoop),
     name_(nameArg),
     started_(false),
     numThreads_(0),
-    next_(0)
+    next_(0),
+    placement_(kRoundRobin),
+    random_(2463534242)
 {
 }
 
@@ -41,7 +76,8 @@ void EventLoopThreadPool::start(const ThreadInitCallback& cb)
   {
     char buf[name_.size() + 32];
     snprintf(buf, sizeof buf, "%s%d", name_.c_str(), i);
-    EventLoopThread* t = new EventLoopThread(cb, buf);
+    EventLoopThread* t = new EventLoopThread(cb, buf, affinity_.cpusFor(i),
+                                             affinity_.localAlloc());
     threads_.push_back(std::unique_ptr<EventLoopThread>(t));
     loops_.push_back(t->getLoop());
   }
@@ -49,6 +85,12 @@ void EventLoopThreadPool::start(const ThreadInitCallback& cb)
   {
     cb(baseLoop_);
   }
+
+  for (EventLoop* loop : getAllLoops())
+  {
+    samples_.push_back(Sample{ loop->busyMicroSeconds(), 0.0, 0 });
+  }
+  lastSample_ = Timestamp::now();
 }
 
 EventLoop* EventLoopThreadPool::getNextLoop()
@@ -57,7 +99,12 @@ EventLoop* EventLoopThreadPool::getNextLoop()
   assert(started_);
   EventLoop* loop = baseLoop_;
 
-  if (!loops_.empty())
+  if (loops_.empty())
+  {
+    return loop;
+  }
+
+  if (placement_ == kRoundRobin && !placementCallback_)
   {
     // round-robin
     loop = loops_[next_];
@@ -67,9 +114,105 @@ EventLoop* EventLoopThreadPool::getNextLoop()
       next_ = 0;
     }
   }
+  else
+  {
+    std::vector<LoopLoad> current = loads();
+    size_t index = placementCallback_ ? placementCallback_(current) : pick(current);
+    assert(index < loops_.size());
+    loop = loops_[index];
+    ++samples_[index].assigned;
+  }
   return loop;
 }
 
+size_t EventLoopThreadPool::pick(const std::vector<LoopLoad>& current)
+{
+  size_t n = current.size();
+  if (placement_ == kPowerOfTwoChoices)
+  {
+    if (n == 1)
+    {
+      return 0;
+    }
+    // xorshift32
+    random_ ^= random_ << 13;
+    random_ ^= random_ >> 17;
+    random_ ^= random_ << 5;
+    size_t first = random_ % n;
+    size_t second = (first + 1 + (random_ >> 16) % (n - 1)) % n;
+    return fewerConnections(current[second], current[first]) ? second : first;
+  }
+
+  // 从 next_ 开始找，负载相同时轮流分配
+  bool (*less)(const LoopLoad&, const LoopLoad&) =
+      placement_ == kLeastBusy ? lessBusy : fewerConnections;
+  size_t best = next_ % n;
+  for (size_t k = 1; k < n; ++k)
+  {
+    size_t i = (next_ + k) % n;
+    if (less(current[i], current[best]))
+    {
+      best = i;
+    }
+  }
+  next_ = static_cast<int>((best + 1) % n);
+  return best;
+}
+
+void EventLoopThreadPool::sampleLoads()
+{
+  Timestamp now(Timestamp::now());
+  double elapsed = timeDifference(now, lastSample_);
+  if (elapsed < kLoadSampleSeconds)
+  {
+    return;
+  }
+  std::vector<EventLoop*> loops = getAllLoops();
+  assert(loops.size() == samples_.size());
+  for (size_t i = 0; i < loops.size(); ++i)
+  {
+    Sample& sample = samples_[i];
+    int64_t busyMicroSeconds = loops[i]->busyMicroSeconds();
+    double busy = static_cast<double>(busyMicroSeconds - sample.busyMicroSeconds)
+                  / (elapsed * Timestamp::kMicroSecondsPerSecond);
+    sample.busy = std::min(busy, 1.0);
+    sample.busyMicroSeconds = busyMicroSeconds;
+    sample.assigned = 0;
+  }
+  lastSample_ = now;
+}
+
+std::vector<EventLoopThreadPool::LoopLoad> EventLoopThreadPool::loads()
+{
+  baseLoop_->assertInLoopThread();
+  assert(started_);
+  sampleLoads();
+  std::vector<EventLoop*> loops = getAllLoops();
+  std::vector<LoopLoad> result;
+  result.reserve(loops.size());
+  double totalBusy = 0.0;
+  int totalConnections = 0;
+  for (size_t i = 0; i < loops.size(); ++i)
+  {
+    LoopLoad load = { loops[i], loops[i]->numConnections(), samples_[i].busy,
+                      samples_[i].assigned };
+    totalBusy += load.busy;
+    totalConnections += load.connections;
+    result.push_back(load);
+  }
+
+  // 采样之后新分配的连接还没有反映在 busy 里，按平均每个连接的 busy 估计
+  if (totalConnections > 0)
+  {
+    double busyPerConnection = totalBusy / totalConnections;
+    for (LoopLoad& load : result)
+    {
+      load.busy += load.assigned * busyPerConnection;
+    }
+  }
+  return result;
+}
+
 EventLoop* EventLoopThreadPool::getLoopForHash(size_t hashCode)
 {
   baseLoop_->assertInLoopThread();
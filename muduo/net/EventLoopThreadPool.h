@@ -11,7 +11,9 @@
 #ifndef MUDUO_NET_EVENTLOOPTHREADPOOL_H
 #define MUDUO_NET_EVENTLOOPTHREADPOOL_H
 
+#include <muduo/base/CpuAffinity.h>
 #include <muduo/base/noncopyable.h>
+#include <muduo/base/Timestamp.h>
 #include <muduo/base/Types.h>
 
 #include <functional>
@@ -33,13 +35,41 @@ class EventLoopThreadPool : noncopyable
  public:
   typedef std::function<void(EventLoop*)> ThreadInitCallback;
 
+  // getNextLoop() 选择 loop 的策略
+  enum Placement
+  {
+    kRoundRobin,          // default
+    kLeastConnections,    // EventLoop::numConnections() 最少的
+    kLeastBusy,           // 最近一段时间 poll 之外的时间占比最低的
+    kPowerOfTwoChoices,   // 随机挑两个，取连接少的，避免一批新连接都涌向同一个 loop
+  };
+
+  struct LoopLoad
+  {
+    EventLoop* loop;
+    int connections;
+    // 上一个采样周期内 poll 之外的时间占比，0 ~ 1，
+    // 加上此后新分配的连接的估计值
+    double busy;
+    int assigned;  // 上次采样之后 getNextLoop() 分给它的连接数
+  };
+  typedef std::function<size_t(const std::vector<LoopLoad>&)> PlacementCallback;
+
   EventLoopThreadPool(EventLoop* baseLoop, const string& nameArg);
   ~EventLoopThreadPool();
   void setThreadNum(int numThreads) { numThreads_ = numThreads; }
+  // 第 i 个 I/O 线程绑定到 affinity.cpusFor(i)，baseLoop 所在线程不受影响。
+  // 绑定到的 CPU 可以在 ThreadInitCallback 中用 EventLoop::cpu() 取得。
+  // Must be called before start().
+  void setAffinity(const CpuAffinity& affinity) { affinity_ = affinity; }
+  void setPlacement(Placement placement) { placement_ = placement; }
+  /// Custom placement, returns an index into loads, overrides setPlacement().
+  void setPlacementCallback(const PlacementCallback& cb) { placementCallback_ = cb; }
+  Placement placement() const { return placement_; }
   void start(const ThreadInitCallback& cb = ThreadInitCallback());
 
   // valid after calling start()
-  /// round-robin
+  /// round-robin by default, see setPlacement().
   EventLoop* getNextLoop();
 
   /// with the same hash code, it will always return the same EventLoop
@@ -47,21 +77,46 @@ class EventLoopThreadPool : noncopyable
 
   std::vector<EventLoop*> getAllLoops();
 
+  /// Current load of each loop in getAllLoops(), busy time is sampled
+  /// at most every kLoadSampleSeconds.
+  std::vector<LoopLoad> loads();
+
+  static const double kLoadSampleSeconds;
+
   bool started() const
   { return started_; }
 
   const string& name() const
   { return name_; }
 
+  EventLoop* baseLoop() const
+  { return baseLoop_; }
+
  private:
+  struct Sample
+  {
+    int64_t busyMicroSeconds;
+    double busy;
+    int assigned;
+  };
+
+  void sampleLoads();
+  size_t pick(const std::vector<LoopLoad>& loads);
 
   EventLoop* baseLoop_; // 即TcpServer自己用的那个loop
   string name_;
   bool started_;
   int numThreads_;
+  CpuAffinity affinity_;
   int next_;
+  Placement placement_;
+  PlacementCallback placementCallback_;
   std::vector<std::unique_ptr<EventLoopThread>> threads_;
   std::vector<EventLoop*> loops_;
+  // always in baseLoop thread
+  std::vector<Sample> samples_;  // 与 loops_ 一一对应
+  Timestamp lastSample_;
+  uint32_t random_;
 };
 
 }  // namespace net
@@ -10,11 +10,17 @@
 
 #include <muduo/net/Channel.h>
 
+#include <algorithm>
+
+#include <assert.h>
+
 using namespace muduo;
 using namespace muduo::net;
 
 Poller::Poller(EventLoop* loop)
-  : ownerLoop_(loop)
+  : numChannels_(0),
+    interestSyscalls_(0),
+    ownerLoop_(loop)
 {
 }
 
@@ -23,7 +29,40 @@ Poller::~Poller() = default;
 bool Poller::hasChannel(Channel* channel) const
 {
   assertInLoopThread();
-  ChannelMap::const_iterator it = channels_.find(channel->fd());
-  return it != channels_.end() && it->second == channel;
+  return channelOf(channel->fd()) == channel;
+}
+
+void Poller::getChannels(ChannelList* channels) const
+{
+  assertInLoopThread();
+  channels->reserve(channels->size() + numChannels_);
+  for (Channel* channel : channels_)
+  {
+    if (channel)
+    {
+      channels->push_back(channel);
+    }
+  }
+}
+
+void Poller::addChannel(Channel* channel)
+{
+  int fd = channel->fd();
+  assert(fd >= 0);
+  if (implicit_cast<size_t>(fd) >= channels_.size())
+  {
+    channels_.resize(std::max(implicit_cast<size_t>(fd) + 1, channels_.size() * 2));
+  }
+  assert(channels_[fd] == NULL);
+  channels_[fd] = channel;
+  ++numChannels_;
+}
+
+void Poller::eraseChannel(Channel* channel)
+{
+  int fd = channel->fd();
+  assert(channelOf(fd) == channel);
+  channels_[fd] = NULL;
+  --numChannels_;
 }
 
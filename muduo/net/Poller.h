@@ -11,7 +11,6 @@
 #ifndef MUDUO_NET_POLLER_H
 #define MUDUO_NET_POLLER_H
 
-#include <map>
 #include <vector>
 
 #include <muduo/base/Timestamp.h>
@@ -54,6 +53,17 @@ class Poller : noncopyable
   virtual void removeChannel(Channel* channel) = 0;
 
   virtual bool hasChannel(Channel* channel) const;
+  /// All registered channels, in fd order.
+  void getChannels(ChannelList* channels) const;
+
+  /// true if Channel::edgeTriggered() is honoured, i.e. an armed event
+  /// is reported only once per readiness change.
+  /// PollPoller 总是水平触发的，这时不能一直关注 POLLOUT。
+  virtual bool edgeTriggeredSupported() const { return false; }
+
+  /// epoll_ctl(2) 一类修改内核关注事件的系统调用次数，
+  /// PollPoller 和 IoUringPoller 没有这种系统调用，总是 0。
+  int64_t interestSyscalls() const { return interestSyscalls_; }
 
   static Poller* newDefaultPoller(EventLoop* loop);
 
@@ -63,9 +73,21 @@ class Poller : noncopyable
   }
 
  protected:
-  /// 从fd到Channel*的映射
-  typedef std::map<int, Channel*> ChannelMap;
-  ChannelMap channels_;
+  /// NULL if fd is not in this Poller.
+  Channel* channelOf(int fd) const
+  {
+    return implicit_cast<size_t>(fd) < channels_.size() ? channels_[fd] : NULL;
+  }
+  void addChannel(Channel* channel);
+  void eraseChannel(Channel* channel);
+  size_t numChannels() const { return numChannels_; }
+
+  /// 从fd到Channel*的映射，以fd为下标。
+  /// 内核总是分配最小的可用fd，所以表是稠密的，查找只是一次数组访问，
+  /// 不像std::map那样每次都要沿着树走好几个节点。
+  std::vector<Channel*> channels_;
+  size_t numChannels_;
+  int64_t interestSyscalls_;
 
  private:
   EventLoop* ownerLoop_;
@@ -12,6 +12,7 @@
 #include <muduo/net/InetAddress.h>
 #include <muduo/net/SocketsOps.h>
 
+#include <linux/filter.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <stdio.h>  // snprintf
@@ -121,6 +122,48 @@ void Socket::setReusePort(bool on)
 #endif
 }
 
+bool Socket::setReusePortCpuMap(const std::vector<int>& indexOfCpu)
+{
+#ifdef SO_ATTACH_REUSEPORT_CBPF
+  // A = cpu; 逐个比较，命中时返回对应的下标，都不命中时返回一个越界的下标，
+  // 内核会退回到按四元组 hash 选择 socket。
+  std::vector<struct sock_filter> code;
+  code.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+                          static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU)));
+  for (size_t cpu = 0; cpu < indexOfCpu.size(); ++cpu)
+  {
+    if (indexOfCpu[cpu] >= 0)
+    {
+      code.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+                              static_cast<uint32_t>(cpu), 0, 1));
+      code.push_back(BPF_STMT(BPF_RET | BPF_K,
+                              static_cast<uint32_t>(indexOfCpu[cpu])));
+    }
+  }
+  code.push_back(BPF_STMT(BPF_RET | BPF_K, 0xffffffff));
+  if (code.size() > BPF_MAXINSNS)
+  {
+    LOG_ERROR << "SO_ATTACH_REUSEPORT_CBPF too many CPUs " << indexOfCpu.size();
+    return false;
+  }
+
+  struct sock_fprog prog;
+  prog.len = static_cast<unsigned short>(code.size());
+  prog.filter = code.data();
+  int ret = ::setsockopt(sockfd_, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF,
+                         &prog, static_cast<socklen_t>(sizeof prog));
+  if (ret < 0)
+  {
+    LOG_SYSERR << "SO_ATTACH_REUSEPORT_CBPF failed.";
+    return false;
+  }
+  return true;
+#else
+  LOG_ERROR << "SO_ATTACH_REUSEPORT_CBPF is not supported.";
+  return false;
+#endif
+}
+
 void Socket::setKeepAlive(bool on)
 {
   int optval = on ? 1 : 0;
@@ -129,3 +172,20 @@ void Socket::setKeepAlive(bool on)
   // FIXME CHECK
 }
 
+void Socket::setBusyPoll(int microseconds)
+{
+#ifdef SO_BUSY_POLL
+  int ret = ::setsockopt(sockfd_, SOL_SOCKET, SO_BUSY_POLL,
+                         &microseconds, static_cast<socklen_t>(sizeof microseconds));
+  if (ret < 0 && microseconds > 0)
+  {
+    LOG_SYSERR << "SO_BUSY_POLL failed.";
+  }
+#else
+  if (microseconds > 0)
+  {
+    LOG_ERROR << "SO_BUSY_POLL is not supported.";
+  }
+#endif
+}
+
@@ -13,6 +13,8 @@
 
 #include <muduo/base/noncopyable.h>
 
+#include <vector>
+
 // struct tcp_info is in <netinet/tcp.h>
 struct tcp_info;
 
@@ -75,11 +77,26 @@ class Socket : noncopyable
   ///
   void setReusePort(bool on);
 
+  ///
+  /// Attach a SO_ATTACH_REUSEPORT_CBPF program to the SO_REUSEPORT group,
+  /// a connection received on CPU c goes to the indexOfCpu[c]-th socket
+  /// (in the order they called listen()). Other CPUs, or a negative index,
+  /// fall back to the hash. Call it after listen().
+  /// return true if success.
+  ///
+  bool setReusePortCpuMap(const std::vector<int>& indexOfCpu);
+
   ///
   /// Enable/disable SO_KEEPALIVE
   ///
   void setKeepAlive(bool on);
 
+  ///
+  /// Set SO_BUSY_POLL, 0 to disable.
+  /// 超过 net.core.busy_read 需要 CAP_NET_ADMIN
+  ///
+  void setBusyPoll(int microseconds);
+
  private:
   const int sockfd_;
 };
@@ -14,8 +14,10 @@
 #include <muduo/net/EventLoop.h>
 #include <muduo/net/Socket.h>
 #include <muduo/net/SocketsOps.h>
+#include <muduo/net/poller/IoUringPoller.h>
 
 #include <errno.h>
+#include <sched.h>
 
 using namespace muduo;
 using namespace muduo::net;
@@ -41,15 +43,23 @@ TcpConnection::TcpConnection(EventLoop* loop,
                              const InetAddress& localAddr,
                              const InetAddress& peerAddr)
   : loop_(CHECK_NOTNULL(loop)),
+    dispatchLoop_(loop),
+    migrating_(false),
+    fastDispatches_(0),
+    migrationTarget_(NULL),
     name_(nameArg),
     state_(StateE::kConnecting),
     reading_(true),
     socket_(new Socket(sockfd)),
     channel_(new Channel(loop, sockfd)),
+    completionIo_(loop->completionIo()),
     localAddr_(localAddr),
     peerAddr_(peerAddr),
-    highWaterMark_(64*1024*1024)
+    highWaterMark_(64*1024*1024),
+    outputChain_(loop->blockPool()),
+    chainedOutput_(false)
 {
+  channel_->setName(name_);
   channel_->setReadCallback(
       std::bind(&TcpConnection::handleRead, this, _1));
   channel_->setWriteCallback(
@@ -61,6 +71,7 @@ TcpConnection::TcpConnection(EventLoop* loop,
   LOG_DEBUG << "TcpConnection::ctor[" <<  name_ << "] at " << this
             << " fd=" << sockfd;
   socket_->setKeepAlive(true);
+  getLoop()->addConnections(1);
 }
 
 TcpConnection::~TcpConnection()
@@ -93,14 +104,14 @@ void TcpConnection::send(const std::string_view& message)
 {
   if (state_ == StateE::kConnected)
   {
-    if (loop_->isInLoopThread())
+    if (getLoop()->isInLoopThread() && !migrating())
     {
       sendInLoop(message);
     }
     else
     {
       void (TcpConnection::*fp)(const std::string_view& message) = &TcpConnection::sendInLoop;
-      loop_->runInLoop(
+      queueInLoop(
           std::bind(fp,
                     shared_from_this(),
                     string(message))); // 如果传入的是右值std::string 隐式转换为std::string_view，在这里会发生拷贝
@@ -123,14 +134,14 @@ void TcpConnection::send(std::string&& message)
 {
   if (state_ == StateE::kConnected)
   {
-    if (loop_->isInLoopThread())
+    if (getLoop()->isInLoopThread() && !migrating())
     {
       sendInLoop(std::move(message)); // 这种情况下，避免了拷贝
     }
     else
     {
       void (TcpConnection::*fp)(const std::string_view& message) = &TcpConnection::sendInLoop;
-      loop_->runInLoop(
+      queueInLoop(
           std::bind(fp,
                     shared_from_this(),
                     string(message))); // 为避免message 被销毁，这里需要拷贝
@@ -143,7 +154,7 @@ void TcpConnection::send(Buffer* buf)
 {
   if (state_ == StateE::kConnected)
   {
-    if (loop_->isInLoopThread())
+    if (getLoop()->isInLoopThread() && !migrating())
     {
       sendInLoop(buf->peek(), buf->readableBytes());
       buf->retrieveAll();
@@ -151,7 +162,7 @@ void TcpConnection::send(Buffer* buf)
     else
     {
       void (TcpConnection::*fp)(const std::string_view& message) = &TcpConnection::sendInLoop;
-      loop_->runInLoop(
+      queueInLoop(
           std::bind(fp,
                     shared_from_this(),
                     buf->retrieveAllAsString()));
@@ -172,7 +183,7 @@ void TcpConnection::sendInLoop(std::string&& message)
 
 void TcpConnection::sendInLoop(const void* data, size_t len)
 {
-  loop_->assertInLoopThread();
+  getLoop()->assertInLoopThread();
   ssize_t nwrote = 0;
   size_t remaining = len;
   bool faultError = false;
@@ -183,7 +194,8 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
   }
   // if no thing in output queue, try writing directly
   // 如果当前outputBuffer_已经有待发送的数据，那么就不能先尝试发送了，因为这会造成数据乱序。
-  if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
+  // completionIo_ 模式下不直接写，留到下一次 poll() 与其他连接的发送一起提交。
+  if (!completionIo_ && !isWriting() && outputBytes() == 0)
   {
     nwrote = sockets::write(channel_->fd(), data, len);
     if (nwrote >= 0)
@@ -192,7 +204,7 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
       // 如果一次发送完毕就不会启用WriteCallback。直接启用WriteCompleteCallback。
       if (remaining == 0 && writeCompleteCallback_)
       {
-        loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+        queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
       }
     }
     else // nwrote < 0
@@ -204,6 +216,11 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
         if (errno == EPIPE || errno == ECONNRESET) // FIXME: any others?
         {
           faultError = true;
+          // stopRead() 之后 Channel 什么事件都没有关注，不会再有通知发现这个错误
+          if (!channel_->isReading())
+          {
+            forceCloseInLoop();
+          }
         }
       }
     }
@@ -213,41 +230,69 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
   // 如果只发送了部分数据，则把剩余的数据放入outputBuffer_，并开始关注writable事件，以后在handlerWrite()中发送剩余的数据
   if (!faultError && remaining > 0)
   {
-    size_t oldLen = outputBuffer_.readableBytes();
+    size_t oldLen = outputBytes() + sendingBuffer_.readableBytes();
     if (oldLen + remaining >= highWaterMark_
         && oldLen < highWaterMark_
         && highWaterMarkCallback_)
     {
-      loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
+      queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
     }
-    outputBuffer_.append(static_cast<const char*>(data)+nwrote, remaining);
-    if (!channel_->isWriting())
+    if (chainedOutput_)
+    {
+      outputChain_.append(static_cast<const char*>(data)+nwrote, remaining);
+    }
+    else
+    {
+      outputBuffer_.append(static_cast<const char*>(data)+nwrote, remaining);
+    }
+    if (completionIo_)
+    {
+      if (!isWriting())
+      {
+        startSendCompletion();
+      }
+    }
+    else if (!channel_->isWriting())
     {
       channel_->enableWriting();
     }
   }
 }
 
+bool TcpConnection::isWriting() const
+{
+  if (completionIo_)
+  {
+    return completionIo_->sending(channel_.get());
+  }
+  // 边沿触发时 EPOLLOUT 一直注册着，是否在写要看输出缓冲区
+  if (channel_->edgeTriggered())
+  {
+    return channel_->isWriting() && outputBytes() > 0;
+  }
+  return channel_->isWriting();
+}
+
 void TcpConnection::shutdown()
 {
   // if (state_ == StateE::kConnected)
   // {
   //   setState(StateE::kDisconnecting);
-  //   loop_->runInLoop(std::bind(&TcpConnection::shutdownInLoop, shared_from_this()));
+  //   getLoop()->runInLoop(std::bind(&TcpConnection::shutdownInLoop, shared_from_this()));
   // }
 
   // The compare and swap way
   StateE Connected = StateE::kConnected;
   if (state_.compare_exchange_strong(Connected, StateE::kDisconnecting))
   {
-    loop_->runInLoop(std::bind(&TcpConnection::shutdownInLoop, shared_from_this()));
+    runInLoop(std::bind(&TcpConnection::shutdownInLoop, shared_from_this()));
   }
 }
 
 void TcpConnection::shutdownInLoop()
 {
-  loop_->assertInLoopThread();
-  if (!channel_->isWriting())
+  getLoop()->assertInLoopThread();
+  if (!isWriting())
   {
     // we are not writing
     socket_->shutdownWrite();
@@ -260,19 +305,19 @@ void TcpConnection::shutdownInLoop()
 //   if (state_ == StateE::kConnected)
 //   {
 //     setState(StateE::kDisconnecting);
-//     loop_->runInLoop(std::bind(&TcpConnection::shutdownAndForceCloseInLoop, this, seconds));
+//     getLoop()->runInLoop(std::bind(&TcpConnection::shutdownAndForceCloseInLoop, this, seconds));
 //   }
 // }
 
 // void TcpConnection::shutdownAndForceCloseInLoop(double seconds)
 // {
-//   loop_->assertInLoopThread();
+//   getLoop()->assertInLoopThread();
 //   if (!channel_->isWriting())
 //   {
 //     // we are not writing
 //     socket_->shutdownWrite();
 //   }
-//   loop_->runAfter(
+//   getLoop()->runAfter(
 //       seconds,
 //       makeWeakCallback(shared_from_this(),
 //                        &TcpConnection::forceCloseInLoop));
@@ -283,7 +328,7 @@ void TcpConnection::forceClose()
   // if (state_ == StateE::kConnected || state_ == StateE::kDisconnecting)
   // {
   //   setState(StateE::kDisconnecting);
-  //   loop_->queueInLoop(std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
+  //   getLoop()->queueInLoop(std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
   // }
 
   // The compare and swap way
@@ -292,7 +337,7 @@ void TcpConnection::forceClose()
   if (state_.compare_exchange_strong(Connected, Disconnecting) ||
       state_.compare_exchange_strong(Disconnecting, Disconnecting))
   {
-    loop_->queueInLoop(std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
+    queueInLoop(std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
   }
 }
 
@@ -301,7 +346,7 @@ void TcpConnection::forceCloseWithDelay(double seconds)
   // if (state_ == StateE::kConnected || state_ == StateE::kDisconnecting)
   // {
   //   setState(StateE::kDisconnecting);
-  //   loop_->runAfter(
+  //   getLoop()->runAfter(
   //       seconds,
   //       makeWeakCallback(shared_from_this(),
   //                        &TcpConnection::forceClose));  // not forceCloseInLoop to avoid race condition
@@ -313,7 +358,7 @@ void TcpConnection::forceCloseWithDelay(double seconds)
   if (state_.compare_exchange_strong(Connected, Disconnecting) ||
       state_.compare_exchange_strong(Disconnecting, Disconnecting))
   {
-    loop_->runAfter(
+    getLoop()->runAfter(
         seconds,
         makeWeakCallback(shared_from_this(),
                          &TcpConnection::forceClose));  // not forceCloseInLoop to avoid race condition
@@ -322,7 +367,7 @@ void TcpConnection::forceCloseWithDelay(double seconds)
 
 void TcpConnection::forceCloseInLoop()
 {
-  loop_->assertInLoopThread();
+  getLoop()->assertInLoopThread();
   if (state_ == StateE::kConnected || state_ == StateE::kDisconnecting)
   {
     // as if we received 0 byte in handleRead();
@@ -352,15 +397,47 @@ void TcpConnection::setTcpNoDelay(bool on)
   socket_->setTcpNoDelay(on);
 }
 
+void TcpConnection::setBusyPoll(int microseconds)
+{
+  socket_->setBusyPoll(microseconds);
+}
+
+void TcpConnection::setChainedOutput(bool on)
+{
+  assert(state_ == StateE::kConnecting || getLoop()->isInLoopThread());
+  assert(outputBytes() == 0);
+  if (!completionIo_)
+  {
+    chainedOutput_ = on;
+  }
+}
+
+void TcpConnection::setEdgeTriggered(bool on)
+{
+  assert(state_ == StateE::kConnecting);
+  if (!completionIo_ && getLoop()->edgeTriggeredSupported())
+  {
+    channel_->setEdgeTriggered(on);
+  }
+}
+
 void TcpConnection::startRead()
 {
-  loop_->runInLoop(std::bind(&TcpConnection::startReadInLoop, this));
+  runInLoop(std::bind(&TcpConnection::startReadInLoop, this));
 }
 
 void TcpConnection::startReadInLoop()
 {
-  loop_->assertInLoopThread();
-  if (!reading_ || !channel_->isReading())
+  getLoop()->assertInLoopThread();
+  if (completionIo_)
+  {
+    if (!reading_)
+    {
+      completionIo_->startRecv(channel_.get());
+      reading_ = true;
+    }
+  }
+  else if (!reading_ || !channel_->isReading())
   {
     channel_->enableReading();
     reading_ = true;
@@ -369,13 +446,21 @@ void TcpConnection::startReadInLoop()
 
 void TcpConnection::stopRead()
 {
-  loop_->runInLoop(std::bind(&TcpConnection::stopReadInLoop, this));
+  runInLoop(std::bind(&TcpConnection::stopReadInLoop, this));
 }
 
 void TcpConnection::stopReadInLoop()
 {
-  loop_->assertInLoopThread();
-  if (reading_ || channel_->isReading())
+  getLoop()->assertInLoopThread();
+  if (completionIo_)
+  {
+    if (reading_)
+    {
+      completionIo_->stopRecv(channel_.get());
+      reading_ = false;
+    }
+  }
+  else if (reading_ || channel_->isReading())
   {
     channel_->disableReading();
     reading_ = false;
@@ -384,18 +469,34 @@ void TcpConnection::stopReadInLoop()
 
 void TcpConnection::connectEstablished()
 {
-  loop_->assertInLoopThread();
+  getLoop()->assertInLoopThread();
   assert(state_ == StateE::kConnecting);
   setState(StateE::kConnected);
   channel_->tie(shared_from_this());
-  channel_->enableReading();
+  if (completionIo_)
+  {
+    completionIo_->startRecv(channel_.get());
+  }
+  else
+  {
+    channel_->enableReading();
+    if (channel_->edgeTriggered())
+    {
+      channel_->enableWriting();
+    }
+  }
 
   connectionCallback_(shared_from_this());
 }
 
 void TcpConnection::connectDestroyed()
 {
-  loop_->assertInLoopThread();
+  if (!getLoop()->isInLoopThread() || migrating())
+  {
+    // 迁移期间，或者迁移之后从原来的 loop 调用，到新的 loop 里执行
+    queueInLoop(std::bind(&TcpConnection::connectDestroyed, shared_from_this()));
+    return;
+  }
   // 这部分代码和 handleClose 中的代码有重复部分，
   // 因为某些情况下可以不经由handleClose()而直接调用connectDestroyed()
   if (state_ == StateE::kConnected)
@@ -406,22 +507,208 @@ void TcpConnection::connectDestroyed()
     connectionCallback_(shared_from_this());
   }
   channel_->remove();
+  // 没发出去的块在这里还给 pool；~ChainBuffer 可能在别的线程运行，只能直接释放
+  outputChain_.retrieveAll();
+  getLoop()->addConnections(-1);
+}
+
+int64_t TcpConnection::handledMicroSeconds() const
+{
+  getLoop()->assertInLoopThread();
+  return channel_->handledMicroSeconds();
+}
+
+void TcpConnection::runInLoop(Functor cb)
+{
+  if (getLoop()->isInLoopThread() && !migrating())
+  {
+    cb();
+  }
+  else
+  {
+    queueInLoop(std::move(cb));
+  }
+}
+
+void TcpConnection::queueInLoop(Functor cb)
+{
+  EventLoop* loop = getLoop();
+  // 迁移只在所属的 loop 线程里开始，这里不会和它竞争
+  if (loop->isInLoopThread() && !migrating())
+  {
+    loop->queueInLoop(std::move(cb));
+    return;
+  }
+  // 没有在迁移时直接送到所属的 loop。fastDispatches_ 和 migrating_ 构成 Dekker 式的握手：
+  // 要么这里看到 migrating_，要么 migrateInLoop() 看到计数，等这次 push 完成再排 handOver()。
+  fastDispatches_.fetch_add(1);
+  if (!migrating_.load())
+  {
+    getLoop()->queueInLoop(std::move(cb));
+    fastDispatches_.fetch_sub(1, std::memory_order_release);
+    return;
+  }
+  fastDispatches_.fetch_sub(1, std::memory_order_release);
+
+  TcpConnectionPtr guardThis(shared_from_this());
+  MutexLockGuard lock(dispatchMutex_);
+  dispatchLoop_->queueInLoop(
+      [guardThis, cb = std::move(cb)]() mutable { guardThis->runOrDefer(cb); });
+}
+
+void TcpConnection::runOrDefer(Functor& cb)
+{
+  if (migrating() && migrationTarget_->isInLoopThread())
+  {
+    // 先到了新 loop，等 takeOver()
+    deferred_.push_back(std::move(cb));
+    return;
+  }
+  getLoop()->assertInLoopThread();
+  cb();
+}
+
+void TcpConnection::migrateTo(EventLoop* loop)
+{
+  // 总是排队，不在事件处理的中途摘掉 Channel
+  queueInLoop(std::bind(&TcpConnection::migrateInLoop, shared_from_this(), loop));
+}
+
+// 迁移分三步：
+// 1. migrateInLoop()：以后的跨线程调用都送到新 loop，暂不执行；
+// 2. handOver()：原来 loop 里排在前面的调用都执行完了，从原来的 Poller 摘下 Channel；
+// 3. takeOver()：在新 loop 里注册 Channel，执行暂存的调用。
+// 第 2 步之前连接的事件仍然由原来的 loop 处理，数据留在 socket 和两个 Buffer 里，不会丢。
+void TcpConnection::migrateInLoop(EventLoop* loop)
+{
+  EventLoop* from = getLoop();
+  from->assertInLoopThread();
+  if (completionIo_)
+  {
+    // 内核里还有这个 socket 的 recv/send，不能从 Poller 上摘下来
+    LOG_WARN << "TcpConnection::migrateTo [" << name_
+             << "] is not supported in completion mode, ignored";
+    return;
+  }
+  if (state_ != StateE::kConnected || migrating() || loop == from)
+  {
+    LOG_DEBUG << "TcpConnection::migrateTo [" << name_ << "] ignored, state = "
+              << stateToString();
+    return;
+  }
+  LOG_DEBUG << "TcpConnection::migrateTo [" << name_ << "] from " << from
+            << " to " << loop;
+  migrationTarget_ = loop;
+  migrating_.store(true);
+  // 等没看到 migrating_ 的那几个 queueInLoop() 把调用放进原来的 loop，
+  // 它们只差一次 push，很快就会完成
+  while (fastDispatches_.load() != 0)
+  {
+    ::sched_yield();
+  }
+  MutexLockGuard lock(dispatchMutex_);
+  dispatchLoop_ = loop;
+  // 在锁里排队，之前送到原来 loop 的调用都在它前面
+  from->queueInLoop(std::bind(&TcpConnection::handOver, shared_from_this()));
+}
+
+void TcpConnection::handOver()
+{
+  EventLoop* from = getLoop();
+  EventLoop* to = migrationTarget_;
+  from->assertInLoopThread();
+  assert(migrating());
+  // 期间可能已经关闭，Channel 还在原来的 Poller 里，connectDestroyed() 时再 remove()
+  channel_->disableAll();
+  channel_->remove();
+  channel_->setLoop(to);
+  from->addConnections(-1);
+  to->addConnections(1);
+  loop_.store(to, std::memory_order_release);
+  to->queueInLoop(std::bind(&TcpConnection::takeOver, shared_from_this()));
+}
+
+void TcpConnection::takeOver()
+{
+  getLoop()->assertInLoopThread();
+  outputChain_.setPool(getLoop()->blockPool());
+  if (state_ == StateE::kConnected || state_ == StateE::kDisconnecting)
+  {
+    // 迁移期间到达的数据在 socket 里，注册之后马上可读
+    if (reading_)
+    {
+      channel_->enableReading();
+    }
+    if (channel_->edgeTriggered() || outputBytes() > 0)
+    {
+      channel_->enableWriting();
+    }
+  }
+  else
+  {
+    // 已经关闭，也要登记到新的 Poller，connectDestroyed() 时 remove()
+    channel_->disableAll();
+  }
+  migrating_.store(false, std::memory_order_release);
+  std::vector<Functor> deferred;
+  deferred.swap(deferred_);
+  for (Functor& cb : deferred)
+  {
+    cb();
+  }
 }
 
 void TcpConnection::handleRead(Timestamp receiveTime)
 {
-  loop_->assertInLoopThread();
+  getLoop()->assertInLoopThread();
+  if (state_ == StateE::kDisconnected)
+  {
+    // 同一次事件里 POLLHUP 已经关闭了连接，随后的 POLLRDHUP 又进到这里；
+    // completionIo_ 下也可能是 handleClose() 之前已经收到的数据或 EOF。不再交给用户
+    return;
+  }
+  // 边沿触发时必须读到 EAGAIN，否则剩下的数据不会再有通知。
+  // 每次 readFd() 之后都调用 messageCallback_，与水平触发时一样，
+  // 回调里 stopRead() 或者关闭连接之后就不再读了。
+  int reads = 0;
   int savedErrno = 0;
-  ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+  ssize_t n = 0;
+  do
+  {
+    n = completionIo_
+        ? completionIo_->readReceived(channel_.get(), &inputBuffer_, &savedErrno)
+        : inputBuffer_.readFd(channel_->fd(), &savedErrno);
+    if (n > 0)
+    {
+      messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+    }
+  } while (n > 0 && channel_->edgeTriggered() && channel_->isReading()
+           && ++reads < kMaxReadsPerEvent);
+
   if (n > 0)
   {
-    messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+    if (reads == kMaxReadsPerEvent)
+    {
+      // 还没读到 EAGAIN，先让本轮其他连接处理完，再接着读
+      queueInLoop(std::bind(&TcpConnection::resumeRead, shared_from_this()));
+    }
   }
   else if (n == 0)
   {
     handleClose();
   }
-  else
+  else if (completionIo_)
+  {
+    // 没有注册 POLL_ADD，收不到 POLLHUP/POLLERR，recv 出错之后也不再提交，
+    // 只能在这里关闭连接，否则它永远停在 kConnected
+    if (savedErrno != EAGAIN && savedErrno != ENOBUFS)
+    {
+      errno = savedErrno;
+      LOG_SYSERR << "TcpConnection::handleRead";
+      handleClose();
+    }
+  }
+  else if (!(channel_->edgeTriggered() && savedErrno == EAGAIN))
   {
     errno = savedErrno;
     LOG_SYSERR << "TcpConnection::handleRead";
@@ -429,23 +716,56 @@ void TcpConnection::handleRead(Timestamp receiveTime)
   }
 }
 
+void TcpConnection::resumeRead()
+{
+  getLoop()->assertInLoopThread();
+  // 期间可能已经 stopRead() 或者关闭
+  if (channel_->isReading())
+  {
+    handleRead(getLoop()->pollReturnTime());
+  }
+}
+
 void TcpConnection::handleWrite()
 {
-  loop_->assertInLoopThread();
-  if (channel_->isWriting())
+  getLoop()->assertInLoopThread();
+  if (completionIo_)
   {
-    ssize_t n = sockets::write(channel_->fd(),
-                               outputBuffer_.peek(),
-                               outputBuffer_.readableBytes());
+    handleSendCompletion();
+  }
+  else if (isWriting())
+  {
+    // 边沿触发时也只写一次：没写完说明发送缓冲区满了，
+    // 内核在腾出空间时会再给一次 EPOLLOUT。
+    ssize_t n = 0;
+    if (chainedOutput_)
+    {
+      // 一次 writev 写出多个块，已经 retrieve
+      int savedErrno = 0;
+      n = outputChain_.writeFd(channel_->fd(), &savedErrno);
+      errno = savedErrno;
+    }
+    else
+    {
+      n = sockets::write(channel_->fd(),
+                         outputBuffer_.peek(),
+                         outputBuffer_.readableBytes());
+      if (n > 0)
+      {
+        outputBuffer_.retrieve(n);
+      }
+    }
     if (n > 0)
     {
-      outputBuffer_.retrieve(n);
-      if (outputBuffer_.readableBytes() == 0)
+      if (outputBytes() == 0)
       {
-        channel_->disableWriting();
+        if (!channel_->edgeTriggered())
+        {
+          channel_->disableWriting();
+        }
         if (writeCompleteCallback_)
         {
-          loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+          queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
         }
         // 如果这时连接正在关闭，则调用shutdownInLoop()，继续执行关闭过程。
         if (state_ == StateE::kDisconnecting)
@@ -463,21 +783,84 @@ void TcpConnection::handleWrite()
       // }
     }
   }
-  else
+  else if (!channel_->edgeTriggered() || !channel_->isWriting())
   {
+    // 边沿触发时没有数据要写也会收到 EPOLLOUT，这是正常的
     LOG_TRACE << "Connection fd = " << channel_->fd()
               << " is down, no more writing";
   }
 }
 
+void TcpConnection::startSendCompletion()
+{
+  // 上一次发送剩下的先发，保证顺序
+  if (sendingBuffer_.readableBytes() == 0)
+  {
+    sendingBuffer_.swap(outputBuffer_);
+  }
+  // 发送完成之前连接不能析构，sendingBuffer_ 还在内核手里
+  completionIo_->startSend(channel_.get(),
+                           sendingBuffer_.peek(),
+                           sendingBuffer_.readableBytes(),
+                           shared_from_this());
+}
+
+void TcpConnection::handleSendCompletion()
+{
+  int savedErrno = 0;
+  ssize_t n = completionIo_->takeSendResult(channel_.get(), &savedErrno);
+  if (state_ == StateE::kDisconnected)
+  {
+    LOG_TRACE << "Connection fd = " << channel_->fd()
+              << " is down, no more writing";
+  }
+  else if (n >= 0)
+  {
+    sendingBuffer_.retrieve(n);
+    if (sendingBuffer_.readableBytes() > 0 || outputBuffer_.readableBytes() > 0)
+    {
+      startSendCompletion();
+    }
+    else
+    {
+      if (writeCompleteCallback_)
+      {
+        queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+      }
+      if (state_ == StateE::kDisconnecting)
+      {
+        shutdownInLoop();
+      }
+    }
+  }
+  else if (savedErrno == ENOBUFS)
+  {
+    // 暂时分配不到内存，数据都还在 sendingBuffer_ 里，重新提交
+    startSendCompletion();
+  }
+  else if (savedErrno != EAGAIN)
+  {
+    errno = savedErrno;
+    LOG_SYSERR << "TcpConnection::handleWrite";
+    // stopRead() 之后没有 recv 在等，读那一侧不一定会发现，直接关闭
+    sendingBuffer_.retrieveAll();
+    outputBuffer_.retrieveAll();
+    handleClose();
+  }
+}
+
 void TcpConnection::handleClose()
 {
-  loop_->assertInLoopThread();
+  getLoop()->assertInLoopThread();
   LOG_TRACE << "fd = " << channel_->fd() << " state = " << stateToString();
   assert(state_ == StateE::kConnected || state_ == StateE::kDisconnecting);
   // we don't close fd, leave it to dtor, so we can find leaks easily.
   setState(StateE::kDisconnected);
   channel_->disableAll();
+  if (completionIo_)
+  {
+    completionIo_->stopRecv(channel_.get());
+  }
 
   TcpConnectionPtr guardThis(shared_from_this());
   connectionCallback_(guardThis);
@@ -11,16 +11,20 @@
 #ifndef MUDUO_NET_TCPCONNECTION_H
 #define MUDUO_NET_TCPCONNECTION_H
 
+#include <muduo/base/InplaceFunction.h>
+#include <muduo/base/Mutex.h>
 #include <muduo/base/noncopyable.h>
 #include <muduo/base/StringPiece.h>
 #include <muduo/base/Types.h>
 #include <muduo/net/Callbacks.h>
 #include <muduo/net/Buffer.h>
+#include <muduo/net/ChainBuffer.h>
 #include <muduo/net/InetAddress.h>
 
 #include <any>
 #include <memory>
 #include <atomic>
+#include <vector>
 
 // struct tcp_info is in <netinet/tcp.h>
 struct tcp_info;
@@ -32,6 +36,7 @@ namespace net
 
 class Channel;
 class EventLoop;
+class IoUringPoller;
 class Socket;
 
 ///
@@ -53,7 +58,8 @@ class TcpConnection : noncopyable,
                 const InetAddress& peerAddr);
   ~TcpConnection();
 
-  EventLoop* getLoop() const { return loop_; }
+  /// 迁移之后会变，不要缓存；迁移期间从其他线程读到的可能是原来的 loop。
+  EventLoop* getLoop() const { return loop_.load(std::memory_order_acquire); }
   const string& name() const { return name_; }
   const InetAddress& localAddress() const { return localAddr_; }
   const InetAddress& peerAddress() const { return peerAddr_; }
@@ -75,11 +81,41 @@ class TcpConnection : noncopyable,
   void forceClose();
   void forceCloseWithDelay(double seconds);
   void setTcpNoDelay(bool on);
+  /// SO_BUSY_POLL, usually together with EventLoop::setBusyPoll().
+  void setBusyPoll(int microseconds);
+  /// 使用边沿触发（EPOLLET）：handleRead() 一直读到 EAGAIN，
+  /// EPOLLOUT 在整个连接期间保持注册，输出缓冲区清空/填满时不再 epoll_ctl。
+  /// Ignored if the poller does not support it or in completionIo mode.
+  /// Must be called before connectEstablished().
+  void setEdgeTriggered(bool on);
+  /// 输出缓冲区改用 ChainBuffer：追加大块数据时不搬动已有的数据，
+  /// handleWrite() 用 writev 一次写出多个块，写完的块还给 loop 的 BlockPool。
+  /// 适合大消息、慢速的接收方。outputBuffer() 此后总是空的。
+  /// Ignored in completionIo mode.
+  /// Must be called before connectEstablished(), or in the loop thread
+  /// while nothing is pending for output, e.g. in the connection callback.
+  void setChainedOutput(bool on);
   // reading or not
   void startRead();
   void stopRead();
   bool isReading() const { return reading_; }; // NOT thread safe, may race with start/stopReadInLoop
 
+  /// Moves the connection to another EventLoop of the same process:
+  /// detaches the socket from the current Poller, and re-registers it in
+  /// @c loop with its input/output buffers and callbacks.
+  /// send()/shutdown()/forceClose() etc. issued while moving are run in
+  /// @c loop afterwards, in order, nothing is lost.
+  /// Thread safe, asynchronous. Ignored unless connected, or while moving.
+  /// Not supported in completionIo mode (MUDUO_USE_IO_URING=completion):
+  /// the kernel holds recv/send requests on the socket, logs a warning
+  /// and keeps the connection where it is.
+  /// Only for TcpServer connections, TcpClient assumes its loop never changes.
+  void migrateTo(EventLoop* loop);
+  bool migrating() const { return migrating_.load(std::memory_order_acquire); }
+  /// 这个连接的事件回调累计耗时（微秒），迁移之后继续累计。
+  /// Must be called in the loop thread.
+  int64_t handledMicroSeconds() const;
+
   void setContext(const std::any& context)
   { context_ = context; }
 
@@ -108,6 +144,7 @@ class TcpConnection : noncopyable,
   Buffer* inputBuffer()
   { return &inputBuffer_; }
 
+  /// Always empty with setChainedOutput(true).
   Buffer* outputBuffer()
   { return &outputBuffer_; }
 
@@ -117,12 +154,16 @@ class TcpConnection : noncopyable,
   void setCloseCallback(const CloseCallback& cb)
   { closeCallback_ = cb; }
 
+  // 边沿触发时一次可读事件最多 readFd() 的次数，读不完的留到本轮其他事件之后
+  static const int kMaxReadsPerEvent = 16;
+
   // called when TcpServer accepts a new connection
   void connectEstablished();   // should be called only once
   // called when TcpServer has removed me from its map
   void connectDestroyed();  // should be called only once
 
  private:
+
   enum class StateE {
     kDisconnected,
     kConnecting,
@@ -136,6 +177,12 @@ class TcpConnection : noncopyable,
   void handleWrite();
   void handleClose();
   void handleError();
+  void resumeRead();
+  void handleSendCompletion();
+  void startSendCompletion();
+  bool isWriting() const;
+  size_t outputBytes() const
+  { return outputBuffer_.readableBytes() + outputChain_.readableBytes(); }
   void sendInLoop(string&& message);
   void sendInLoop(const std::string_view& message);
   void sendInLoop(const void* message, size_t len);
@@ -146,13 +193,32 @@ class TcpConnection : noncopyable,
   void startReadInLoop();
   void stopReadInLoop();
 
-  EventLoop* loop_;
+  // 跨线程的调用都经由这两个函数送到所属的 loop；迁移期间改送到 dispatchLoop_，
+  // 先到了新 loop 的暂存在 deferred_，接手之后按顺序执行
+  typedef InplaceFunction<void()> Functor;
+  void runInLoop(Functor cb);
+  void queueInLoop(Functor cb);
+  void runOrDefer(Functor& cb);
+  void migrateInLoop(EventLoop* loop);
+  void handOver();
+  void takeOver();
+
+  std::atomic<EventLoop*> loop_;
+  // 迁移开始时先于 loop_ 切换到新 loop，此后的调用排在原来 loop 里的调用之后
+  MutexLock dispatchMutex_;
+  EventLoop* dispatchLoop_ GUARDED_BY(dispatchMutex_);
+  std::atomic<bool> migrating_;
+  std::atomic<int> fastDispatches_;  // 正在不加锁地送往所属 loop 的 queueInLoop() 个数
+  EventLoop* migrationTarget_;  // 迁移开始时写入，之后只读
+  std::vector<Functor> deferred_;  // 只在 migrationTarget_ 线程访问
   const string name_;
   std::atomic<StateE> state_;
   bool reading_;
   // we don't expose those classes to client.
   std::unique_ptr<Socket> socket_;
   std::unique_ptr<Channel> channel_;
+  // 非空时用 io_uring 收发数据（MUDUO_USE_IO_URING=completion），不再关注可读可写事件
+  IoUringPoller* const completionIo_;
   const InetAddress localAddr_;
   const InetAddress peerAddr_;
 
@@ -166,7 +232,12 @@ class TcpConnection : noncopyable,
   CloseCallback closeCallback_;
   size_t highWaterMark_;
   Buffer inputBuffer_;
-  Buffer outputBuffer_; // FIXME: use list<Buffer> as output buffer.
+  Buffer outputBuffer_;
+  ChainBuffer outputChain_;  // setChainedOutput(true) 时代替 outputBuffer_
+  bool chainedOutput_;
+  // completionIo_ 模式下正在发送的数据，内核完成之前不能改动；
+  // 这期间 send() 的数据追加到 outputBuffer_，一次发送完成后整体换过来
+  Buffer sendingBuffer_;
   // context 用于保存与 connection 绑定的任意数据，
   // 这样客户代码不必继承 TCPConnection 也可以 attach 自己的状态。
   std::any context_;
@@ -8,38 +8,72 @@
 
 #include <muduo/net/TcpServer.h>
 
+#include <muduo/base/CountDownLatch.h>
 #include <muduo/base/Logging.h>
 #include <muduo/net/Acceptor.h>
 #include <muduo/net/EventLoop.h>
 #include <muduo/net/EventLoopThreadPool.h>
 #include <muduo/net/SocketsOps.h>
 
+#include <algorithm>
+
+#include <math.h>
 #include <stdio.h>  // snprintf
 
 using namespace muduo;
 using namespace muduo::net;
 
+struct TcpServer::LoopAcceptor
+{
+  LoopAcceptor(EventLoop* ioLoop, int i, const InetAddress& listenAddr)
+    : loop(ioLoop),
+      index(i),
+      acceptor(new Acceptor(ioLoop, listenAddr, true)),
+      nextConnId(1)
+  {
+  }
+
+  EventLoop* loop;
+  const int index;
+  std::unique_ptr<Acceptor> acceptor;
+  // always in loop thread
+  int nextConnId;
+  ConnectionMap connections;
+};
+
 TcpServer::TcpServer(EventLoop* loop,
                      const InetAddress& listenAddr,
                      const string& nameArg,
                      Option option)
   : loop_(CHECK_NOTNULL(loop)),
+    listenAddr_(listenAddr),
     ipPort_(listenAddr.toIpPort()),
     name_(nameArg),
-    acceptor_(new Acceptor(loop, listenAddr, option == kReusePort)),
+    acceptor_(option == kReusePortPerLoop
+              ? nullptr : new Acceptor(loop, listenAddr, option == kReusePort)),
     threadPool_(new EventLoopThreadPool(loop, name_)),
     connectionCallback_(defaultConnectionCallback),
     messageCallback_(defaultMessageCallback),
+    edgeTriggered_(false),
+    chainedOutput_(false),
+    cpuSteering_(false),
+    maxAcceptsPerRead_(1),
+    rebalanceInterval_(0.0),
+    started_(0),
     nextConnId_(1)
 {
-  acceptor_->setNewConnectionCallback(
-      std::bind(&TcpServer::newConnection, this, _1, _2));
+  if (acceptor_)
+  {
+    acceptor_->setNewConnectionCallback(
+        std::bind(&TcpServer::newConnection, this, _1, _2));
+  }
 }
 
 TcpServer::~TcpServer()
 {
   loop_->assertInLoopThread();
   LOG_TRACE << "TcpServer::~TcpServer [" << name_ << "] destructing";
+  loop_->cancel(rebalanceTimer_);
 
   for (auto& item : connections_)
   {
@@ -48,6 +82,24 @@ TcpServer::~TcpServer()
     conn->getLoop()->runInLoop(
       std::bind(&TcpConnection::connectDestroyed, conn));
   }
+
+  // Acceptor 和连接表都只能在各自的 loop 线程里碰，等它们清理完再析构
+  CountDownLatch latch(static_cast<int>(loopAcceptors_.size()));
+  for (auto& la : loopAcceptors_)
+  {
+    LoopAcceptor* p = get_pointer(la);
+    p->loop->runInLoop([p, &latch] {
+      p->acceptor.reset();
+      for (auto& item : p->connections)
+      {
+        TcpConnectionPtr conn(item.second);
+        item.second.reset();
+        conn->connectDestroyed();
+      }
+      latch.countDown();
+    });
+  }
+  latch.wait();
 }
 
 void TcpServer::setThreadNum(int numThreads)
@@ -56,27 +108,125 @@ void TcpServer::setThreadNum(int numThreads)
   threadPool_->setThreadNum(numThreads);
 }
 
+void TcpServer::setThreadAffinity(const CpuAffinity& affinity)
+{
+  threadAffinity_ = affinity;
+  threadPool_->setAffinity(affinity);
+}
+
+void TcpServer::setMaxAcceptsPerRead(int n)
+{
+  assert(n > 0);
+  maxAcceptsPerRead_ = n;
+  if (acceptor_)
+  {
+    acceptor_->setMaxAcceptsPerRead(n);
+  }
+}
+
 void TcpServer::start()
 {
   if (started_.exchange(1) == 0)
   {
     threadPool_->start(threadInitCallback_);
 
-    assert(!acceptor_->listenning());
-    loop_->runInLoop(
-        std::bind(&Acceptor::listen, get_pointer(acceptor_)));
+    if (acceptor_)
+    {
+      assert(!acceptor_->listenning());
+      loop_->runInLoop(
+          std::bind(&Acceptor::listen, get_pointer(acceptor_)));
+    }
+    else
+    {
+      loop_->runInLoop(std::bind(&TcpServer::startAcceptorsPerLoop, this));
+    }
+
+    if (rebalanceInterval_ > 0)
+    {
+      if (!acceptor_)
+      {
+        LOG_WARN << "TcpServer::start [" << name_
+                 << "] - rebalancing is not supported with kReusePortPerLoop";
+      }
+      else if (loop_->completionIo())
+      {
+        // 所有 loop 用同一种 Poller，completion 模式下连接都不能迁移
+        LOG_WARN << "TcpServer::start [" << name_
+                 << "] - rebalancing is not supported in completion mode";
+      }
+      else
+      {
+        // 在 loop_ 线程里设定，dtor 里 cancel()
+        loop_->runInLoop([this] {
+          rebalanceTimer_ = loop_->runEvery(
+              std::max(rebalanceInterval_, EventLoopThreadPool::kLoadSampleSeconds),
+              std::bind(&TcpServer::rebalance, this));
+        });
+      }
+    }
   }
 }
 
-void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr)
+void TcpServer::startAcceptorsPerLoop()
 {
   loop_->assertInLoopThread();
-  EventLoop* ioLoop = threadPool_->getNextLoop();
-  char buf[64];
-  snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_);
-  ++nextConnId_;
-  string connName = name_ + buf;
+  std::vector<EventLoop*> loops = threadPool_->getAllLoops();
+  for (size_t i = 0; i < loops.size(); ++i)
+  {
+    LoopAcceptor* la = new LoopAcceptor(loops[i], static_cast<int>(i), listenAddr_);
+    loopAcceptors_.emplace_back(la);
+    la->acceptor->setMaxAcceptsPerRead(maxAcceptsPerRead_);
+    la->acceptor->setNewConnectionCallback(
+        std::bind(&TcpServer::newConnectionInLoop, this, la, _1, _2));
+  }
 
+  // 依次 listen()，SO_REUSEPORT 组里 socket 的下标就是 loop 的下标
+  for (auto& la : loopAcceptors_)
+  {
+    CountDownLatch latch(1);
+    Acceptor* acceptor = get_pointer(la->acceptor);
+    la->loop->runInLoop([acceptor, &latch] {
+      acceptor->listen();
+      latch.countDown();
+    });
+    latch.wait();
+  }
+
+  if (cpuSteering_ && loops.size() > 1)
+  {
+    std::vector<int> indexOfCpu;
+    for (size_t i = 0; i < loops.size(); ++i)
+    {
+      for (int cpu : threadAffinity_.cpusFor(static_cast<int>(i)))
+      {
+        if (implicit_cast<size_t>(cpu) >= indexOfCpu.size())
+        {
+          indexOfCpu.resize(cpu + 1, -1);
+        }
+        // 几个 loop 共享一个 CPU 时归第一个
+        if (indexOfCpu[cpu] < 0)
+        {
+          indexOfCpu[cpu] = static_cast<int>(i);
+        }
+      }
+    }
+    if (indexOfCpu.empty())
+    {
+      LOG_WARN << "TcpServer::start [" << name_
+               << "] - CPU steering needs setThreadAffinity()";
+    }
+    else
+    {
+      loopAcceptors_.front()->acceptor->setReusePortCpuMap(indexOfCpu);
+    }
+  }
+}
+
+TcpConnectionPtr TcpServer::createConnection(EventLoop* ioLoop,
+                                             const string& connName,
+                                             int sockfd,
+                                             const InetAddress& peerAddr)
+{
   LOG_INFO << "TcpServer::newConnection [" << name_
            << "] - new connection [" << connName
            << "] from " << peerAddr.toIpPort();
@@ -88,15 +238,52 @@ void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr)
                                                           sockfd,
                                                           localAddr,
                                                           peerAddr);
-  connections_[connName] = conn;
   conn->setConnectionCallback(connectionCallback_);
   conn->setMessageCallback(messageCallback_);
   conn->setWriteCompleteCallback(writeCompleteCallback_);
+  if (edgeTriggered_)
+  {
+    conn->setEdgeTriggered(true);
+  }
+  if (chainedOutput_)
+  {
+    conn->setChainedOutput(true);
+  }
+  return conn;
+}
+
+void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr)
+{
+  loop_->assertInLoopThread();
+  EventLoop* ioLoop = threadPool_->getNextLoop();
+  char buf[64];
+  snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_);
+  ++nextConnId_;
+  string connName = name_ + buf;
+
+  TcpConnectionPtr conn = createConnection(ioLoop, connName, sockfd, peerAddr);
+  connections_[connName] = conn;
   conn->setCloseCallback(
       std::bind(&TcpServer::removeConnection, this, _1)); // FIXME: unsafe but 通常TcpServer的生命期长于它建立的TcpConnection，因此不用担心TcpServer对象失效
   ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
 }
 
+void TcpServer::newConnectionInLoop(LoopAcceptor* la, int sockfd, const InetAddress& peerAddr)
+{
+  la->loop->assertInLoopThread();
+  char buf[64];
+  snprintf(buf, sizeof buf, "-%s#%d-%d", ipPort_.c_str(), la->index, la->nextConnId);
+  ++la->nextConnId;
+  string connName = name_ + buf;
+
+  TcpConnectionPtr conn = createConnection(la->loop, connName, sockfd, peerAddr);
+  la->connections[connName] = conn;
+  // 关闭回调也在 la->loop 里，不用跨线程
+  conn->setCloseCallback(
+      std::bind(&TcpServer::removeLoopConnection, this, la, _1));
+  conn->connectEstablished();
+}
+
 void TcpServer::removeConnection(const TcpConnectionPtr& conn)
 {
   // FIXME: unsafe
@@ -118,3 +305,125 @@ void TcpServer::removeConnectionInLoop(const TcpConnectionPtr& conn)
       std::bind(&TcpConnection::connectDestroyed, conn));
 }
 
+void TcpServer::removeLoopConnection(LoopAcceptor* la, const TcpConnectionPtr& conn)
+{
+  // 连接可能已经迁移到别的 loop，连接表只在 la->loop 里改
+  la->loop->runInLoop(
+      std::bind(&TcpServer::removeLoopConnectionInLoop, this, la, conn));
+}
+
+void TcpServer::removeLoopConnectionInLoop(LoopAcceptor* la, const TcpConnectionPtr& conn)
+{
+  la->loop->assertInLoopThread();
+  LOG_INFO << "TcpServer::removeLoopConnection [" << name_
+           << "] - connection " << conn->name();
+  size_t n = la->connections.erase(conn->name());
+  (void)n;
+  assert(n == 1);
+  conn->getLoop()->queueInLoop(
+      std::bind(&TcpConnection::connectDestroyed, conn));
+}
+
+namespace
+{
+
+// 一轮再平衡：在最忙的 loop 里量一段时间各个连接的回调耗时。
+// 不引用 TcpServer，它析构之后这一轮照样能安全地做完。
+struct RebalanceRound
+{
+  EventLoop* from;
+  EventLoop* to;
+  double gap;
+  std::vector<TcpConnectionPtr> connections;
+  std::vector<int64_t> handledMicroSeconds;
+  Timestamp start;
+};
+
+void finishRebalance(const std::shared_ptr<RebalanceRound>& round)
+{
+  round->from->assertInLoopThread();
+  double elapsed = timeDifference(Timestamp::now(), round->start)
+                   * Timestamp::kMicroSecondsPerSecond;
+  // 搬走占比 L 的连接之后差距变为 gap - 2L，选最接近 0 的，不能越搬越差
+  TcpConnectionPtr best;
+  double bestResidual = round->gap;
+  for (size_t i = 0; i < round->connections.size(); ++i)
+  {
+    const TcpConnectionPtr& conn = round->connections[i];
+    if (conn->getLoop() != round->from || !conn->connected())
+    {
+      continue;
+    }
+    double load = static_cast<double>(conn->handledMicroSeconds()
+                                      - round->handledMicroSeconds[i]) / elapsed;
+    double residual = fabs(round->gap - 2 * load);
+    if (load > 0 && residual < bestResidual)
+    {
+      best = conn;
+      bestResidual = residual;
+    }
+  }
+  if (best)
+  {
+    LOG_INFO << "TcpServer::rebalance - moving " << best->name()
+             << " from " << round->from << " to " << round->to
+             << ", busy gap " << round->gap << " -> " << bestResidual;
+    best->migrateTo(round->to);
+  }
+}
+
+void startRebalance(const std::shared_ptr<RebalanceRound>& round)
+{
+  round->from->assertInLoopThread();
+  for (const TcpConnectionPtr& conn : round->connections)
+  {
+    // 还没建立或者已经迁走的记 0，finishRebalance() 时跳过
+    round->handledMicroSeconds.push_back(
+        conn->getLoop() == round->from ? conn->handledMicroSeconds() : 0);
+  }
+  round->start = Timestamp::now();
+  round->from->runAfter(TcpServer::kRebalanceWindow,
+                        [round] { finishRebalance(round); });
+}
+
+}  // namespace
+
+const double TcpServer::kRebalanceGap = 0.2;
+const double TcpServer::kRebalanceWindow = 0.05;
+
+void TcpServer::rebalance()
+{
+  loop_->assertInLoopThread();
+  std::vector<EventLoopThreadPool::LoopLoad> loads = threadPool_->loads();
+  if (loads.size() < 2)
+  {
+    return;
+  }
+  auto byBusy = [](const EventLoopThreadPool::LoopLoad& lhs,
+                   const EventLoopThreadPool::LoopLoad& rhs)
+  { return lhs.busy < rhs.busy; };
+  auto coldest = std::min_element(loads.begin(), loads.end(), byBusy);
+  auto hottest = std::max_element(loads.begin(), loads.end(), byBusy);
+  double gap = hottest->busy - coldest->busy;
+  // 只有一个连接的 loop 搬过去也只是换个地方忙
+  if (gap < kRebalanceGap || hottest->connections < 2)
+  {
+    return;
+  }
+
+  std::shared_ptr<RebalanceRound> round(new RebalanceRound);
+  round->from = hottest->loop;
+  round->to = coldest->loop;
+  round->gap = gap;
+  for (const auto& item : connections_)
+  {
+    if (item.second->getLoop() == round->from && !item.second->migrating())
+    {
+      round->connections.push_back(item.second);
+    }
+  }
+  if (!round->connections.empty())
+  {
+    round->from->runInLoop([round] { startRebalance(round); });
+  }
+}
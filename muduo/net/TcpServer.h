@@ -12,10 +12,13 @@
 #define MUDUO_NET_TCPSERVER_H
 
 #include <atomic>
+#include <muduo/base/CpuAffinity.h>
 #include <muduo/base/Types.h>
 #include <muduo/net/TcpConnection.h>
+#include <muduo/net/TimerId.h>
 
 #include <map>
+#include <vector>
 
 namespace muduo
 {
@@ -39,6 +42,9 @@ class TcpServer : noncopyable
   {
     kNoReusePort,
     kReusePort,
+    // 每个 I/O loop 各自用一个 SO_REUSEPORT 的 Acceptor 接受连接，
+    // 连接就在接受它的 loop 里建立和服务，不经过 baseLoop。
+    kReusePortPerLoop,
   };
 
   //TcpServer(EventLoop* loop, const InetAddress& listenAddr);
@@ -62,10 +68,44 @@ class TcpServer : noncopyable
   /// - 1 means all I/O in another thread.
   /// - N means a thread pool with N threads, new connections
   ///   are assigned on a round-robin basis.
+  ///   With kReusePortPerLoop, each of the N threads accepts
+  ///   its own connections, the kernel spreads them by hash.
   void setThreadNum(int numThreads);
+  /// Pins I/O threads, see EventLoopThreadPool::setAffinity.
+  /// Must be called before @c start
+  void setThreadAffinity(const CpuAffinity& affinity);
+  /// With kReusePortPerLoop and pinned I/O threads, a connection goes to
+  /// the loop pinned to the CPU that received it (SO_ATTACH_REUSEPORT_CBPF),
+  /// so RSS/RPS decides the loop. CPUs without a loop fall back to the hash.
+  /// Must be called before @c start
+  void setReusePortCpuSteering(bool on) { cpuSteering_ = on; }
   void setThreadInitCallback(const ThreadInitCallback& cb)
   { threadInitCallback_ = cb; }
+  /// Accept up to n connections per readiness event, see Acceptor::setMaxAcceptsPerRead.
+  /// Must be called before @c start
+  void setMaxAcceptsPerRead(int n);
+  /// New connections use edge-triggered epoll, see TcpConnection::setEdgeTriggered.
+  /// Must be called before @c start
+  void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+  /// New connections use a chained output buffer, see TcpConnection::setChainedOutput.
+  /// Must be called before @c start
+  void setChainedOutput(bool on) { chainedOutput_ = on; }
+  /// Every @c seconds, if the busy ratios (EventLoopThreadPool::loads) of
+  /// the busiest and the least busy I/O loop differ by more than
+  /// kRebalanceGap, measures the connections of the busiest loop for
+  /// kRebalanceWindow and moves the one that best evens them out to the
+  /// least busy loop, see TcpConnection::migrateTo.
+  /// 0 disables it, the default. Ignored with kReusePortPerLoop, and
+  /// with MUDUO_USE_IO_URING=completion where connections cannot migrate.
+  /// Must be called before @c start
+  void setRebalanceInterval(double seconds) { rebalanceInterval_ = seconds; }
+
+  static const double kRebalanceGap;
+  static const double kRebalanceWindow;
   /// valid after calling start()
+  /// The pool itself exists from construction, placement policies
+  /// (EventLoopThreadPool::setPlacement) must be set before @c start.
+  /// kReusePortPerLoop ignores them, the kernel picks the loop.
   std::shared_ptr<EventLoopThreadPool> threadPool()
   { return threadPool_; }
 
@@ -91,12 +131,24 @@ class TcpServer : noncopyable
   { writeCompleteCallback_ = cb; }
 
  private:
+  struct LoopAcceptor;
+
   /// Not thread safe, but in loop
   void newConnection(int sockfd, const InetAddress& peerAddr);
+  /// kReusePortPerLoop, in la->loop
+  void newConnectionInLoop(LoopAcceptor* la, int sockfd, const InetAddress& peerAddr);
+  void removeLoopConnection(LoopAcceptor* la, const TcpConnectionPtr& conn);
+  void startAcceptorsPerLoop();
+  TcpConnectionPtr createConnection(EventLoop* ioLoop, const string& connName,
+                                    int sockfd, const InetAddress& peerAddr);
   /// Thread safe.
   void removeConnection(const TcpConnectionPtr& conn);
   /// Not thread safe, but in loop
   void removeConnectionInLoop(const TcpConnectionPtr& conn);
+  /// kReusePortPerLoop, in la->loop
+  void removeLoopConnectionInLoop(LoopAcceptor* la, const TcpConnectionPtr& conn);
+  /// in loop
+  void rebalance();
 
   // TcpServer持有目前存活的TcpConnection的shared_ptr（定义为TcpConnectionPtr），
   // 因为TcpConnection对象的生命期是模糊的，用户也可以持有TcpConnectionPtr。
@@ -105,18 +157,28 @@ class TcpServer : noncopyable
   typedef std::map<string, TcpConnectionPtr> ConnectionMap;
 
   EventLoop* loop_;  // the acceptor loop
+  const InetAddress listenAddr_;
   const string ipPort_;
   const string name_;
-  std::unique_ptr<Acceptor> acceptor_; // avoid revealing Acceptor
+  std::unique_ptr<Acceptor> acceptor_; // avoid revealing Acceptor, null if kReusePortPerLoop
   std::shared_ptr<EventLoopThreadPool> threadPool_;
   ConnectionCallback connectionCallback_;
   MessageCallback messageCallback_;
   WriteCompleteCallback writeCompleteCallback_;
   ThreadInitCallback threadInitCallback_;
+  bool edgeTriggered_;
+  bool chainedOutput_;
+  bool cpuSteering_;
+  int maxAcceptsPerRead_;
+  double rebalanceInterval_;
+  TimerId rebalanceTimer_;
+  CpuAffinity threadAffinity_;
   std::atomic_int32_t started_;
   // always in loop thread
   int nextConnId_;
   ConnectionMap connections_;
+  // kReusePortPerLoop, 每个 I/O loop 一份，各自只在自己的 loop 线程里访问
+  std::vector<std::unique_ptr<LoopAcceptor>> loopAcceptors_;
 };
 
 }  // namespace net
@@ -27,11 +27,12 @@ namespace net
 class Timer : noncopyable
 {
  public:
-  Timer(TimerCallback cb, Timestamp when, double interval)
+  Timer(TimerCallback cb, Timestamp when, double interval, double slack = 0.0)
     : callback_(std::move(cb)),
       expiration_(when),
       interval_(interval),
       repeat_(interval > 0.0),
+      slack_(static_cast<int64_t>(slack * Timestamp::kMicroSecondsPerSecond)),
       sequence_(s_numCreated_.fetch_add(1) + 1)
   { }
 
@@ -41,19 +42,40 @@ class Timer : noncopyable
   }
 
   Timestamp expiration() const  { return expiration_; }
+  /// expiration() + slack, the timer may fire anywhere in between.
+  Timestamp latest() const
+  { return Timestamp(expiration_.microSecondsSinceEpoch() + slack_); }
   bool repeat() const { return repeat_; }
-  int64_t sequence() const { return sequence_; }
+  // 池化的 Timer 可能正被其他线程的 TimingWheel::newTimer() 重新初始化
+  int64_t sequence() const { return sequence_.load(std::memory_order_relaxed); }
 
   void restart(Timestamp now);
 
   static int64_t numCreated() { return s_numCreated_.load(); }
 
  private:
-  const TimerCallback callback_;
+  friend class TimingWheel;
+
+  // for TimingWheel's pool
+  Timer()
+    : interval_(0.0),
+      repeat_(false),
+      slack_(0),
+      sequence_(0)
+  { }
+
+  TimerCallback callback_;
   Timestamp expiration_;
-  const double interval_;
-  const bool repeat_;
-  const int64_t sequence_; // 全局递增的序列号int64_t sequence_ ，用于区分地址相同的先后两个Timer对象。
+  double interval_;
+  bool repeat_;
+  int64_t slack_;  // in microseconds
+  std::atomic<int64_t> sequence_; // 全局递增的序列号int64_t sequence_ ，用于区分地址相同的先后两个Timer对象。
+
+  // used by TimingWheel, 同一个槽位的 Timer 串成双向链表
+  Timer* wheelPrev_ = nullptr;
+  Timer* wheelNext_ = nullptr;  // 在池中空闲时是 free list 的下一项
+  int64_t wheelTick_ = 0;       // 到期的 tick
+  int wheelSlot_ = -1;          // -1 表示不在轮子上
 
   static std::atomic_int64_t s_numCreated_; // 原子计数器，用于生成 sequence_
 };
@@ -16,6 +16,7 @@
 #include <muduo/net/EventLoop.h>
 #include <muduo/net/Timer.h>
 #include <muduo/net/TimerId.h>
+#include <muduo/net/TimingWheel.h>
 
 #include <sys/timerfd.h>
 #include <unistd.h>
@@ -93,11 +94,15 @@ TimerQueue::TimerQueue(EventLoop* loop)
     timerfd_(createTimerfd()),
     timerfdChannel_(loop, timerfd_),
     timers_(),
-    callingExpiredTimers_(false)
+    callingExpiredTimers_(false),
+    stats_(),
+    wheelArmedTick_(TimingWheel::kNoTick)
 {
+  timerfdChannel_.setName("timerfd");
   timerfdChannel_.setReadCallback(
       std::bind(&TimerQueue::handleRead, this));
   // we are always reading the timerfd, we disarm it with timerfd_settime.
+  timerfdChannel_.setEdgeTriggered(true);
   timerfdChannel_.enableReading();
 }
 
@@ -115,12 +120,23 @@ TimerQueue::~TimerQueue()
 
 TimerId TimerQueue::addTimer(TimerCallback cb,
                              Timestamp when,
-                             double interval)
+                             double interval,
+                             double slack)
 {
-  Timer* timer = new Timer(std::move(cb), when, interval);
+  Timer* timer = wheel_ ? wheel_->newTimer(std::move(cb), when, interval, slack)
+                        : new Timer(std::move(cb), when, interval, slack);
+  // 先取 sequence，runInLoop() 之后 timer 可能已经到期并被释放
+  TimerId timerId(timer, timer->sequence());
   loop_->runInLoop(
       std::bind(&TimerQueue::addTimerInLoop, this, timer));
-  return TimerId(timer, timer->sequence());
+  return timerId;
+}
+
+void TimerQueue::setTimingWheel(double tickSeconds)
+{
+  loop_->assertInLoopThread();
+  assert(timers_.empty() && !wheel_);
+  wheel_.reset(new TimingWheel(tickSeconds, Timestamp::now()));
 }
 
 void TimerQueue::cancel(TimerId timerId)
@@ -132,17 +148,70 @@ void TimerQueue::cancel(TimerId timerId)
 void TimerQueue::addTimerInLoop(Timer* timer)
 {
   loop_->assertInLoopThread();
-  bool earliestChanged = insert(timer);
-  // earliestChanged 表示是否改动了最早的Timer，即是否需要重置timerfd的超时时间
-  if (earliestChanged)
+  if (wheel_)
+  {
+    wheel_->insert(timer);
+  }
+  else
+  {
+    insert(timer);
+  }
+  // 正在执行到期的 Timer，随后会统一重新设置 timerfd
+  if (callingExpiredTimers_)
   {
-    resetTimerfd(timerfd_, timer->expiration());
+    return;
+  }
+
+  // 只有新 Timer 的窗口 [expiration, latest] 整个早于已经设置的超时时刻，
+  // 才需要重新设置 timerfd，而且设为 latest，让之后的 Timer 更容易合并进来
+  if (wheel_)
+  {
+    int64_t latestTick = wheel_->tickOf(timer->latest());
+    if (latestTick < wheelArmedTick_)
+    {
+      wheelArmedTick_ = latestTick;
+      armTimerfd(wheel_->timeOfTick(latestTick));
+    }
+    else if (wheel_->tickOf(timer->expiration()) < wheelArmedTick_)
+    {
+      ++stats_.timerfdResetsSaved;
+    }
+  }
+  else
+  {
+    if (!armedDeadline_.valid() || timer->latest() < armedDeadline_)
+    {
+      armedDeadline_ = timer->latest();
+      armTimerfd(armedDeadline_);
+    }
+    else if (timer->expiration() < armedDeadline_)
+    {
+      ++stats_.timerfdResetsSaved;
+    }
   }
 }
 
 void TimerQueue::cancelInLoop(TimerId timerId)
 {
   loop_->assertInLoopThread();
+  if (wheel_)
+  {
+    // 池中的 Timer 不会归还给系统，可以直接 dereference 来比较 sequence
+    Timer* timer = timerId.timer_;
+    if (timer && timer->sequence() == timerId.sequence_)
+    {
+      if (wheel_->contains(timer))
+      {
+        wheel_->remove(timer);
+        wheel_->deleteTimer(timer);
+      }
+      else if (callingExpiredTimers_)
+      {
+        cancelingTimers_.insert(ActiveTimer(timer, timerId.sequence_));
+      }
+    }
+    return;
+  }
   assert(timers_.size() == activeTimers_.size());
   // 由于TimerId不负责Timer的生命期，其中保存的Timer*可能失效，
   // 因此不能直接dereference，只有在activeTimers_中找到了Timer时才能提领。
@@ -167,14 +236,23 @@ void TimerQueue::handleRead()
   loop_->assertInLoopThread();
   Timestamp now(Timestamp::now());
   readTimerfd(timerfd_, now);
+  ++stats_.timerfdWakeups;
+  if (wheel_)
+  {
+    handleWheelExpired(now);
+    return;
+  }
 
   std::vector<Entry> expired = getExpired(now);
+  stats_.timersFired += static_cast<int64_t>(expired.size());
 
   callingExpiredTimers_ = true;
   cancelingTimers_.clear();
   // safe to callback outside critical section
   for (const Entry& it : expired)
   {
+    loop_->addTimerLateness(now.microSecondsSinceEpoch()
+                            - it.second->expiration().microSecondsSinceEpoch());
     it.second->run();
   }
   callingExpiredTimers_ = false;
@@ -205,8 +283,6 @@ std::vector<TimerQueue::Entry> TimerQueue::getExpired(Timestamp now)
 
 void TimerQueue::reset(const std::vector<Entry>& expired, Timestamp now)
 {
-  Timestamp nextExpire;
-
   for (const Entry& it : expired)
   {
     ActiveTimer timer(it.second, it.second->sequence());
@@ -223,15 +299,76 @@ void TimerQueue::reset(const std::vector<Entry>& expired, Timestamp now)
     }
   }
 
-  if (!timers_.empty())
+  armedDeadline_ = nextDeadline();
+  if (armedDeadline_.valid())
   {
-    nextExpire = timers_.begin()->second->expiration();
+    armTimerfd(armedDeadline_);
   }
+}
 
-  if (nextExpire.valid())
+void TimerQueue::handleWheelExpired(Timestamp now)
+{
+  std::vector<Timer*> expired;
+  wheel_->advance(now, &expired);
+  stats_.timersFired += static_cast<int64_t>(expired.size());
+
+  callingExpiredTimers_ = true;
+  cancelingTimers_.clear();
+  for (Timer* timer : expired)
+  {
+    loop_->addTimerLateness(now.microSecondsSinceEpoch()
+                            - timer->expiration().microSecondsSinceEpoch());
+    timer->run();
+  }
+  callingExpiredTimers_ = false;
+
+  for (Timer* timer : expired)
+  {
+    ActiveTimer activeTimer(timer, timer->sequence());
+    if (timer->repeat()
+        && cancelingTimers_.find(activeTimer) == cancelingTimers_.end())
+    {
+      timer->restart(now);
+      wheel_->insert(timer);
+    }
+    else
+    {
+      wheel_->deleteTimer(timer);
+    }
+  }
+
+  // 回调里新加的 Timer 也算在内，重新设置一次就够了
+  wheelArmedTick_ = wheel_->nextDeadline();
+  if (wheelArmedTick_ != TimingWheel::kNoTick)
+  {
+    armTimerfd(wheel_->timeOfTick(wheelArmedTick_));
+  }
+}
+
+// 所有 Timer 的 latest() 中最早的那个。只需要看 expiration() 比当前结果早的，
+// 也就是到那时会一起到期的这一批。
+Timestamp TimerQueue::nextDeadline() const
+{
+  Timestamp deadline;
+  for (const Entry& entry : timers_)
   {
-    resetTimerfd(timerfd_, nextExpire);
+    if (deadline.valid() && !(entry.first < deadline))
+    {
+      break;
+    }
+    Timestamp latest = entry.second->latest();
+    if (!deadline.valid() || latest < deadline)
+    {
+      deadline = latest;
+    }
   }
+  return deadline;
+}
+
+void TimerQueue::armTimerfd(Timestamp when)
+{
+  ++stats_.timerfdResets;
+  resetTimerfd(timerfd_, when);
 }
 
 bool TimerQueue::insert(Timer* timer)
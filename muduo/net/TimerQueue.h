@@ -11,6 +11,7 @@
 #ifndef MUDUO_NET_TIMERQUEUE_H
 #define MUDUO_NET_TIMERQUEUE_H
 
+#include <memory>
 #include <set>
 #include <vector>
 
@@ -18,6 +19,7 @@
 #include <muduo/base/Timestamp.h>
 #include <muduo/net/Callbacks.h>
 #include <muduo/net/Channel.h>
+#include <muduo/net/EventLoop.h>
 
 namespace muduo
 {
@@ -27,6 +29,7 @@ namespace net
 class EventLoop;
 class Timer;
 class TimerId;
+class TimingWheel;
 
 ///
 /// A best efforts timer queue.
@@ -41,14 +44,23 @@ class TimerQueue : noncopyable
   ///
   /// Schedules the callback to be run at given time,
   /// repeats if @c interval > 0.0.
+  /// 允许晚 @c slack 秒执行，窗口重叠的 Timer 合并到一次 timerfd 超时里。
   ///
   /// Must be thread safe. Usually be called from other threads.
   TimerId addTimer(TimerCallback cb,
                    Timestamp when,
-                   double interval);
+                   double interval,
+                   double slack = 0.0);
 
   void cancel(TimerId timerId);
 
+  /// Keeps timers in a TimingWheel instead of the std::set below,
+  /// O(1) add and cancel, timers fire at most one tick late.
+  /// Must be called in loop thread before adding any timer.
+  void setTimingWheel(double tickSeconds);
+
+  const EventLoop::TimerStats& stats() const { return stats_; }
+
  private:
 
   // FIXME: use unique_ptr<Timer> instead of raw pointers.
@@ -69,8 +81,11 @@ class TimerQueue : noncopyable
   // 核心函数，返回所有到期的Timer
   std::vector<Entry> getExpired(Timestamp now);
   void reset(const std::vector<Entry>& expired, Timestamp now);
+  void handleWheelExpired(Timestamp now);
 
   bool insert(Timer* timer);
+  Timestamp nextDeadline() const;
+  void armTimerfd(Timestamp when);
 
   EventLoop* loop_;
   const int timerfd_;
@@ -85,6 +100,14 @@ class TimerQueue : noncopyable
   ActiveTimerSet activeTimers_;
   bool callingExpiredTimers_; /* atomic */
   ActiveTimerSet cancelingTimers_;
+  // timerfd 设置的超时时刻，是所有 Timer 的 latest() 中最早的；
+  // 新 Timer 的窗口包含它时不必重新设置 timerfd
+  Timestamp armedDeadline_;
+  EventLoop::TimerStats stats_;
+
+  // 非空时所有 Timer 都在 wheel_ 中，上面的 timers_ 和 activeTimers_ 不用
+  std::unique_ptr<TimingWheel> wheel_;
+  int64_t wheelArmedTick_;  // timerfd 设置的 tick
 };
 
 }  // namespace net
@@ -0,0 +1,256 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include <muduo/net/TimingWheel.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/Timer.h>
+
+#include <algorithm>
+
+#include <assert.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int64_t TimingWheel::kNoTick;
+
+TimingWheel::TimingWheel(double tickSeconds, Timestamp now)
+  : tickMicroSeconds_(std::max(static_cast<int64_t>(
+        tickSeconds * Timestamp::kMicroSecondsPerSecond), int64_t(1))),
+    currentTick_(now.microSecondsSinceEpoch() / tickMicroSeconds_),
+    size_(0),
+    freeList_(nullptr)
+{
+  std::fill(slots_, slots_ + kLevels * kSlots, nullptr);
+  std::fill(slotDeadlines_, slotDeadlines_ + kLevels * kSlots, kNoTick);
+  std::fill(occupied_, occupied_ + kLevels, 0);
+  LOG_DEBUG << "TimingWheel tick = " << tickMicroSeconds_ << " us";
+}
+
+TimingWheel::~TimingWheel() = default;
+
+Timer* TimingWheel::newTimer(TimerCallback cb, Timestamp when, double interval,
+                             double slack)
+{
+  Timer* timer = nullptr;
+  {
+    MutexLockGuard lock(mutex_);
+    if (freeList_ == nullptr)
+    {
+      Timer* chunk = new Timer[kTimersPerChunk];
+      chunks_.emplace_back(chunk);
+      for (int i = 0; i < kTimersPerChunk; ++i)
+      {
+        chunk[i].wheelNext_ = freeList_;
+        freeList_ = &chunk[i];
+      }
+    }
+    timer = freeList_;
+    freeList_ = timer->wheelNext_;
+  }
+  timer->wheelNext_ = nullptr;
+  timer->callback_ = std::move(cb);
+  timer->expiration_ = when;
+  timer->interval_ = interval;
+  timer->repeat_ = interval > 0.0;
+  timer->slack_ = static_cast<int64_t>(slack * Timestamp::kMicroSecondsPerSecond);
+  timer->sequence_.store(Timer::s_numCreated_.fetch_add(1) + 1,
+                         std::memory_order_relaxed);
+  return timer;
+}
+
+void TimingWheel::deleteTimer(Timer* timer)
+{
+  assert(!contains(timer));
+  // 回调可能持有 shared_ptr 等资源，不能等到重用时才释放
+  timer->callback_ = nullptr;
+  // 之后旧的 TimerId 都对不上 sequence 了
+  timer->sequence_.store(0, std::memory_order_relaxed);
+  MutexLockGuard lock(mutex_);
+  timer->wheelNext_ = freeList_;
+  freeList_ = timer;
+}
+
+void TimingWheel::insert(Timer* timer)
+{
+  assert(!contains(timer));
+  // 向上取整，保证不会提前到期
+  int64_t tick = tickOf(timer->expiration());
+  if (tick <= currentTick_)
+  {
+    tick = currentTick_ + 1;
+  }
+  timer->wheelTick_ = tick;
+  link(timer, slotOf(tick));
+  ++size_;
+}
+
+void TimingWheel::remove(Timer* timer)
+{
+  assert(contains(timer));
+  unlink(timer);
+  --size_;
+}
+
+bool TimingWheel::contains(const Timer* timer) const
+{
+  return timer->wheelSlot_ >= 0;
+}
+
+void TimingWheel::advance(Timestamp now, std::vector<Timer*>* expired)
+{
+  int64_t nowTick = now.microSecondsSinceEpoch() / tickMicroSeconds_;
+  while (currentTick_ < nowTick)
+  {
+    // 中间没有事情可做的 tick 直接跳过
+    int64_t next = nextTick();
+    if (next > nowTick)
+    {
+      currentTick_ = nowTick;
+      break;
+    }
+    currentTick_ = next;
+    for (int level = 1; level < kLevels; ++level)
+    {
+      if ((currentTick_ & ((int64_t(1) << shiftOf(level)) - 1)) != 0)
+      {
+        break;
+      }
+      cascade(level);
+    }
+
+    int slot = static_cast<int>(currentTick_ & (kSlots - 1));
+    while (Timer* timer = slots_[slot])
+    {
+      assert(timer->wheelTick_ == currentTick_);
+      unlink(timer);
+      --size_;
+      expired->push_back(timer);
+    }
+  }
+}
+
+int64_t TimingWheel::nextTick() const
+{
+  int64_t next = kNoTick;
+  for (int level = 0; level < kLevels; ++level)
+  {
+    if (occupied_[level] != 0)
+    {
+      next = std::min(next, nextTickOfLevel(level));
+    }
+  }
+  return next;
+}
+
+int64_t TimingWheel::nextDeadline() const
+{
+  int64_t deadline = kNoTick;
+  for (int level = 0; level < kLevels; ++level)
+  {
+    int64_t block = currentTick_ >> shiftOf(level);
+    int start = static_cast<int>((block + 1) & (kSlots - 1));
+    uint64_t bits = occupied_[level];
+    uint64_t rotated = start == 0 ? bits : (bits >> start) | (bits << (kSlots - start));
+    // 按轮子转到的先后顺序看各个非空槽，转到的时刻已经晚于 deadline 就不用再看了
+    while (rotated != 0)
+    {
+      int distance = __builtin_ctzll(rotated) + 1;
+      if (((block + distance) << shiftOf(level)) >= deadline)
+      {
+        break;
+      }
+      int slot = level * kSlots + static_cast<int>((block + distance) & (kSlots - 1));
+      deadline = std::min(deadline, slotDeadlines_[slot]);
+      rotated &= rotated - 1;
+    }
+  }
+  return deadline;
+}
+
+int TimingWheel::slotOf(int64_t tick) const
+{
+  int64_t delta = tick - currentTick_;
+  assert(delta >= 0);
+  int level = 0;
+  while (level < kLevels - 1 && delta >= (int64_t(1) << shiftOf(level + 1)))
+  {
+    ++level;
+  }
+  const int64_t range = int64_t(1) << shiftOf(kLevels);
+  if (delta >= range)
+  {
+    // 超出了整个轮子的范围，先放在最远的槽，转到那里时再重新放置
+    tick = currentTick_ + range - 1;
+  }
+  return level * kSlots + static_cast<int>((tick >> shiftOf(level)) & (kSlots - 1));
+}
+
+int64_t TimingWheel::nextTickOfLevel(int level) const
+{
+  assert(occupied_[level] != 0);
+  int64_t block = currentTick_ >> shiftOf(level);
+  // 从当前位置的下一个槽开始找第一个非空的
+  int start = static_cast<int>((block + 1) & (kSlots - 1));
+  uint64_t bits = occupied_[level];
+  uint64_t rotated = start == 0 ? bits : (bits >> start) | (bits << (kSlots - start));
+  int distance = __builtin_ctzll(rotated) + 1;
+  return (block + distance) << shiftOf(level);
+}
+
+void TimingWheel::link(Timer* timer, int slot)
+{
+  int64_t latest = std::max(tickOf(timer->latest()), timer->wheelTick_);
+  slotDeadlines_[slot] = slots_[slot] ? std::min(slotDeadlines_[slot], latest) : latest;
+  timer->wheelSlot_ = slot;
+  timer->wheelPrev_ = nullptr;
+  timer->wheelNext_ = slots_[slot];
+  if (slots_[slot])
+  {
+    slots_[slot]->wheelPrev_ = timer;
+  }
+  slots_[slot] = timer;
+  occupied_[slot / kSlots] |= uint64_t(1) << (slot % kSlots);
+}
+
+void TimingWheel::unlink(Timer* timer)
+{
+  int slot = timer->wheelSlot_;
+  if (timer->wheelPrev_)
+  {
+    timer->wheelPrev_->wheelNext_ = timer->wheelNext_;
+  }
+  else
+  {
+    slots_[slot] = timer->wheelNext_;
+    if (slots_[slot] == nullptr)
+    {
+      occupied_[slot / kSlots] &= ~(uint64_t(1) << (slot % kSlots));
+    }
+  }
+  if (timer->wheelNext_)
+  {
+    timer->wheelNext_->wheelPrev_ = timer->wheelPrev_;
+  }
+  timer->wheelPrev_ = nullptr;
+  timer->wheelNext_ = nullptr;
+  timer->wheelSlot_ = -1;
+}
+
+void TimingWheel::cascade(int level)
+{
+  int slot = level * kSlots
+      + static_cast<int>((currentTick_ >> shiftOf(level)) & (kSlots - 1));
+  Timer* timer = slots_[slot];
+  slots_[slot] = nullptr;
+  occupied_[level] &= ~(uint64_t(1) << (slot % kSlots));
+  while (timer)
+  {
+    Timer* next = timer->wheelNext_;
+    link(timer, slotOf(timer->wheelTick_));
+    timer = next;
+  }
+}
@@ -0,0 +1,105 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_TIMINGWHEEL_H
+#define MUDUO_NET_TIMINGWHEEL_H
+
+#include <muduo/base/Mutex.h>
+#include <muduo/base/Timestamp.h>
+#include <muduo/net/Callbacks.h>
+
+#include <memory>
+#include <vector>
+
+#include <stdint.h>
+
+namespace muduo
+{
+namespace net
+{
+
+class Timer;
+
+///
+/// Hierarchical timing wheel, used by TimerQueue for huge number of timers.
+///
+/// 共 kLevels 层，每层 64 个槽，第 k 层的一个槽覆盖 64^k 个 tick，
+/// 1ms 的 tick 可以表示两年以内的到期时间，更远的放在最高层，到时再重新放置。
+/// 添加、删除都是 O(1) 的链表操作；低层转完一圈时把上一层的一个槽
+/// 重新分配到下面各层（cascade），因此到期时间精确到 tick，不会提前，最多晚一个 tick。
+///
+/// 每层用一个 64 位的位图记录哪些槽非空，nextTick() 据此找到下一个有事可做的 tick，
+/// TimerQueue 只在那时设置 timerfd，空闲的 tick 不会唤醒 loop。
+///
+/// Timer 对象来自内部的对象池，按块分配，释放后留在池中重用，
+/// 内存直到 TimingWheel 析构时才归还，所以过期的 TimerId 也可以安全地比较 sequence。
+///
+class TimingWheel : noncopyable
+{
+ public:
+  static const int64_t kNoTick = INT64_MAX;
+
+  TimingWheel(double tickSeconds, Timestamp now);
+  ~TimingWheel();
+
+  /// Thread safe.
+  Timer* newTimer(TimerCallback cb, Timestamp when, double interval, double slack);
+  /// Thread safe.
+  void deleteTimer(Timer* timer);
+
+  // 以下只能在 loop 线程调用
+
+  void insert(Timer* timer);
+  void remove(Timer* timer);
+  bool contains(const Timer* timer) const;
+
+  /// Moves out all timers expired by @c now.
+  void advance(Timestamp now, std::vector<Timer*>* expired);
+  /// kNoTick if empty
+  int64_t nextTick() const;
+  /// The earliest Timer::latest() in ticks, advance() by then fires every
+  /// timer within its slack.  kNoTick if empty
+  int64_t nextDeadline() const;
+  Timestamp timeOfTick(int64_t tick) const
+  { return Timestamp(tick * tickMicroSeconds_); }
+  /// first tick not earlier than @c time
+  int64_t tickOf(Timestamp time) const
+  { return (time.microSecondsSinceEpoch() + tickMicroSeconds_ - 1) / tickMicroSeconds_; }
+
+  size_t size() const { return size_; }
+
+ private:
+  static const int kLevels = 6;
+  static const int kSlotBits = 6;
+  static const int kSlots = 1 << kSlotBits;
+  static const int kTimersPerChunk = 1024;
+
+  static int shiftOf(int level) { return level * kSlotBits; }
+
+  void link(Timer* timer, int slot);
+  void unlink(Timer* timer);
+  void cascade(int level);
+  int slotOf(int64_t tick) const;
+  int64_t nextTickOfLevel(int level) const;
+
+  const int64_t tickMicroSeconds_;
+  int64_t currentTick_;  // 这个 tick 及以前到期的 Timer 都已经取走了
+  size_t size_;
+  Timer* slots_[kLevels * kSlots];
+  // 槽中 Timer 的 latest() 的最小值（tick），删除时不更新，只会偏早
+  int64_t slotDeadlines_[kLevels * kSlots];
+  uint64_t occupied_[kLevels];  // 非空槽的位图
+
+  MutexLock mutex_;
+  std::vector<std::unique_ptr<Timer[]>> chunks_ GUARDED_BY(mutex_);
+  Timer* freeList_ GUARDED_BY(mutex_);
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_TIMINGWHEEL_H
@@ -49,6 +49,11 @@ class HttpServer : noncopyable
     server_.setThreadNum(numThreads);
   }
 
+  void setMaxAcceptsPerRead(int n)
+  {
+    server_.setMaxAcceptsPerRead(n);
+  }
+
   void start();
 
  private:
@@ -14,6 +14,8 @@
 #include <muduo/net/EventLoop.h>
 #include <muduo/net/http/HttpRequest.h>
 #include <muduo/net/http/HttpResponse.h>
+#include <muduo/net/EventLoopThreadPool.h>
+#include <muduo/net/inspect/LoopInspector.h>
 #include <muduo/net/inspect/ProcessInspector.h>
 #include <muduo/net/inspect/PerformanceInspector.h>
 #include <muduo/net/inspect/SystemInspector.h>
@@ -100,6 +102,13 @@ void Inspector::remove(const string& module, const string& command)
   }
 }
 
+void Inspector::addEventLoopThreadPool(const std::shared_ptr<EventLoopThreadPool>& pool)
+{
+  add("loops", pool->name(),
+      std::bind(&LoopInspector::loops, pool, _1, _2),
+      "load, poll, callback, functor and timer stats of " + pool->name());
+}
+
 void Inspector::start()
 {
   server_.start();
@@ -22,6 +22,7 @@ namespace muduo
 namespace net
 {
 
+class EventLoopThreadPool;
 class ProcessInspector;
 class PerformanceInspector;
 class SystemInspector;
@@ -45,6 +46,11 @@ class Inspector : noncopyable
            const string& help);
   void remove(const string& module, const string& command);
 
+  /// Adds /loops/<pool name> showing the load (connections, busy time) used
+  /// by the placement policy, EventLoop::loopStats() and the busiest
+  /// channels of every loop in @c pool, e.g. TcpServer::threadPool().
+  void addEventLoopThreadPool(const std::shared_ptr<EventLoopThreadPool>& pool);
+
  private:
   typedef std::map<string, Callback> CommandList;
   typedef std::map<string, string> HelpList;
@@ -0,0 +1,198 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include <muduo/net/inspect/LoopInspector.h>
+
+#include <muduo/base/Condition.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/EventLoopThreadPool.h>
+
+#include <functional>
+
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace muduo
+{
+namespace inspect
+{
+int stringPrintf(string* out, const char* fmt, ...) __attribute__ ((format (printf, 2, 3)));
+}
+}
+
+using namespace muduo::inspect;
+
+namespace
+{
+
+const size_t kTopChannels = 10;
+
+const char* placementName(EventLoopThreadPool::Placement placement)
+{
+  switch (placement)
+  {
+    case EventLoopThreadPool::kRoundRobin:
+      return "round-robin";
+    case EventLoopThreadPool::kLeastConnections:
+      return "least-connections";
+    case EventLoopThreadPool::kLeastBusy:
+      return "least-busy";
+    case EventLoopThreadPool::kPowerOfTwoChoices:
+      return "power-of-two-choices";
+  }
+  return "unknown";
+}
+
+const double kWaitSeconds = 1.0;
+
+struct Snapshot
+{
+  int64_t iteration = 0;
+  size_t queueSize = 0;
+  std::vector<EventLoop::ChannelStats> channels;
+};
+
+template<typename T>
+struct Result
+{
+  Result() : done(false) {}
+
+  MutexLock mutex;
+  Condition cond;
+  bool done GUARDED_BY(mutex);
+  T value GUARDED_BY(mutex);
+};
+
+// 在 loop 所在线程里执行 func，最多等 kWaitSeconds 秒，超时返回 false。
+// func 要按值捕获，超时之后它仍然可能被执行。
+template<typename T>
+bool callInLoop(EventLoop* loop, const std::function<T()>& func, T* value)
+{
+  std::shared_ptr<Result<T>> result(new Result<T>);
+  loop->runInLoop([result, func] {
+    T v = func();
+    MutexLockGuard lock(result->mutex);
+    result->value = std::move(v);
+    result->done = true;
+    result->cond.notify();
+  });
+  MutexLockGuard lock(result->mutex);
+  if (!result->cond.waitForSeconds(lock, kWaitSeconds, [&result] { return result->done; }))
+  {
+    return false;
+  }
+  *value = std::move(result->value);
+  return true;
+}
+
+void appendHistogram(string* out, const char* name, const Histogram& histogram)
+{
+  stringPrintf(out, "  %-22s %s\n", name, histogram.toString().c_str());
+}
+
+}  // namespace
+
+// /loops/<pool>[/<top channels>]
+string LoopInspector::loops(const std::shared_ptr<EventLoopThreadPool>& pool,
+                            HttpRequest::Method, const Inspector::ArgList& args)
+{
+  size_t topChannels = kTopChannels;
+  if (!args.empty())
+  {
+    topChannels = static_cast<size_t>(atoi(args[0].c_str()));
+  }
+  if (!pool->started())
+  {
+    return pool->name() + " is not started\n";
+  }
+  // loads() 只能在 baseLoop 线程调用
+  std::vector<EventLoopThreadPool::LoopLoad> loads;
+  std::function<std::vector<EventLoopThreadPool::LoopLoad>()> getLoads =
+      [pool] { return pool->loads(); };
+  if (!callInLoop(pool->baseLoop(), getLoads, &loads))
+  {
+    return pool->name() + " base loop is busy\n";
+  }
+
+  string result;
+  stringPrintf(&result, "placement %s\n", placementName(pool->placement()));
+  stringPrintf(&result, "  %-18s %8s %12s %8s\n", "loop", "tid", "connections", "busy%");
+  std::vector<EventLoop*> loops;
+  for (const EventLoopThreadPool::LoopLoad& load : loads)
+  {
+    stringPrintf(&result, "  %-18p %8d %12d %8.1f\n", load.loop,
+                 load.loop->threadId(), load.connections, load.busy * 100);
+    loops.push_back(load.loop);
+  }
+  result += "\n";
+  if (loops.front() != pool->baseLoop())
+  {
+    loops.insert(loops.begin(), pool->baseLoop());
+  }
+  for (EventLoop* ioLoop : loops)
+  {
+    result += loop(ioLoop, topChannels);
+    result += "\n";
+  }
+  return result;
+}
+
+string LoopInspector::loop(EventLoop* loop, size_t topChannels)
+{
+  string result;
+  const EventLoop::LoopStats& stats = loop->loopStats();
+  stringPrintf(&result, "EventLoop %p tid %d cpu %d\n",
+               loop, loop->threadId(), loop->cpu());
+
+  int64_t start = stats.callbackStart.load(std::memory_order_relaxed);
+  int fd = stats.callbackFd.load(std::memory_order_relaxed);
+  if (start != 0 && fd >= 0)
+  {
+    stringPrintf(&result, "  in callback of fd %d for %lld us\n", fd,
+                 static_cast<long long>(Timestamp::now().microSecondsSinceEpoch() - start));
+  }
+  appendHistogram(&result, "poll wait us", stats.pollWait);
+  appendHistogram(&result, "events per wakeup", stats.eventsPerWakeup);
+  appendHistogram(&result, "callback us", stats.callback);
+  appendHistogram(&result, "functors per batch", stats.functorsPerBatch);
+  appendHistogram(&result, "functor batch us", stats.functorBatch);
+  appendHistogram(&result, "timer lateness us", stats.timerLateness);
+  stringPrintf(&result, "  slow callbacks %lld\n",
+               static_cast<long long>(stats.slowCallbacks.load(std::memory_order_relaxed)));
+
+  Snapshot snapshot;
+  std::function<Snapshot()> takeSnapshot = [loop, topChannels] {
+    Snapshot s;
+    s.iteration = loop->iteration();
+    s.queueSize = loop->queueSize();
+    s.channels = loop->channelStats(topChannels);
+    return s;
+  };
+  if (!callInLoop(loop, takeSnapshot, &snapshot))
+  {
+    result += "  loop is busy, no channel stats\n";
+    return result;
+  }
+  stringPrintf(&result, "  iteration %lld, %zd pending functors\n",
+               static_cast<long long>(snapshot.iteration), snapshot.queueSize);
+  if (!snapshot.channels.empty())
+  {
+    stringPrintf(&result, "  %6s %12s %14s %10s  %s\n",
+                 "fd", "calls", "total us", "max us", "name");
+  }
+  for (const EventLoop::ChannelStats& channel : snapshot.channels)
+  {
+    stringPrintf(&result, "  %6d %12lld %14lld %10lld  %s\n",
+                 channel.fd,
+                 static_cast<long long>(channel.calls),
+                 static_cast<long long>(channel.microSeconds),
+                 static_cast<long long>(channel.maxMicroSeconds),
+                 channel.name.c_str());
+  }
+  return result;
+}
@@ -0,0 +1,33 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_INSPECT_LOOPINSPECTOR_H
+#define MUDUO_NET_INSPECT_LOOPINSPECTOR_H
+
+#include <muduo/net/inspect/Inspector.h>
+
+namespace muduo
+{
+namespace net
+{
+
+class EventLoopThreadPool;
+
+// EventLoop::loopStats() 和 channelStats() 的页面，见 Inspector::addEventLoopThreadPool()
+class LoopInspector : noncopyable
+{
+ public:
+  static string loops(const std::shared_ptr<EventLoopThreadPool>& pool,
+                      HttpRequest::Method, const Inspector::ArgList&);
+  /// channelStats() 要到 loop 线程里取，loop 卡住时最多等一秒
+  static string loop(EventLoop* loop, size_t topChannels);
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_INSPECT_LOOPINSPECTOR_H
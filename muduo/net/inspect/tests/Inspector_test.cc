@@ -1,6 +1,7 @@
 #include <muduo/net/inspect/Inspector.h>
 #include <muduo/net/EventLoop.h>
 #include <muduo/net/EventLoopThread.h>
+#include <muduo/net/EventLoopThreadPool.h>
 
 using namespace muduo;
 using namespace muduo::net;
@@ -10,6 +11,15 @@ int main()
   EventLoop loop;
   EventLoopThread t;
   Inspector ins(t.getLoop(), InetAddress(12345), "test");
+
+  // 在 http://127.0.0.1:12345/loops/workers 可以看到
+  std::shared_ptr<EventLoopThreadPool> pool(new EventLoopThreadPool(&loop, "workers"));
+  pool->setThreadNum(2);
+  pool->setPlacement(EventLoopThreadPool::kLeastBusy);
+  pool->start();
+  ins.addEventLoopThreadPool(pool);
+  loop.runEvery(0.01, [&pool] {
+    pool->getNextLoop()->queueInLoop([] {});
+  });
   loop.loop();
 }
-
@@ -7,10 +7,13 @@
 // Author: Shuo Chen (chenshuo at chenshuo dot com)
 
 #include <muduo/net/Poller.h>
+#include <muduo/base/Logging.h>
 #include <muduo/net/poller/PollPoller.h>
 #include <muduo/net/poller/EPollPoller.h>
+#include <muduo/net/poller/IoUringPoller.h>
 
 #include <stdlib.h>
+#include <string.h>
 
 using namespace muduo::net;
 
@@ -20,6 +23,18 @@ Poller* Poller::newDefaultPoller(EventLoop* loop)
   {
     return new PollPoller(loop);
   }
+  else if (const char* uring = ::getenv("MUDUO_USE_IO_URING"))
+  {
+    // MUDUO_USE_IO_URING=completion 同时让 TcpConnection 用 io_uring 收发数据
+    IoUringPoller* poller = new IoUringPoller(loop, ::strcmp(uring, "completion") == 0);
+    if (poller->ok())
+    {
+      return poller;
+    }
+    LOG_WARN << "io_uring unavailable, falling back to epoll";
+    delete poller;
+    return new EPollPoller(loop);
+  }
   else
   {
     return new EPollPoller(loop);
@@ -11,6 +11,8 @@
 #include <muduo/base/Logging.h>
 #include <muduo/net/Channel.h>
 
+#include <algorithm>
+
 #include <assert.h>
 #include <errno.h>
 #include <poll.h>
@@ -33,7 +35,6 @@ namespace
 {
 const int kNew = -1;
 const int kAdded = 1;
-const int kDeleted = 2;
 }
 
 EPollPoller::EPollPoller(EventLoop* loop)
@@ -54,7 +55,8 @@ EPollPoller::~EPollPoller()
 
 Timestamp EPollPoller::poll(int timeoutMs, ChannelList* activeChannels)
 {
-  LOG_TRACE << "fd total count " << channels_.size();
+  LOG_TRACE << "fd total count " << numChannels();
+  syncInterests();
   int numEvents = ::epoll_wait(epollfd_,
                                &*events_.begin(),
                                static_cast<int>(events_.size()),
@@ -93,12 +95,7 @@ void EPollPoller::fillActiveChannels(int numEvents,
   for (int i = 0; i < numEvents; ++i)
   {
     Channel* channel = static_cast<Channel*>(events_[i].data.ptr);
-#ifndef NDEBUG
-    int fd = channel->fd();
-    ChannelMap::const_iterator it = channels_.find(fd);
-    assert(it != channels_.end());
-    assert(it->second == channel);
-#endif
+    assert(channelOf(channel->fd()) == channel);
     channel->set_revents(events_[i].events);
     activeChannels->push_back(channel);
   }
@@ -108,43 +105,29 @@ void EPollPoller::updateChannel(Channel* channel)
 {
   Poller::assertInLoopThread();
   const int index = channel->index();
-  LOG_TRACE << "fd = " << channel->fd()
+  int fd = channel->fd();
+  LOG_TRACE << "fd = " << fd
     << " events = " << channel->events() << " index = " << index;
-  if (index == kNew || index == kDeleted)
+  if (index == kNew)
   {
-    // a new one, add with EPOLL_CTL_ADD
-    int fd = channel->fd();
-    if (index == kNew)
-    {
-      assert(channels_.find(fd) == channels_.end());
-      channels_[fd] = channel;
-    }
-    else // index == kDeleted
-    {
-      assert(channels_.find(fd) != channels_.end());
-      assert(channels_[fd] == channel);
-    }
-
+    addChannel(channel);
     channel->set_index(kAdded);
-    update(EPOLL_CTL_ADD, channel);
   }
   else
   {
-    // update existing one with EPOLL_CTL_MOD/DEL
-    int fd = channel->fd();
-    (void)fd;
-    assert(channels_.find(fd) != channels_.end());
-    assert(channels_[fd] == channel);
+    assert(channelOf(fd) == channel);
     assert(index == kAdded);
-    if (channel->isNoneEvent())
-    {
-      update(EPOLL_CTL_DEL, channel);
-      channel->set_index(kDeleted);
-    }
-    else
-    {
-      update(EPOLL_CTL_MOD, channel);
-    }
+  }
+
+  if (implicit_cast<size_t>(fd) >= interests_.size())
+  {
+    interests_.resize(std::max(implicit_cast<size_t>(fd) + 1, interests_.size() * 2));
+  }
+  Interest& interest = interests_[fd];
+  if (!interest.dirty)
+  {
+    interest.dirty = true;
+    dirtyFds_.push_back(fd);
   }
 }
 
@@ -153,31 +136,73 @@ void EPollPoller::removeChannel(Channel* channel)
   Poller::assertInLoopThread();
   int fd = channel->fd();
   LOG_TRACE << "fd = " << fd;
-  assert(channels_.find(fd) != channels_.end());
-  assert(channels_[fd] == channel);
   assert(channel->isNoneEvent());
-  int index = channel->index();
-  assert(index == kAdded || index == kDeleted);
-  size_t n = channels_.erase(fd);
-  (void)n;
-  assert(n == 1);
-
-  if (index == kAdded)
+  assert(channel->index() == kAdded);
+  eraseChannel(channel);
+
+  assert(implicit_cast<size_t>(fd) < interests_.size());
+  Interest& interest = interests_[fd];
+  // 留在 dirtyFds_ 中的项在 syncInterests() 时跳过
+  interest.dirty = false;
+  if (interest.registered != 0)
   {
-    update(EPOLL_CTL_DEL, channel);
+    update(EPOLL_CTL_DEL, channel, 0);
+    interest.registered = 0;
   }
   channel->set_index(kNew);
 }
 
-void EPollPoller::update(int operation, Channel* channel)
+void EPollPoller::syncInterests()
+{
+  for (int fd : dirtyFds_)
+  {
+    Interest& interest = interests_[fd];
+    if (!interest.dirty)
+    {
+      continue;
+    }
+    interest.dirty = false;
+    Channel* channel = channels_[fd];
+    uint32_t events = 0;
+    if (!channel->isNoneEvent())
+    {
+      events = channel->events();
+      if (channel->edgeTriggered())
+      {
+        events |= EPOLLET;
+      }
+    }
+    if (events == interest.registered)
+    {
+      continue;
+    }
+    if (interest.registered == 0)
+    {
+      update(EPOLL_CTL_ADD, channel, events);
+    }
+    else if (events == 0)
+    {
+      update(EPOLL_CTL_DEL, channel, events);
+    }
+    else
+    {
+      update(EPOLL_CTL_MOD, channel, events);
+    }
+    interest.registered = events;
+  }
+  dirtyFds_.clear();
+}
+
+void EPollPoller::update(int operation, Channel* channel, uint32_t events)
 {
   struct epoll_event event;
   memZero(&event, sizeof event);
-  event.events = channel->events();
+  event.events = events;
   event.data.ptr = channel;
   int fd = channel->fd();
   LOG_TRACE << "epoll_ctl op = " << operationToString(operation)
     << " fd = " << fd << " event = { " << channel->eventsToString() << " }";
+  ++interestSyscalls_;
   if (::epoll_ctl(epollfd_, operation, fd, &event) < 0)
   {
     if (operation == EPOLL_CTL_DEL)
@@ -15,6 +15,8 @@
 
 #include <vector>
 
+#include <stdint.h>
+
 struct epoll_event;
 
 namespace muduo
@@ -25,6 +27,11 @@ namespace net
 ///
 /// IO Multiplexing with epoll(4).
 ///
+/// updateChannel() 只记下这个 fd 需要同步，本轮 loop 里的所有修改
+/// 在下一次 epoll_wait() 之前一并交给内核，同一个 fd 的多次修改只取最终结果，
+/// 例如 enableWriting() 紧接着 disableWriting() 就不必调用 epoll_ctl。
+/// removeChannel() 之后 fd 可能马上被关闭并重用，Channel 也可能析构，所以立即 DEL。
+///
 class EPollPoller : public Poller
 {
  public:
@@ -34,6 +41,7 @@ class EPollPoller : public Poller
   Timestamp poll(int timeoutMs, ChannelList* activeChannels) override;
   void updateChannel(Channel* channel) override;
   void removeChannel(Channel* channel) override;
+  bool edgeTriggeredSupported() const override { return true; }
 
  private:
   static const int kInitEventListSize = 16;
@@ -42,12 +50,22 @@ class EPollPoller : public Poller
 
   void fillActiveChannels(int numEvents,
                           ChannelList* activeChannels) const;
-  void update(int operation, Channel* channel);
+  void update(int operation, Channel* channel, uint32_t events);
+  void syncInterests();
+
+  // 每个 fd 一项，按 fd 下标
+  struct Interest
+  {
+    uint32_t registered = 0;  // 已经交给内核的事件，0 表示不在 epoll 中
+    bool dirty = false;       // 在 dirtyFds_ 中
+  };
 
   typedef std::vector<struct epoll_event> EventList;
 
   int epollfd_;
   EventList events_;
+  std::vector<Interest> interests_;
+  std::vector<int> dirtyFds_;
 };
 
 }  // namespace net
@@ -0,0 +1,834 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include <muduo/net/poller/IoUringPoller.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/Buffer.h>
+#include <muduo/net/Channel.h>
+
+#include <algorithm>
+
+#include <assert.h>
+#include <errno.h>
+#include <stddef.h>
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+const int kNew = -1;
+const int kAdded = 1;
+
+// glibc 没有包装这两个系统调用
+int ioUringSetup(unsigned entries, struct io_uring_params* params)
+{
+  return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags,
+                 const void* arg, size_t argSize)
+{
+  return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete,
+                                    flags, arg, argSize));
+}
+
+unsigned loadAcquire(const unsigned* p)
+{
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+void storeRelease(unsigned* p, unsigned v)
+{
+  __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+static_assert(offsetof(struct io_uring_buf_ring, tail) == 14,
+              "tail overlays bufs[0].resv");
+
+template<typename T>
+T* offset(void* base, unsigned off)
+{
+  return reinterpret_cast<T*>(static_cast<char*>(base) + off);
+}
+
+}  // namespace
+
+IoUringPoller::IoUringPoller(EventLoop* loop, bool completionIo)
+  : Poller(loop),
+    ringFd_(-1),
+    multishotSupported_(true),
+    sqRing_(MAP_FAILED),
+    sqRingSize_(0),
+    cqRing_(MAP_FAILED),
+    cqRingSize_(0),
+    sqes_(NULL),
+    sqesSize_(0),
+    sqHead_(NULL),
+    sqTail_(NULL),
+    sqMask_(0),
+    sqEntries_(0),
+    sqArray_(NULL),
+    sqLocalTail_(0),
+    toSubmit_(0),
+    cqHead_(NULL),
+    cqTail_(NULL),
+    cqMask_(0),
+    cqes_(NULL),
+    bufRing_(NULL),
+    recvBuffers_(NULL),
+    bufRingTail_(0),
+    recvMultishotSupported_(true)
+{
+  if (!setupRing())
+  {
+    if (ringFd_ >= 0)
+    {
+      ::close(ringFd_);
+      ringFd_ = -1;
+    }
+  }
+  else if (completionIo && !setupBufferRing())
+  {
+    LOG_WARN << "io_uring provided buffer ring unavailable, "
+                "TcpConnection falls back to readiness-based I/O";
+  }
+}
+
+IoUringPoller::~IoUringPoller()
+{
+  if (sqes_ != NULL)
+  {
+    ::munmap(sqes_, sqesSize_);
+  }
+  if (cqRing_ != MAP_FAILED && cqRing_ != sqRing_)
+  {
+    ::munmap(cqRing_, cqRingSize_);
+  }
+  if (sqRing_ != MAP_FAILED)
+  {
+    ::munmap(sqRing_, sqRingSize_);
+  }
+  if (ringFd_ >= 0)
+  {
+    ::close(ringFd_);
+  }
+  // 先关闭 ring 取消所有请求，再释放 provided buffers
+  if (bufRing_ != NULL)
+  {
+    ::munmap(bufRing_, kRecvBufferCount * sizeof(struct io_uring_buf));
+  }
+  if (recvBuffers_ != NULL)
+  {
+    ::munmap(recvBuffers_, kRecvBufferCount * kRecvBufferSize);
+  }
+}
+
+bool IoUringPoller::setupRing()
+{
+  struct io_uring_params params;
+  memZero(&params, sizeof params);
+  // 只有 loop 线程提交，完成事件推迟到 io_uring_enter(GETEVENTS) 时处理，省掉 IPI (6.1+)
+  params.flags = IORING_SETUP_CLAMP | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+  ringFd_ = ioUringSetup(kRingEntries, &params);
+  if (ringFd_ < 0 && errno == EINVAL)
+  {
+    memZero(&params, sizeof params);
+    params.flags = IORING_SETUP_CLAMP;
+    ringFd_ = ioUringSetup(kRingEntries, &params);
+  }
+  if (ringFd_ < 0)
+  {
+    LOG_SYSERR << "io_uring_setup";
+    return false;
+  }
+  // NODROP: CQ 满了内核会暂存而不是丢事件 (5.5)；EXT_ARG: io_uring_enter 带超时 (5.11)
+  const unsigned required = IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+  if ((params.features & required) != required)
+  {
+    LOG_WARN << "io_uring lacks IORING_FEAT_NODROP or IORING_FEAT_EXT_ARG, features = "
+             << params.features;
+    return false;
+  }
+
+  sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (singleMmap)
+  {
+    sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+  }
+  sqRing_ = ::mmap(NULL, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   ringFd_, IORING_OFF_SQ_RING);
+  if (sqRing_ == MAP_FAILED)
+  {
+    LOG_SYSERR << "mmap IORING_OFF_SQ_RING";
+    return false;
+  }
+  cqRing_ = singleMmap ? sqRing_
+                       : ::mmap(NULL, cqRingSize_, PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_CQ_RING);
+  if (cqRing_ == MAP_FAILED)
+  {
+    LOG_SYSERR << "mmap IORING_OFF_CQ_RING";
+    return false;
+  }
+  sqesSize_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  void* sqes = ::mmap(NULL, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ringFd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED)
+  {
+    LOG_SYSERR << "mmap IORING_OFF_SQES";
+    return false;
+  }
+  sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+
+  sqHead_ = offset<unsigned>(sqRing_, params.sq_off.head);
+  sqTail_ = offset<unsigned>(sqRing_, params.sq_off.tail);
+  sqMask_ = *offset<unsigned>(sqRing_, params.sq_off.ring_mask);
+  sqEntries_ = *offset<unsigned>(sqRing_, params.sq_off.ring_entries);
+  sqArray_ = offset<unsigned>(sqRing_, params.sq_off.array);
+  cqHead_ = offset<unsigned>(cqRing_, params.cq_off.head);
+  cqTail_ = offset<unsigned>(cqRing_, params.cq_off.tail);
+  cqMask_ = *offset<unsigned>(cqRing_, params.cq_off.ring_mask);
+  cqes_ = offset<struct io_uring_cqe>(cqRing_, params.cq_off.cqes);
+
+  // SQE 按顺序使用，array 是恒等映射
+  for (unsigned i = 0; i < sqEntries_; ++i)
+  {
+    sqArray_[i] = i;
+  }
+  sqLocalTail_ = *sqTail_;
+  LOG_DEBUG << "io_uring fd " << ringFd_ << " sq " << params.sq_entries
+            << " cq " << params.cq_entries << " features " << params.features;
+  return true;
+}
+
+bool IoUringPoller::setupBufferRing()
+{
+  size_t ringSize = kRecvBufferCount * sizeof(struct io_uring_buf);
+  void* ring = ::mmap(NULL, ringSize, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ring == MAP_FAILED)
+  {
+    LOG_SYSERR << "mmap buffer ring";
+    return false;
+  }
+  size_t buffersSize = kRecvBufferCount * kRecvBufferSize;
+  void* buffers = ::mmap(NULL, buffersSize, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (buffers == MAP_FAILED)
+  {
+    LOG_SYSERR << "mmap recv buffers";
+    ::munmap(ring, ringSize);
+    return false;
+  }
+
+  struct io_uring_buf_reg reg;
+  memZero(&reg, sizeof reg);
+  reg.ring_addr = reinterpret_cast<uint64_t>(ring);
+  reg.ring_entries = kRecvBufferCount;
+  reg.bgid = kRecvBufferGroup;
+  if (::syscall(__NR_io_uring_register, ringFd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+  {
+    LOG_SYSERR << "IORING_REGISTER_PBUF_RING";
+    ::munmap(buffers, buffersSize);
+    ::munmap(ring, ringSize);
+    return false;
+  }
+  bufRing_ = static_cast<struct io_uring_buf_ring*>(ring);
+  recvBuffers_ = static_cast<char*>(buffers);
+  for (unsigned bid = 0; bid < kRecvBufferCount; ++bid)
+  {
+    recycleBuffer(static_cast<int>(bid));
+  }
+  return true;
+}
+
+Timestamp IoUringPoller::poll(int timeoutMs, ChannelList* activeChannels)
+{
+  size_t first = activeChannels->size();
+  syncRegistrations();
+
+  // getSqe() 在 SQ 满时提前收割的完成事件
+  for (int fd : earlyFds_)
+  {
+    Registration& reg = registrations_[fd];
+    if (reg.channel && reg.revents != 0)
+    {
+      activate(&reg, 0, activeChannels);
+    }
+  }
+  earlyFds_.clear();
+
+  for (int fd : pendingRecvFds_)
+  {
+    Registration& reg = registrations_[fd];
+    if (reg.channel && !reg.received.empty())
+    {
+      activate(&reg, POLLIN, activeChannels);
+    }
+  }
+  pendingRecvFds_.clear();
+
+  // 已经有完成事件就不再等待，只把本轮的注册和发送提交掉
+  int numEvents = static_cast<int>(activeChannels->size() - first);
+  numEvents += reapCompletions(activeChannels);
+  int ret = submitAndWait(timeoutMs, numEvents == 0);
+  int savedErrno = errno;
+  Timestamp now(Timestamp::now());
+  numEvents += reapCompletions(activeChannels);
+
+  for (size_t i = first; i < activeChannels->size(); ++i)
+  {
+    Channel* channel = (*activeChannels)[i];
+    Registration& reg = registrations_[channel->fd()];
+    channel->set_revents(reg.revents);
+    reg.revents = 0;
+    reg.active = false;
+  }
+  releasedGuards_.clear();
+
+  if (numEvents > 0)
+  {
+    LOG_TRACE << numEvents << " events happened";
+  }
+  else if (ret >= 0 || savedErrno == ETIME || savedErrno == EINTR)
+  {
+    LOG_TRACE << "nothing happened";
+  }
+  else if (savedErrno != EBUSY && savedErrno != EAGAIN)
+  {
+    errno = savedErrno;
+    LOG_SYSERR << "IoUringPoller::poll()";
+  }
+  return now;
+}
+
+void IoUringPoller::updateChannel(Channel* channel)
+{
+  Poller::assertInLoopThread();
+  LOG_TRACE << "fd = " << channel->fd()
+    << " events = " << channel->events() << " index = " << channel->index();
+  attach(channel);
+  // 推迟到下一次 poll()，同一轮内的多次修改合并成一次
+  markDirty(channel->fd());
+}
+
+void IoUringPoller::removeChannel(Channel* channel)
+{
+  Poller::assertInLoopThread();
+  int fd = channel->fd();
+  LOG_TRACE << "fd = " << fd;
+  assert(channel->isNoneEvent());
+  assert(channel->index() == kAdded);
+  eraseChannel(channel);
+
+  Registration& reg = registrations_[fd];
+  assert(reg.channel == channel);
+  if (reg.armedEvents != 0)
+  {
+    disarm(fd, &reg);
+  }
+  if (reg.recvArmed)
+  {
+    cancelRecv(fd, &reg);
+  }
+  for (const RecvChunk& chunk : reg.received)
+  {
+    if (chunk.res > 0)
+    {
+      recycleBuffer(chunk.bid);
+    }
+  }
+  reg.received.clear();
+  reg.recving = false;
+  reg.recvFinished = false;
+  // 在途的 send 还引用着连接的缓冲区，由 sendGuard 保活到完成为止
+  reg.sendDone = false;
+  // Channel 马上就要析构了，CQ 中尚未处理的旧事件都要作废
+  ++reg.generation;
+  reg.channel = nullptr;
+  reg.revents = 0;
+  channel->set_index(kNew);
+}
+
+void IoUringPoller::startRecv(Channel* channel)
+{
+  Poller::assertInLoopThread();
+  assert(completionIo());
+  Registration& reg = attach(channel);
+  reg.recving = true;
+  markDirty(channel->fd());
+  if (!reg.received.empty())
+  {
+    pendingRecvFds_.push_back(channel->fd());
+  }
+}
+
+void IoUringPoller::stopRecv(Channel* channel)
+{
+  Poller::assertInLoopThread();
+  int fd = channel->fd();
+  if (static_cast<size_t>(fd) >= registrations_.size())
+  {
+    return;
+  }
+  Registration& reg = registrations_[fd];
+  if (reg.channel != channel)
+  {
+    return;
+  }
+  reg.recving = false;
+  // 已经收到的数据留着，startRecv() 时再交给 TcpConnection
+  if (reg.recvArmed)
+  {
+    cancelRecv(fd, &reg);
+  }
+}
+
+ssize_t IoUringPoller::readReceived(Channel* channel, Buffer* buf, int* savedErrno)
+{
+  Registration& reg = registrations_[channel->fd()];
+  assert(reg.channel == channel);
+  ssize_t n = 0;
+  size_t i = 0;
+  for (; i < reg.received.size(); ++i)
+  {
+    const RecvChunk& chunk = reg.received[i];
+    if (chunk.res <= 0)
+    {
+      // 先把 EOF/错误之前的数据交出去，EOF/错误下一次再报告
+      if (n == 0)
+      {
+        n = chunk.res == 0 ? 0 : -1;
+        *savedErrno = -chunk.res;
+        ++i;
+      }
+      break;
+    }
+    buf->append(recvBuffers_ + static_cast<size_t>(chunk.bid) * kRecvBufferSize, chunk.res);
+    recycleBuffer(chunk.bid);
+    n += chunk.res;
+  }
+  if (i == 0)
+  {
+    *savedErrno = EAGAIN;
+    return -1;
+  }
+  reg.received.erase(reg.received.begin(), reg.received.begin() + i);
+  if (!reg.received.empty())
+  {
+    pendingRecvFds_.push_back(channel->fd());
+  }
+  return n;
+}
+
+void IoUringPoller::startSend(Channel* channel, const void* data, size_t len,
+                              std::shared_ptr<void> guard)
+{
+  Poller::assertInLoopThread();
+  int fd = channel->fd();
+  Registration& reg = attach(channel);
+  assert(!reg.sendInFlight && !reg.sendDone);
+  struct io_uring_sqe* sqe = getSqe();
+  sqe->opcode = IORING_OP_SEND;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uint64_t>(data);
+  sqe->len = static_cast<uint32_t>(std::min(len, static_cast<size_t>(1) << 30));
+  sqe->msg_flags = MSG_NOSIGNAL;
+  sqe->user_data = makeUserData(kSendOp, fd, 0);
+  reg.sendInFlight = true;
+  reg.sendDone = false;
+  reg.sendGuard = std::move(guard);
+}
+
+bool IoUringPoller::sending(Channel* channel) const
+{
+  size_t fd = static_cast<size_t>(channel->fd());
+  // 完成了但 TcpConnection 还没有取走结果的也算，否则已经发出的数据会被再发一遍
+  return fd < registrations_.size()
+      && registrations_[fd].channel == channel
+      && (registrations_[fd].sendInFlight || registrations_[fd].sendDone);
+}
+
+ssize_t IoUringPoller::takeSendResult(Channel* channel, int* savedErrno)
+{
+  Registration& reg = registrations_[channel->fd()];
+  assert(reg.channel == channel);
+  if (!reg.sendDone)
+  {
+    *savedErrno = EAGAIN;
+    return -1;
+  }
+  reg.sendDone = false;
+  // 调用者还持有自己，这里释放不会析构
+  reg.sendGuard.reset();
+  if (reg.sendResult < 0)
+  {
+    *savedErrno = -reg.sendResult;
+    return -1;
+  }
+  return reg.sendResult;
+}
+
+IoUringPoller::Registration& IoUringPoller::registrationOf(int fd)
+{
+  assert(fd >= 0);
+  if (static_cast<size_t>(fd) >= registrations_.size())
+  {
+    registrations_.resize(std::max(static_cast<size_t>(fd) + 1, registrations_.size() * 2));
+  }
+  return registrations_[fd];
+}
+
+IoUringPoller::Registration& IoUringPoller::attach(Channel* channel)
+{
+  const int fd = channel->fd();
+  if (channel->index() == kNew)
+  {
+    assert(fd < (1 << 24));
+    addChannel(channel);
+    Registration& reg = registrationOf(fd);
+    assert(reg.channel == nullptr);
+    reg.channel = channel;
+    channel->set_index(kAdded);
+    return reg;
+  }
+  assert(channel->index() == kAdded);
+  assert(channelOf(fd) == channel);
+  assert(registrations_[fd].channel == channel);
+  return registrations_[fd];
+}
+
+void IoUringPoller::markDirty(int fd)
+{
+  Registration& reg = registrations_[fd];
+  if (!reg.dirty)
+  {
+    reg.dirty = true;
+    dirtyFds_.push_back(fd);
+  }
+}
+
+void IoUringPoller::activate(Registration* reg, int revents, ChannelList* activeChannels)
+{
+  reg->revents |= revents;
+  if (!reg->active)
+  {
+    reg->active = true;
+    activeChannels->push_back(reg->channel);
+  }
+}
+
+void IoUringPoller::syncRegistrations()
+{
+  // getSqe() 可能收割完成事件而追加 dirtyFds_，不能用迭代器
+  for (size_t i = 0; i < dirtyFds_.size(); ++i)
+  {
+    int fd = dirtyFds_[i];
+    Registration& reg = registrations_[fd];
+    reg.dirty = false;
+    int desired = reg.channel ? reg.channel->events() : 0;
+    bool multishot = reg.channel && reg.channel->edgeTriggered() && multishotSupported_;
+    if (reg.armedEvents != 0 && (reg.armedEvents != desired || reg.multishot != multishot))
+    {
+      disarm(fd, &reg);
+    }
+    if (desired != 0 && reg.armedEvents == 0)
+    {
+      reg.multishot = multishot;
+      arm(fd, &reg, desired);
+    }
+    if (reg.channel && reg.recving && !reg.recvArmed && !reg.recvFinished)
+    {
+      armRecv(fd, &reg);
+    }
+  }
+  dirtyFds_.clear();
+}
+
+void IoUringPoller::arm(int fd, Registration* reg, int events)
+{
+  // getSqe() 可能收割完成事件，先取 SQE 再改 generation
+  struct io_uring_sqe* sqe = getSqe();
+  ++reg->generation;
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = fd;
+  sqe->poll32_events = static_cast<uint32_t>(events);
+  sqe->len = reg->multishot ? IORING_POLL_ADD_MULTI : 0;
+  sqe->user_data = makeUserData(kPollOp, fd, reg->generation);
+  reg->armedEvents = events;
+  LOG_TRACE << "POLL_ADD fd = " << fd << " events = " << events
+            << (reg->multishot ? " multishot" : "");
+}
+
+void IoUringPoller::disarm(int fd, Registration* reg)
+{
+  struct io_uring_sqe* sqe = getSqe();
+  sqe->opcode = IORING_OP_POLL_REMOVE;
+  sqe->fd = -1;
+  sqe->addr = makeUserData(kPollOp, fd, reg->generation);
+  sqe->user_data = kIgnoredUserData;
+  // 被取消的请求还会产生一个 -ECANCELED 的 CQE，换一个 generation 把它作废
+  ++reg->generation;
+  reg->armedEvents = 0;
+  LOG_TRACE << "POLL_REMOVE fd = " << fd;
+}
+
+void IoUringPoller::armRecv(int fd, Registration* reg)
+{
+  struct io_uring_sqe* sqe = getSqe();
+  ++reg->recvGeneration;
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = fd;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = kRecvBufferGroup;
+  sqe->ioprio = recvMultishotSupported_ ? IORING_RECV_MULTISHOT : 0;
+  sqe->user_data = makeUserData(kRecvOp, fd, reg->recvGeneration);
+  reg->recvArmed = true;
+  LOG_TRACE << "RECV fd = " << fd;
+}
+
+void IoUringPoller::cancelRecv(int fd, Registration* reg)
+{
+  struct io_uring_sqe* sqe = getSqe();
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->fd = -1;
+  sqe->addr = makeUserData(kRecvOp, fd, reg->recvGeneration);
+  sqe->user_data = kIgnoredUserData;
+  ++reg->recvGeneration;
+  reg->recvArmed = false;
+  LOG_TRACE << "ASYNC_CANCEL recv fd = " << fd;
+}
+
+void IoUringPoller::recycleBuffer(int bid)
+{
+  // 不用 bufRing_->bufs：__DECLARE_FLEX_ARRAY 在 C++ 里多出一个空 struct，偏移不对
+  struct io_uring_buf* buf = reinterpret_cast<struct io_uring_buf*>(bufRing_)
+                             + (bufRingTail_ & (kRecvBufferCount - 1));
+  buf->addr = reinterpret_cast<uint64_t>(recvBuffers_ + static_cast<size_t>(bid) * kRecvBufferSize);
+  buf->len = kRecvBufferSize;
+  buf->bid = static_cast<uint16_t>(bid);
+  ++bufRingTail_;
+  __atomic_store_n(&bufRing_->tail, bufRingTail_, __ATOMIC_RELEASE);
+}
+
+struct io_uring_sqe* IoUringPoller::getSqe()
+{
+  // SQ 满了，先提交一批。内核一个都没有消费时（EINTR，或者 CQ 积压时的 EBUSY），
+  // 下一个位置还是最早的未提交 SQE，不能覆盖，收割完成事件腾出 CQ 之后再试
+  while (sqLocalTail_ - loadAcquire(sqHead_) >= sqEntries_)
+  {
+    if (submitAndWait(0, false) >= 0 || errno == EINTR)
+    {
+      continue;
+    }
+    if (errno != EBUSY && errno != EAGAIN)
+    {
+      LOG_SYSFATAL << "IoUringPoller::getSqe() io_uring_enter";
+    }
+    ChannelList early;
+    reapCompletions(&early);
+    // 留到下一次 poll() 交给 EventLoop
+    for (Channel* channel : early)
+    {
+      Registration& reg = registrations_[channel->fd()];
+      reg.active = false;
+      earlyFds_.push_back(channel->fd());
+    }
+  }
+  struct io_uring_sqe* sqe = &sqes_[sqLocalTail_ & sqMask_];
+  memZero(sqe, sizeof *sqe);
+  ++sqLocalTail_;
+  ++toSubmit_;
+  return sqe;
+}
+
+int IoUringPoller::submitAndWait(int timeoutMs, bool wait)
+{
+  if (toSubmit_ == 0 && !wait)
+  {
+    return 0;
+  }
+  storeRelease(sqTail_, sqLocalTail_);
+  struct __kernel_timespec ts;
+  struct io_uring_getevents_arg arg;
+  memZero(&arg, sizeof arg);
+  unsigned flags = 0;
+  unsigned minComplete = 0;
+  if (wait)
+  {
+    flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+    minComplete = 1;
+    if (timeoutMs >= 0)
+    {
+      ts.tv_sec = timeoutMs / 1000;
+      ts.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000 * 1000;
+      arg.ts = reinterpret_cast<uint64_t>(&ts);
+    }
+  }
+  int ret = ioUringEnter(ringFd_, toSubmit_, minComplete, flags,
+                         wait ? &arg : NULL, wait ? sizeof arg : 0);
+  // 返回值在提交和等待都发生时语义不明确，直接看内核消费到了哪里
+  toSubmit_ = sqLocalTail_ - loadAcquire(sqHead_);
+  return ret;
+}
+
+int IoUringPoller::reapCompletions(ChannelList* activeChannels)
+{
+  size_t before = activeChannels->size();
+  unsigned head = *cqHead_;
+  unsigned tail = loadAcquire(cqTail_);
+  while (head != tail)
+  {
+    handleCompletion(cqes_[head & cqMask_], activeChannels);
+    ++head;
+  }
+  storeRelease(cqHead_, head);
+  return static_cast<int>(activeChannels->size() - before);
+}
+
+void IoUringPoller::handleCompletion(const struct io_uring_cqe& cqe,
+                                     ChannelList* activeChannels)
+{
+  if (cqe.user_data == kIgnoredUserData)
+  {
+    return;
+  }
+  OpKind kind = static_cast<OpKind>(cqe.user_data >> 56);
+  int fd = static_cast<int>((cqe.user_data >> 32) & 0xFFFFFF);
+  uint32_t generation = static_cast<uint32_t>(cqe.user_data);
+  assert(static_cast<size_t>(fd) < registrations_.size());
+  switch (kind)
+  {
+    case kPollOp:
+      handlePollCompletion(cqe, fd, generation, activeChannels);
+      break;
+    case kRecvOp:
+      handleRecvCompletion(cqe, fd, generation, activeChannels);
+      break;
+    case kSendOp:
+      handleSendCompletion(cqe, fd, activeChannels);
+      break;
+  }
+}
+
+void IoUringPoller::handlePollCompletion(const struct io_uring_cqe& cqe, int fd,
+                                         uint32_t generation,
+                                         ChannelList* activeChannels)
+{
+  Registration& reg = registrations_[fd];
+  if (reg.generation != generation || reg.channel == nullptr)
+  {
+    return;  // stale
+  }
+  if (!(cqe.flags & IORING_CQE_F_MORE))
+  {
+    // 请求已经结束（one-shot，或者 multishot 被内核终止），在下一次 poll() 重新注册，
+    // 那时事件回调已经执行完，注册时内核会重新检查就绪状态
+    reg.armedEvents = 0;
+    markDirty(fd);
+  }
+  if (cqe.res < 0)
+  {
+    if (cqe.res == -EINVAL && reg.multishot)
+    {
+      LOG_WARN << "IORING_POLL_ADD_MULTI not supported, falling back to one-shot poll";
+      multishotSupported_ = false;
+      return;
+    }
+    // 单个 fd 的错误（EBADF、ENOMEM、io-wq 中的 ECANCELED 等）不影响别的连接，
+    // 和 EPOLLERR 一样交给 Channel 的错误/关闭回调，下一次 poll() 重新注册
+    errno = -cqe.res;
+    LOG_SYSERR << "IORING_OP_POLL_ADD fd = " << fd;
+    reg.armedEvents = 0;
+    markDirty(fd);
+    activate(&reg, POLLERR, activeChannels);
+    return;
+  }
+  activate(&reg, cqe.res, activeChannels);
+}
+
+void IoUringPoller::handleRecvCompletion(const struct io_uring_cqe& cqe, int fd,
+                                         uint32_t generation,
+                                         ChannelList* activeChannels)
+{
+  Registration& reg = registrations_[fd];
+  bool hasBuffer = cqe.flags & IORING_CQE_F_BUFFER;
+  int bid = static_cast<int>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+  if (reg.recvGeneration != generation || reg.channel == nullptr)
+  {
+    // stale，已经取消或者 Channel 已经移除
+    if (hasBuffer)
+    {
+      recycleBuffer(bid);
+    }
+    return;
+  }
+  if (!(cqe.flags & IORING_CQE_F_MORE))
+  {
+    reg.recvArmed = false;
+    markDirty(fd);
+  }
+  if (cqe.res > 0)
+  {
+    assert(hasBuffer);
+    reg.received.push_back(RecvChunk{cqe.res, bid});
+  }
+  else if (cqe.res == -ENOBUFS)
+  {
+    // provided buffers 用完了，TcpConnection 取走数据之后在下一次 poll() 重新提交
+    LOG_TRACE << "recv fd = " << fd << " out of provided buffers";
+    return;
+  }
+  else if (cqe.res == -EINVAL && recvMultishotSupported_)
+  {
+    LOG_WARN << "IORING_RECV_MULTISHOT not supported, falling back to one-shot recv";
+    recvMultishotSupported_ = false;
+    return;
+  }
+  else if (cqe.res == -ECANCELED)
+  {
+    return;
+  }
+  else
+  {
+    // EOF 或错误
+    if (hasBuffer)
+    {
+      recycleBuffer(bid);
+    }
+    reg.recvFinished = true;
+    reg.received.push_back(RecvChunk{cqe.res, -1});
+  }
+  activate(&reg, POLLIN, activeChannels);
+}
+
+void IoUringPoller::handleSendCompletion(const struct io_uring_cqe& cqe, int fd,
+                                         ChannelList* activeChannels)
+{
+  Registration& reg = registrations_[fd];
+  assert(reg.sendInFlight);
+  reg.sendInFlight = false;
+  if (reg.channel == nullptr)
+  {
+    // 连接已经移除，不能在遍历 CQ 的时候析构它
+    releasedGuards_.push_back(std::move(reg.sendGuard));
+    reg.sendGuard.reset();
+    return;
+  }
+  reg.sendDone = true;
+  reg.sendResult = cqe.res;
+  activate(&reg, POLLOUT, activeChannels);
+}
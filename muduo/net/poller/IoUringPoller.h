@@ -0,0 +1,196 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_POLLER_IOURINGPOLLER_H
+#define MUDUO_NET_POLLER_IOURINGPOLLER_H
+
+#include <muduo/net/Poller.h>
+
+#include <memory>
+#include <vector>
+
+#include <stdint.h>
+#include <sys/types.h>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf_ring;
+
+namespace muduo
+{
+namespace net
+{
+
+class Buffer;
+
+///
+/// IO Multiplexing with io_uring(7) IORING_OP_POLL_ADD.
+///
+/// 不依赖 liburing，直接用 io_uring_setup/io_uring_enter 系统调用。
+/// updateChannel() 只记录变化，本轮所有的注册/注销在下一次 poll() 时
+/// 与等待合并成一次 io_uring_enter()，不再是每次一个 epoll_ctl。
+///
+/// 普通 Channel 使用 one-shot poll，事件处理完后在下一次 poll() 重新注册，
+/// 注册时内核会立即检查就绪状态，因此与 EPollPoller 一样是水平触发的；
+/// edgeTriggered() 的 Channel 使用 multishot poll，注册一次一直有效。
+///
+/// completionIo 模式下还为 TcpConnection 提供基于完成事件的数据通路：
+/// 读是 multishot IORING_OP_RECV，数据由内核直接写进 provided buffer ring；
+/// 写是 IORING_OP_SEND。两者都和 poll 注册一样在下一次 poll() 时批量提交，
+/// 完成后把 Channel 以 POLLIN/POLLOUT 放进 activeChannels，
+/// 由 TcpConnection::handleRead/handleWrite 取走结果，不再各自调用 readv/write。
+///
+class IoUringPoller : public Poller
+{
+ public:
+  explicit IoUringPoller(EventLoop* loop, bool completionIo = false);
+  ~IoUringPoller() override;
+
+  /// false if the kernel does not support what we need,
+  /// caller should fall back to EPollPoller.
+  bool ok() const { return ringFd_ >= 0; }
+  /// true if the completion-based data path is usable,
+  /// needs provided buffer rings (Linux 5.19).
+  bool completionIo() const { return bufRing_ != nullptr; }
+
+  Timestamp poll(int timeoutMs, ChannelList* activeChannels) override;
+  void updateChannel(Channel* channel) override;
+  void removeChannel(Channel* channel) override;
+  // io_uring 的 multishot poll 默认就是 EPOLLET
+  bool edgeTriggeredSupported() const override { return multishotSupported_; }
+
+  // completion-based data path, used by TcpConnection.
+  // channel 不需要 enableReading()，startRecv() 会把它加入本 Poller。
+
+  void startRecv(Channel* channel);
+  void stopRecv(Channel* channel);
+  /// Appends received data to buf, same return value as Buffer::readFd().
+  ssize_t readReceived(Channel* channel, Buffer* buf, int* savedErrno);
+  /// At most one send in flight per channel, data must stay valid until
+  /// takeSendResult(), guard is released when the send completes.
+  void startSend(Channel* channel, const void* data, size_t len,
+                 std::shared_ptr<void> guard);
+  /// true from startSend() until takeSendResult()
+  bool sending(Channel* channel) const;
+  /// bytes sent or -1, like write(2).
+  ssize_t takeSendResult(Channel* channel, int* savedErrno);
+
+ private:
+  static const unsigned kRingEntries = 256;
+  static const uint64_t kIgnoredUserData = ~uint64_t(0);
+  static const unsigned kRecvBufferCount = 256;  // power of 2
+  static const unsigned kRecvBufferSize = 16 * 1024;
+  static const uint16_t kRecvBufferGroup = 0;
+
+  enum OpKind
+  {
+    kPollOp,
+    kRecvOp,
+    kSendOp,
+  };
+
+  // 已经收到、还没有被 readReceived() 取走的数据，res <= 0 表示 EOF 或 -errno
+  struct RecvChunk
+  {
+    int res;
+    int bid;
+  };
+
+  // 每个 fd 一项，按 fd 下标
+  struct Registration
+  {
+    Channel* channel = nullptr;
+    uint32_t generation = 0;   // 每次注册加一，过期的 CQE 据此丢弃
+    int armedEvents = 0;       // 已经提交给内核的事件，0 表示没有注册
+    bool multishot = false;
+    bool dirty = false;        // 在 dirtyFds_ 中
+    bool active = false;       // 在本次 poll() 的 activeChannels 中
+    int revents = 0;
+
+    bool recving = false;      // startRecv() 之后、stopRecv() 之前
+    bool recvArmed = false;
+    bool recvFinished = false; // 已经收到 EOF 或错误，不再重新提交
+    uint32_t recvGeneration = 0;
+    std::vector<RecvChunk> received;
+    bool sendInFlight = false;
+    bool sendDone = false;
+    int sendResult = 0;
+    std::shared_ptr<void> sendGuard;
+  };
+
+  bool setupRing();
+  bool setupBufferRing();
+  Registration& registrationOf(int fd);
+  Registration& attach(Channel* channel);
+  void markDirty(int fd);
+  void activate(Registration* reg, int revents, ChannelList* activeChannels);
+  void syncRegistrations();
+  void arm(int fd, Registration* reg, int events);
+  void disarm(int fd, Registration* reg);
+  void armRecv(int fd, Registration* reg);
+  void cancelRecv(int fd, Registration* reg);
+  void recycleBuffer(int bid);
+  io_uring_sqe* getSqe();
+  int submitAndWait(int timeoutMs, bool wait);
+  int reapCompletions(ChannelList* activeChannels);
+  void handleCompletion(const io_uring_cqe& cqe, ChannelList* activeChannels);
+  void handlePollCompletion(const io_uring_cqe& cqe, int fd, uint32_t generation,
+                            ChannelList* activeChannels);
+  void handleRecvCompletion(const io_uring_cqe& cqe, int fd, uint32_t generation,
+                            ChannelList* activeChannels);
+  void handleSendCompletion(const io_uring_cqe& cqe, int fd,
+                            ChannelList* activeChannels);
+
+  // kind:8 | fd:24 | generation:32
+  static uint64_t makeUserData(OpKind kind, int fd, uint32_t generation)
+  {
+    return (static_cast<uint64_t>(kind) << 56)
+        | (static_cast<uint64_t>(fd) << 32)
+        | generation;
+  }
+
+  int ringFd_;
+  bool multishotSupported_;
+
+  void* sqRing_;
+  size_t sqRingSize_;
+  void* cqRing_;
+  size_t cqRingSize_;
+  io_uring_sqe* sqes_;
+  size_t sqesSize_;
+
+  unsigned* sqHead_;
+  unsigned* sqTail_;
+  unsigned sqMask_;
+  unsigned sqEntries_;
+  unsigned* sqArray_;
+  unsigned sqLocalTail_;  // 已填写、还没有发布给内核的 SQE 的尾部
+  unsigned toSubmit_;
+
+  unsigned* cqHead_;
+  unsigned* cqTail_;
+  unsigned cqMask_;
+  io_uring_cqe* cqes_;
+
+  io_uring_buf_ring* bufRing_;
+  char* recvBuffers_;
+  uint16_t bufRingTail_;
+  bool recvMultishotSupported_;
+
+  std::vector<Registration> registrations_;
+  std::vector<int> dirtyFds_;
+  // 还有 received 数据没取完的 fd，下一次 poll() 直接再激活，不等待
+  std::vector<int> pendingRecvFds_;
+  // getSqe() 提前收割到完成事件的 fd，revents 留在 Registration 里，下一次 poll() 交出
+  std::vector<int> earlyFds_;
+  // 连接已经 removeChannel() 之后才完成的 send，在 poll() 结束时释放
+  std::vector<std::shared_ptr<void>> releasedGuards_;
+};
+
+}  // namespace net
+}  // namespace muduo
+#endif  // MUDUO_NET_POLLER_IOURINGPOLLER_H
@@ -61,9 +61,8 @@ void PollPoller::fillActiveChannels(int numEvents,
     if (pfd->revents > 0)
     {
       --numEvents;
-      ChannelMap::const_iterator ch = channels_.find(pfd->fd);
-      assert(ch != channels_.end());
-      Channel* channel = ch->second;
+      Channel* channel = channelOf(pfd->fd);
+      assert(channel != NULL);
       assert(channel->fd() == pfd->fd);
       channel->set_revents(pfd->revents);
       // pfd->revents = 0;
@@ -79,7 +78,7 @@ void PollPoller::updateChannel(Channel* channel)
   if (channel->index() < 0) // Channel 没有记住过自己在 pollfds_ 中的下标，即第一次添加
   {
     // a new one, add to pollfds_
-    assert(channels_.find(channel->fd()) == channels_.end());
+    assert(channelOf(channel->fd()) == NULL);
     struct pollfd pfd;
     pfd.fd = channel->fd();
     pfd.events = static_cast<short>(channel->events());
@@ -87,13 +86,12 @@ void PollPoller::updateChannel(Channel* channel)
     pollfds_.push_back(pfd);
     int idx = static_cast<int>(pollfds_.size())-1;
     channel->set_index(idx); // Channel 记住自己在 pollfds_ 中的下标
-    channels_[pfd.fd] = channel; // 添加新 Channel，复杂度为 O(logN)
+    addChannel(channel); // 添加新 Channel，复杂度为 O(1)
   }
   else // Channel 已经记住过自己在 pollfds_ 中的下标，即更新已有的 Channel
   {
     // update existing one
-    assert(channels_.find(channel->fd()) != channels_.end());
-    assert(channels_[channel->fd()] == channel);
+    assert(channelOf(channel->fd()) == channel);
     int idx = channel->index();
     assert(0 <= idx && idx < static_cast<int>(pollfds_.size()));
     struct pollfd& pfd = pollfds_[idx]; //更新已有的 Channel，复杂度为 O(1)
@@ -113,15 +111,13 @@ void PollPoller::removeChannel(Channel* channel)
 {
   Poller::assertInLoopThread();
   LOG_TRACE << "fd = " << channel->fd();
-  assert(channels_.find(channel->fd()) != channels_.end());
-  assert(channels_[channel->fd()] == channel);
+  assert(channelOf(channel->fd()) == channel);
   assert(channel->isNoneEvent());
   int idx = channel->index();
   assert(0 <= idx && idx < static_cast<int>(pollfds_.size()));
   const struct pollfd& pfd = pollfds_[idx]; (void)pfd;
   assert(pfd.fd == -channel->fd()-1 && pfd.events == channel->events());
-  size_t n = channels_.erase(channel->fd()); // 从 channels_ 中删除 Channel，复杂度为 O(logN)
-  assert(n == 1); (void)n;
+  eraseChannel(channel); // 从 channels_ 中删除 Channel，复杂度为 O(1)
   if (implicit_cast<size_t>(idx) == pollfds_.size()-1) // Channel 在 pollfds_ 中的下标是最后一个，直接删除即可，复杂度为 O(1)
   {
     pollfds_.pop_back();
@@ -137,5 +133,6 @@ void PollPoller::removeChannel(Channel* channel)
     channels_[channelAtEnd]->set_index(idx);
     pollfds_.pop_back();
   }
+  channel->set_index(-1); // 可能再次加入，比如迁移到另一个 loop
 }
 
@@ -0,0 +1,79 @@
+// 突发短连接下 Acceptor 每次可读事件 accept 一个和批量 accept 的差别。
+// 客户端线程用阻塞 socket 一次连上 burst 个再全部关闭，握手由内核完成，
+// 服务端只负责 accept 和关闭，统计连接速率和服务端 loop 的迭代次数。
+// usage: accept_bench [maxAcceptsPerRead] [connections] [burst] [port]
+
+#include <muduo/base/Logging.h>
+#include <muduo/base/Thread.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/SocketsOps.h>
+#include <muduo/net/TcpServer.h>
+
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+void client(const InetAddress& serverAddr, int connections, int burst)
+{
+  std::vector<int> fds;
+  for (int i = 0; i < connections; i += burst)
+  {
+    for (int j = 0; j < burst && i + j < connections; ++j)
+    {
+      int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+      if (::connect(fd, serverAddr.getSockAddr(),
+                    static_cast<socklen_t>(sizeof(struct sockaddr_in))) < 0)
+      {
+        LOG_SYSFATAL << "connect";
+      }
+      fds.push_back(fd);
+    }
+    for (int fd : fds)
+    {
+      ::close(fd);
+    }
+    fds.clear();
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  int maxAccepts = argc > 1 ? atoi(argv[1]) : 1;
+  int connections = argc > 2 ? atoi(argv[2]) : 50000;
+  int burst = argc > 3 ? atoi(argv[3]) : 64;
+  uint16_t port = static_cast<uint16_t>(argc > 4 ? atoi(argv[4]) : 2020);
+  Logger::setLogLevel(Logger::WARN);
+
+  EventLoop loop;
+  InetAddress listenAddr(port, true);
+  TcpServer server(&loop, listenAddr, "AcceptServer");
+  server.setMaxAcceptsPerRead(maxAccepts);
+  int closed = 0;
+  server.setConnectionCallback([&loop, &closed, connections](const TcpConnectionPtr& conn) {
+    if (conn->disconnected() && ++closed == connections)
+    {
+      loop.quit();
+    }
+  });
+  server.start();
+
+  int64_t iterationsBefore = loop.iteration();
+  Timestamp start(Timestamp::now());
+  Thread thr(std::bind(client, listenAddr, connections, burst), "client");
+  loop.loop();
+  double seconds = timeDifference(Timestamp::now(), start);
+  thr.join();
+
+  int64_t iterations = loop.iteration() - iterationsBefore;
+  printf("maxAcceptsPerRead %d, burst %d: %d connections in %.3f s, %.0f conn/s, "
+         "%.2f loop iterations per connection\n",
+         maxAccepts, burst, connections, seconds, connections / seconds,
+         static_cast<double>(iterations) / connections);
+}
@@ -0,0 +1,106 @@
+// 大消息流式发送时连续的 Buffer（flat）和 ChainBuffer（chain）作为输出缓冲区的差别。
+// 服务端每 1ms 发一条消息，客户端线程用阻塞 socket 接收：
+// fast 尽快读；slow 每读 64KiB 睡 1ms，输出缓冲区越积越多，
+// flat 每次追加都可能把积压的数据整体挪到头部（Buffer::makeSpace）。
+// 统计服务端 loop 的忙碌时间，即发送路径上的 CPU 开销。
+// usage: chainbuffer_bench [flat|chain] [message KiB] [messages] [fast|slow] [port]
+
+#include <muduo/base/Logging.h>
+#include <muduo/base/Thread.h>
+#include <muduo/net/ChainBuffer.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/TcpServer.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const double kSendInterval = 0.001;
+const size_t kSlowReadSize = 64 * 1024;
+
+void client(const InetAddress& serverAddr, int64_t total, bool slow)
+{
+  int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+  if (::connect(fd, serverAddr.getSockAddr(),
+                static_cast<socklen_t>(sizeof(struct sockaddr_in))) < 0)
+  {
+    LOG_SYSFATAL << "connect";
+  }
+  static char buf[256 * 1024];
+  int64_t received = 0;
+  while (received < total)
+  {
+    ssize_t n = ::read(fd, buf, slow ? kSlowReadSize : sizeof buf);
+    if (n <= 0)
+    {
+      LOG_SYSFATAL << "read";
+    }
+    received += n;
+    if (slow)
+    {
+      ::usleep(1000);
+    }
+  }
+  ::close(fd);
+}
+
+int main(int argc, char* argv[])
+{
+  bool chained = argc > 1 && strcmp(argv[1], "chain") == 0;
+  size_t messageSize = (argc > 2 ? atoi(argv[2]) : 256) * 1024;
+  int messages = argc > 3 ? atoi(argv[3]) : 200;
+  bool slow = argc > 4 && strcmp(argv[4], "slow") == 0;
+  uint16_t port = static_cast<uint16_t>(argc > 5 ? atoi(argv[5]) : 2023);
+  Logger::setLogLevel(Logger::WARN);
+
+  EventLoop loop;
+  InetAddress listenAddr(port, true);
+  TcpServer server(&loop, listenAddr, "ChainBufferServer");
+  server.setChainedOutput(chained);
+  const string message(messageSize, 'x');
+  int sent = 0;
+  server.setConnectionCallback([&](const TcpConnectionPtr& conn) {
+    if (conn->connected())
+    {
+      loop.runEvery(kSendInterval, [&, conn] {
+        if (sent < messages)
+        {
+          conn->send(message);
+          ++sent;
+        }
+      });
+    }
+    else
+    {
+      loop.quit();
+    }
+  });
+  server.start();
+
+  int64_t total = static_cast<int64_t>(messageSize) * messages;
+  int64_t busyBefore = loop.busyMicroSeconds();
+  Timestamp start(Timestamp::now());
+  Thread thr(std::bind(client, listenAddr, total, slow), "client");
+  loop.loop();
+  double seconds = timeDifference(Timestamp::now(), start);
+  thr.join();
+
+  double busy = static_cast<double>(loop.busyMicroSeconds() - busyBefore) / 1000;
+  printf("%s output, %s reader: %d x %zu KiB in %.3f s, %.1f MiB/s, "
+         "server loop busy %.1f ms (%.3f ms per message)\n",
+         chained ? "chained" : "flat", slow ? "slow" : "fast",
+         messages, messageSize / 1024, seconds,
+         static_cast<double>(total) / seconds / (1024 * 1024),
+         busy, busy / messages);
+  BlockPool* pool = loop.blockPool();
+  printf("block pool: %zu free, %lld in use\n",
+         pool->numFree(), static_cast<long long>(pool->numInUse()));
+  fflush(stdout);
+  ::_exit(0);  // 定时器还捕获着连接
+}
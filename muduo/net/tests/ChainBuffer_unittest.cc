@@ -0,0 +1,144 @@
+#include <muduo/net/ChainBuffer.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/TcpConnection.h>
+
+//#define BOOST_TEST_MODULE ChainBufferTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+using muduo::string;
+using muduo::net::BlockPool;
+using muduo::net::ChainBuffer;
+using muduo::net::EventLoop;
+using muduo::net::InetAddress;
+using muduo::net::TcpConnection;
+using muduo::net::TcpConnectionPtr;
+
+string pattern(size_t len)
+{
+  string str(len, '\0');
+  for (size_t i = 0; i < len; ++i)
+  {
+    str[i] = static_cast<char>(i % 251);
+  }
+  return str;
+}
+
+BOOST_AUTO_TEST_CASE(testChainBufferAppendRetrieve)
+{
+  BlockPool pool;
+  ChainBuffer buf(&pool);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 0);
+  BOOST_CHECK_EQUAL(buf.numBlocks(), 0);
+
+  buf.append("hello", 5);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 5);
+  BOOST_CHECK_EQUAL(buf.numBlocks(), 1);
+
+  // 跨越块的边界，已有的块不动
+  const string large = pattern(2 * BlockPool::kBlockSize);
+  buf.append(large.data(), large.size());
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 5 + large.size());
+  BOOST_CHECK_EQUAL(buf.numBlocks(), 3);
+  BOOST_CHECK_EQUAL(pool.numInUse(), 3);
+
+  buf.retrieve(BlockPool::kBlockSize);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 5 + BlockPool::kBlockSize);
+  BOOST_CHECK_EQUAL(buf.numBlocks(), 2);
+  BOOST_CHECK_EQUAL(pool.numInUse(), 2);
+  BOOST_CHECK_EQUAL(pool.numFree(), 1);
+
+  buf.retrieveAll();
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 0);
+  BOOST_CHECK_EQUAL(buf.numBlocks(), 0);
+  BOOST_CHECK_EQUAL(pool.numInUse(), 0);
+  BOOST_CHECK_EQUAL(pool.numFree(), 3);
+
+  // 再次 append 用 pool 里的块
+  buf.append(large.data(), large.size());
+  BOOST_CHECK_EQUAL(buf.numBlocks(), 2);
+  BOOST_CHECK_EQUAL(pool.numFree(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(testChainBufferPoolLimit)
+{
+  BlockPool pool;
+  {
+    ChainBuffer buf(&pool);
+    const string block(BlockPool::kBlockSize, 'x');
+    for (size_t i = 0; i < BlockPool::kMaxFreeBlocks + 10; ++i)
+    {
+      buf.append(block.data(), block.size());
+    }
+    buf.retrieveAll();
+    BOOST_CHECK_EQUAL(pool.numFree(), BlockPool::kMaxFreeBlocks);
+    BOOST_CHECK_EQUAL(pool.numInUse(), 0);
+    buf.append("x", 1);
+  }
+  // 析构时直接释放，不还给 pool，numInUse() 也不变
+  BOOST_CHECK_EQUAL(pool.numFree(), BlockPool::kMaxFreeBlocks - 1);
+  BOOST_CHECK_EQUAL(pool.numInUse(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(testChainBufferWriteFd)
+{
+  int fds[2];
+  BOOST_REQUIRE_EQUAL(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  BlockPool pool;
+  ChainBuffer buf(&pool);
+  const string data = pattern(3 * BlockPool::kBlockSize + 100);
+  buf.append(data.data(), 100);
+  buf.append(data.data() + 100, data.size() - 100);
+
+  string received;
+  while (buf.readableBytes() > 0)
+  {
+    int savedErrno = 0;
+    ssize_t n = buf.writeFd(fds[0], &savedErrno);
+    BOOST_REQUIRE(n > 0);
+    char tmp[65536];
+    ssize_t total = 0;
+    while (total < n)
+    {
+      ssize_t nr = ::read(fds[1], tmp, sizeof tmp);
+      BOOST_REQUIRE(nr > 0);
+      received.append(tmp, nr);
+      total += nr;
+    }
+  }
+  BOOST_CHECK(received == data);
+  BOOST_CHECK_EQUAL(buf.numBlocks(), 0);
+  BOOST_CHECK_EQUAL(pool.numInUse(), 0);
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+BOOST_AUTO_TEST_CASE(testChainBufferConnectionDestroyed)
+{
+  int fds[2];
+  BOOST_REQUIRE_EQUAL(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
+  EventLoop loop;
+  BlockPool* pool = loop.blockPool();
+  {
+    TcpConnectionPtr conn(new TcpConnection(&loop, "chained", fds[0],
+                                            InetAddress(), InetAddress()));
+    conn->setConnectionCallback(muduo::net::defaultConnectionCallback);
+    conn->setMessageCallback(muduo::net::defaultMessageCallback);
+    conn->setChainedOutput(true);
+    conn->connectEstablished();
+    // 对端不读，大部分留在输出缓冲区
+    const string data = pattern(4 * 1024 * 1024);
+    conn->send(data);
+    BOOST_CHECK(pool->numInUse() > 0);
+    // 没发出去的块还给 loop 的 pool
+    conn->connectDestroyed();
+    BOOST_CHECK_EQUAL(pool->numInUse(), 0);
+    BOOST_CHECK(pool->numFree() > 0);
+  }
+  ::close(fds[1]);
+}
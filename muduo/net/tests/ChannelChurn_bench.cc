@@ -0,0 +1,147 @@
+// 大量连接下 Channel 注册、注销的开销，主要是 Poller 里按 fd 查 Channel 的代价。
+// 用 eventfd 代替真正的连接，MUDUO_USE_POLL=1 测 PollPoller。
+// usage: channelchurn_bench [fds] [rounds]
+
+#include <muduo/net/Channel.h>
+#include <muduo/net/EventLoop.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+int64_t nowNanos()
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void report(const char* phase, int n, int64_t start)
+{
+  double ns = static_cast<double>(nowNanos() - start);
+  printf("  %-36s %8.1f ns/op\n", phase, ns / n);
+}
+
+// 跑一轮 loop，把推迟的注册交给内核
+void runOnce(EventLoop* loop)
+{
+  loop->queueInLoop([loop] { loop->quit(); });
+  loop->wakeup();
+  loop->loop();
+}
+
+int main(int argc, char* argv[])
+{
+  int n = argc > 1 ? atoi(argv[1]) : 100 * 1000;
+  int rounds = argc > 2 ? atoi(argv[2]) : 1000 * 1000;
+
+  struct rlimit rl;
+  ::getrlimit(RLIMIT_NOFILE, &rl);
+  rlim_t wanted = static_cast<rlim_t>(n) + 64;
+  if (rl.rlim_cur < wanted)
+  {
+    rl.rlim_cur = std::min(wanted, rl.rlim_max);
+    ::setrlimit(RLIMIT_NOFILE, &rl);
+  }
+  if (rl.rlim_cur < wanted)
+  {
+    n = static_cast<int>(rl.rlim_cur) - 64;
+    printf("RLIMIT_NOFILE is %lu, only %d fds\n",
+           static_cast<unsigned long>(rl.rlim_cur), n);
+  }
+
+  EventLoop loop;
+  std::vector<std::unique_ptr<Channel>> channels;
+  std::vector<int> fds;
+  for (int i = 0; i < n; ++i)
+  {
+    int fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd < 0)
+    {
+      perror("eventfd");
+      return 1;
+    }
+    fds.push_back(fd);
+    channels.emplace_back(new Channel(&loop, fd));
+  }
+  printf("%d fds, %d rounds\n", n, rounds);
+
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<int> pick(0, n - 1);
+
+  // 新连接在注册之后、到达内核之前就关闭了，只有 Poller 内部的簿记
+  int64_t start = nowNanos();
+  for (int i = 0; i < rounds; ++i)
+  {
+    std::unique_ptr<Channel>& channel = channels[pick(gen)];
+    channel->enableReading();
+    channel->disableAll();
+    channel->remove();
+    channel.reset(new Channel(&loop, channel->fd()));
+  }
+  report("add + remove, bookkeeping only", rounds, start);
+
+  start = nowNanos();
+  for (auto& channel : channels)
+  {
+    channel->enableReading();
+  }
+  runOnce(&loop);
+  report("register all", n, start);
+
+  start = nowNanos();
+  int found = 0;
+  for (int i = 0; i < rounds; ++i)
+  {
+    found += loop.hasChannel(channels[pick(gen)].get());
+  }
+  report("hasChannel", rounds, start);
+  if (found != rounds)
+  {
+    printf("hasChannel failed\n");
+  }
+
+  // 每一千次注销、重新注册跑一轮 loop，包括 epoll_ctl
+  const int kBatch = 1000;
+  EventLoop::PollStats before = loop.pollStats();
+  start = nowNanos();
+  for (int i = 0; i < rounds; ++i)
+  {
+    std::unique_ptr<Channel>& channel = channels[pick(gen)];
+    channel->disableAll();
+    channel->remove();
+    channel.reset(new Channel(&loop, channel->fd()));
+    channel->enableReading();
+    if (i % kBatch == kBatch - 1)
+    {
+      runOnce(&loop);
+    }
+  }
+  runOnce(&loop);
+  report("remove + re-register, with kernel", rounds, start);
+  EventLoop::PollStats after = loop.pollStats();
+  printf("  %lld channel updates, %lld epoll_ctl\n",
+         static_cast<long long>(after.channelUpdates - before.channelUpdates),
+         static_cast<long long>(after.interestSyscalls - before.interestSyscalls));
+
+  for (auto& channel : channels)
+  {
+    channel->disableAll();
+    channel->remove();
+  }
+  channels.clear();
+  for (int fd : fds)
+  {
+    ::close(fd);
+  }
+}
@@ -0,0 +1,265 @@
+// 边沿触发（TcpServer::setEdgeTriggered）下 TcpConnection 的回归测试：
+// budget：一次可读事件里要读超过 kMaxReadsPerEvent 次，剩下的由 resumeRead() 接着读；
+// stopread：在 messageCallback 里 stopRead()，之后不能再收到消息，startRead() 之后收完剩下的；
+// shutdown：输出缓冲区里还有大量数据时 shutdown()，对端要先收完全部数据再看到 EOF。
+// 客户端用阻塞 socket 跑在另一个线程，三个阶段依次进行。
+// usage: edgetriggered_unittest [port]
+// io_uring 异步关闭监听 socket，紧接着在同一个端口上再运行可能 EADDRINUSE，各个测试用不同的端口。
+
+#include <muduo/base/Logging.h>
+#include <muduo/base/Thread.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/TcpServer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+enum Phase { kBudget, kStopRead, kShutdown };
+
+const int64_t kBudgetBytes = 8 * 1024 * 1024;
+const int64_t kStopReadBytes = 1024 * 1024;
+const int64_t kShutdownBytes = 16 * 1024 * 1024;
+
+std::atomic<int> g_phase(kBudget);
+
+char expected(int64_t offset)
+{
+  return static_cast<char>(offset % 251);
+}
+
+string pattern(int64_t offset, size_t len)
+{
+  string data(len, '\0');
+  for (size_t i = 0; i < len; ++i)
+  {
+    data[i] = expected(offset + static_cast<int64_t>(i));
+  }
+  return data;
+}
+
+// 服务端每个连接的状态，只在 loop 线程访问
+struct State
+{
+  int phase = kBudget;
+  int64_t received = 0;
+  Timestamp lastReceive;
+  int run = 0;        // 连续几次 messageCallback 的 receiveTime 相同，即同一轮 poll
+  int maxRun = 0;
+  bool stopped = false;
+  int messagesWhileStopped = 0;
+};
+
+typedef std::shared_ptr<State> StatePtr;
+
+int maxRun = 0;
+int messagesWhileStopped = 0;
+bool stopReadResumed = false;
+size_t pendingAtShutdown = 0;
+
+void onConnection(EventLoop* loop, const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    StatePtr state(new State);
+    state->phase = g_phase.load();
+    conn->setContext(state);
+  }
+  else
+  {
+    StatePtr state = std::any_cast<StatePtr>(conn->getContext());
+    if (state->phase == kBudget)
+    {
+      maxRun = state->maxRun;
+    }
+    else if (state->phase == kStopRead)
+    {
+      messagesWhileStopped = state->messagesWhileStopped;
+    }
+    else
+    {
+      loop->quit();
+    }
+  }
+}
+
+void checkInput(State* state, Buffer* buf)
+{
+  for (size_t i = 0; i < buf->readableBytes(); ++i)
+  {
+    assert(buf->peek()[i] == expected(state->received + static_cast<int64_t>(i)));
+  }
+  state->received += static_cast<int64_t>(buf->readableBytes());
+  buf->retrieveAll();
+}
+
+void onMessage(EventLoop* loop, const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime)
+{
+  StatePtr state = std::any_cast<StatePtr>(conn->getContext());
+  if (state->phase == kBudget)
+  {
+    // resumeRead() 与触发它的 handleRead() 在同一轮 poll，receiveTime 相同
+    state->run = (receiveTime == state->lastReceive) ? state->run + 1 : 1;
+    state->lastReceive = receiveTime;
+    state->maxRun = std::max(state->maxRun, state->run);
+    checkInput(state.get(), buf);
+    // 读得慢一点，保证每次读的时候 socket 里都还有数据，读不到 EAGAIN
+    ::usleep(200);
+    if (state->received == kBudgetBytes)
+    {
+      conn->shutdown();
+    }
+  }
+  else if (state->phase == kStopRead)
+  {
+    if (state->stopped)
+    {
+      ++state->messagesWhileStopped;
+    }
+    checkInput(state.get(), buf);
+    if (state->received < kStopReadBytes && !stopReadResumed)
+    {
+      // socket 里还有数据，但本次 handleRead() 不能再读了，之后也不会再有通知
+      conn->stopRead();
+      state->stopped = true;
+      stopReadResumed = true;
+      std::weak_ptr<TcpConnection> weakConn(conn);
+      loop->runAfter(0.2, [weakConn, state] {
+        state->stopped = false;
+        if (TcpConnectionPtr c = weakConn.lock())
+        {
+          c->startRead();
+        }
+      });
+    }
+    if (state->received == kStopReadBytes)
+    {
+      conn->shutdown();
+    }
+  }
+  else
+  {
+    buf->retrieveAll();
+    // 一次交给 send()，大部分留在输出缓冲区，立刻 shutdown()
+    conn->send(pattern(0, kShutdownBytes));
+    pendingAtShutdown = conn->outputBuffer()->readableBytes();
+    conn->shutdown();
+  }
+}
+
+int connectTo(const InetAddress& addr)
+{
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0 || ::connect(fd, addr.getSockAddr(), sizeof(struct sockaddr_in6)) < 0)
+  {
+    LOG_SYSFATAL << "connect";
+  }
+  return fd;
+}
+
+void writeAll(int fd, const string& data)
+{
+  size_t written = 0;
+  while (written < data.size())
+  {
+    ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+    assert(n > 0);
+    written += static_cast<size_t>(n);
+  }
+}
+
+// returns bytes read until EOF, checks the pattern
+int64_t readUntilEof(int fd)
+{
+  int64_t received = 0;
+  char buf[65536];
+  ssize_t n = 0;
+  while ((n = ::read(fd, buf, sizeof buf)) > 0)
+  {
+    for (ssize_t i = 0; i < n; ++i)
+    {
+      assert(buf[i] == expected(received + i));
+    }
+    received += n;
+  }
+  assert(n == 0);
+  return received;
+}
+
+void runClient(const InetAddress& addr)
+{
+  g_phase = kBudget;
+  int fd = connectTo(addr);
+  writeAll(fd, pattern(0, kBudgetBytes));
+  assert(readUntilEof(fd) == 0);
+  ::close(fd);
+
+  g_phase = kStopRead;
+  fd = connectTo(addr);
+  writeAll(fd, pattern(0, kStopReadBytes));
+  assert(readUntilEof(fd) == 0);
+  ::close(fd);
+
+  g_phase = kShutdown;
+  fd = connectTo(addr);
+  writeAll(fd, "go");
+  // 让服务端的输出先堆积起来
+  ::usleep(100 * 1000);
+  int64_t received = readUntilEof(fd);
+  printf("shutdown: %lld bytes pending at shutdown(), received %lld\n",
+         static_cast<long long>(pendingAtShutdown), static_cast<long long>(received));
+  assert(received == kShutdownBytes);
+  ::close(fd);
+  (void)received;
+}
+
+int main(int argc, char* argv[])
+{
+  EventLoop loop;
+  if (!loop.edgeTriggeredSupported())
+  {
+    printf("edge-triggered mode is not supported by this poller, skipped\n");
+    return 0;
+  }
+  if (loop.completionIo())
+  {
+    // 连接用 io_uring 收发数据，setEdgeTriggered() 不起作用
+    printf("connections do not use readiness in completion mode, skipped\n");
+    return 0;
+  }
+  InetAddress addr(static_cast<uint16_t>(argc > 1 ? atoi(argv[1]) : 2014), true);
+  TcpServer server(&loop, addr, "EdgeTriggered");
+  server.setEdgeTriggered(true);
+  server.setConnectionCallback(
+      [&loop](const TcpConnectionPtr& conn) { onConnection(&loop, conn); });
+  server.setMessageCallback(
+      [&loop](const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime) {
+        onMessage(&loop, conn, buf, receiveTime);
+      });
+  server.start();
+  loop.runAfter(30, [] {
+    LOG_FATAL << "timeout";
+  });
+
+  Thread client([&addr] { runClient(addr); }, "client");
+  loop.loop();
+  client.join();
+
+  printf("budget: %d messages in one poll round, kMaxReadsPerEvent = %d\n",
+         maxRun, TcpConnection::kMaxReadsPerEvent);
+  printf("stopread: %d messages while stopped\n", messagesWhileStopped);
+  assert(maxRun > TcpConnection::kMaxReadsPerEvent);
+  assert(messagesWhileStopped == 0);
+  assert(stopReadResumed);
+  assert(pendingAtShutdown > 0);
+}
@@ -63,6 +63,44 @@ int main()
     assert(nextLoop == model.getNextLoop());
   }
 
+  {
+    printf("Pinned threads:\n");
+    EventLoopThreadPool model(&loop, "pinned");
+    model.setThreadNum(2);
+    model.setAffinity(CpuAffinity::compact().setLocalAlloc(true));
+    model.start([](EventLoop* p) {
+      printf("init(): tid = %d, loop = %p, cpu = %d, node = %d\n",
+             CurrentThread::tid(), p, p->cpu(), p->numaNode());
+      assert(p->cpu() == CpuAffinity::currentCpu());
+    });
+  }
+
+  {
+    printf("Least connections:\n");
+    EventLoopThreadPool model(&loop, "least");
+    model.setThreadNum(3);
+    model.setPlacement(EventLoopThreadPool::kLeastConnections);
+    model.start(init);
+    std::vector<EventLoop*> loops = model.getAllLoops();
+    loops[0]->addConnections(2);
+    loops[2]->addConnections(1);
+    assert(model.getNextLoop() == loops[1]);
+    loops[1]->addConnections(3);
+    assert(model.getNextLoop() == loops[2]);
+    loops[2]->addConnections(1);
+    // 0 和 2 都是两个连接，轮流分配
+    EventLoop* first = model.getNextLoop();
+    first->addConnections(1);
+    EventLoop* second = model.getNextLoop();
+    assert(first != second && (first == loops[0] || first == loops[2]));
+    std::vector<EventLoopThreadPool::LoopLoad> loads = model.loads();
+    assert(loads.size() == 3);
+    assert(loads[1].connections == 3);
+    loops[0]->addConnections(-loops[0]->numConnections());
+    loops[1]->addConnections(-3);
+    loops[2]->addConnections(-loops[2]->numConnections());
+  }
+
   loop.loop();
 }
 
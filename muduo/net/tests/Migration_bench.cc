@@ -0,0 +1,262 @@
+// TcpConnection::migrateTo() 和 TcpServer 的自动再平衡。
+// stress：客户端不停地发带序号的字节流，服务端原样发回（一半的连接从主线程跨线程 send()），
+//         同时每 1ms 把一个随机连接迁到随机的 loop，客户端逐字节检查回显，不能丢、不能乱序。
+//         ctest 以短时间运行它作为迁移的回归测试。
+//         MUDUO_USE_IO_URING=completion 时连接不能迁移，只跑回显。
+// rebalance/none：按轮转分配时所有热连接（收到消息要算 200us）都落在同一个 loop 上，
+//         比较打开和关闭自动再平衡时各个 loop 的忙碌时间。
+// usage: migration_bench [threads] [stress|rebalance|none] [connections] [seconds] [lt|et] [port]
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/EventLoopThreadPool.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/TcpClient.h>
+#include <muduo/net/TcpServer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t kBlockSize = 16 * 1024;
+const double kMigrateInterval = 0.001;
+const int64_t kHotMicroSeconds = 200;
+
+char expected(int64_t offset)
+{
+  return static_cast<char>(offset % 251);
+}
+
+void spin(int64_t microSeconds)
+{
+  Timestamp start(Timestamp::now());
+  while (Timestamp::now().microSecondsSinceEpoch() - start.microSecondsSinceEpoch() < microSeconds)
+  {
+  }
+}
+
+// 客户端每个连接的状态，只在主线程访问
+struct Stream
+{
+  char fill = 0;  // 0 表示带序号的字节流
+  int64_t sent = 0;
+  int64_t received = 0;
+};
+
+class Bench : noncopyable
+{
+ public:
+  Bench(EventLoop* loop, const InetAddress& addr, int threads, const char* mode, bool et)
+    : loop_(loop),
+      server_(loop, addr, "MigrationServer"),
+      serverAddr_(addr),
+      stress_(strcmp(mode, "stress") == 0),
+      migrate_(stress_ && !loop->completionIo()),
+      threads_(threads),
+      gen_(42),
+      migrations_(0),
+      moves_(0),
+      errors_(0)
+  {
+    server_.setThreadNum(threads);
+    server_.setEdgeTriggered(et);
+    if (strcmp(mode, "rebalance") == 0)
+    {
+      server_.setRebalanceInterval(0.2);
+    }
+    server_.setConnectionCallback([this](const TcpConnectionPtr& conn) {
+      MutexLockGuard lock(mutex_);
+      if (conn->connected())
+      {
+        conn->setContext(conn->getLoop());
+        serverConnections_.push_back(conn);
+      }
+      else
+      {
+        serverConnections_.erase(
+            std::find(serverConnections_.begin(), serverConnections_.end(), conn));
+      }
+    });
+    // 热连接的名字以 H 开头，见 startClients()
+    server_.setMessageCallback(
+        [this](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+          // context 是上次处理它的 loop，只在连接所属的线程里访问
+          EventLoop* last = std::any_cast<EventLoop*>(conn->getContext());
+          if (last != conn->getLoop())
+          {
+            ++moves_;
+            conn->setContext(conn->getLoop());
+          }
+          if (!stress_ && buf->peek()[0] == 'H')
+          {
+            spin(kHotMicroSeconds);
+          }
+          if (stress_ && conn->peerAddress().toPort() % 2 == 0)
+          {
+            // 一半的连接从主线程回显，跨线程的 send() 要和迁移交错而不乱序
+            string data(buf->retrieveAllAsString());
+            loop_->runInLoop([conn, data]() mutable { conn->send(std::move(data)); });
+          }
+          else
+          {
+            conn->send(buf);
+          }
+        });
+    server_.start();
+  }
+
+  void startClients(int connections)
+  {
+    for (int i = 0; i < connections; ++i)
+    {
+      // 轮转分配，热连接都在同一个 loop 上
+      bool hot = !stress_ && i % threads_ == 0;
+      char name[32];
+      snprintf(name, sizeof name, "%c%05d", hot ? 'H' : 'C', i);
+      TcpClient* client = new TcpClient(loop_, serverAddr_, name);
+      clients_.emplace_back(client);
+      streams_.emplace_back(new Stream);
+      Stream* stream = streams_.back().get();
+      stream->fill = stress_ ? 0 : name[0];
+      client->setConnectionCallback([this, stream](const TcpConnectionPtr& conn) {
+        if (conn->connected())
+        {
+          sendBlock(conn, stream);
+          sendBlock(conn, stream);
+        }
+      });
+      client->setMessageCallback(
+          [this, stream](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+            size_t n = buf->readableBytes();
+            for (size_t j = 0; j < n; ++j)
+            {
+              if (buf->peek()[j] != (stream->fill ? stream->fill : expected(stream->received + j)))
+              {
+                ++errors_;
+                break;
+              }
+            }
+            buf->retrieveAll();
+            int64_t before = stream->received / kBlockSize;
+            stream->received += n;
+            // 每收回一块再发一块，保持两块在路上
+            int64_t after = stream->received / static_cast<int64_t>(kBlockSize);
+            for (int64_t block = before; block < after; ++block)
+            {
+              sendBlock(conn, stream);
+            }
+          });
+      client->connect();
+    }
+  }
+
+  void migrateOne()
+  {
+    std::vector<EventLoop*> loops = server_.threadPool()->getAllLoops();
+    MutexLockGuard lock(mutex_);
+    if (serverConnections_.empty())
+    {
+      return;
+    }
+    TcpConnectionPtr conn = serverConnections_[gen_() % serverConnections_.size()];
+    conn->migrateTo(loops[gen_() % loops.size()]);
+    ++migrations_;
+  }
+
+  bool migrate() const { return migrate_; }
+
+  void report(double seconds)
+  {
+    int64_t bytes = 0;
+    for (const auto& stream : streams_)
+    {
+      bytes += stream->received;
+    }
+    printf("%.1f MiB echoed in %.1f s, %d migrations requested, %d moves seen, %d errors\n",
+           static_cast<double>(bytes) / (1024 * 1024), seconds,
+           migrations_, moves_.load(), errors_);
+
+    int64_t total = 0;
+    std::vector<EventLoopThreadPool::LoopLoad> loads = server_.threadPool()->loads();
+    for (const auto& load : loads)
+    {
+      total += load.loop->busyMicroSeconds();
+    }
+    for (const auto& load : loads)
+    {
+      printf("  loop %p: %3d connections, %5.1f%% of busy time\n",
+             load.loop, load.connections,
+             100.0 * static_cast<double>(load.loop->busyMicroSeconds())
+             / static_cast<double>(total));
+    }
+  }
+
+  // 出错，或者迁移根本没有发生
+  bool failed() const { return errors_ != 0 || (migrate_ && moves_ == 0); }
+
+ private:
+  void sendBlock(const TcpConnectionPtr& conn, Stream* stream)
+  {
+    string block(kBlockSize, stream->fill);
+    if (!stream->fill)
+    {
+      for (size_t i = 0; i < kBlockSize; ++i)
+      {
+        block[i] = expected(stream->sent + i);
+      }
+    }
+    stream->sent += kBlockSize;
+    conn->send(std::move(block));
+  }
+
+  EventLoop* loop_;
+  TcpServer server_;
+  InetAddress serverAddr_;
+  const bool stress_;
+  const bool migrate_;  // completion 模式下 migrateTo() 不起作用
+  const int threads_;
+  std::mt19937 gen_;
+  int migrations_;
+  std::atomic<int> moves_;
+  int errors_;
+  MutexLock mutex_;
+  std::vector<TcpConnectionPtr> serverConnections_ GUARDED_BY(mutex_);
+  std::vector<std::unique_ptr<Stream>> streams_;
+  std::vector<std::unique_ptr<TcpClient>> clients_;
+};
+
+int main(int argc, char* argv[])
+{
+  int threads = argc > 1 ? atoi(argv[1]) : 4;
+  const char* mode = argc > 2 ? argv[2] : "stress";
+  int connections = argc > 3 ? atoi(argv[3]) : 16;
+  double seconds = argc > 4 ? atof(argv[4]) : 3.0;
+  bool et = argc > 5 && strcmp(argv[5], "et") == 0;
+  // io_uring 关闭监听 socket 是异步的，紧接着的下一次运行要换个端口
+  uint16_t port = static_cast<uint16_t>(argc > 6 ? atoi(argv[6]) : 2022);
+  Logger::setLogLevel(Logger::WARN);
+
+  EventLoop loop;
+  Bench bench(&loop, InetAddress(port, true), threads, mode, et);
+  bench.startClients(connections);
+  if (bench.migrate())
+  {
+    loop.runEvery(kMigrateInterval, [&bench] { bench.migrateOne(); });
+  }
+  loop.runAfter(seconds, [&loop] { loop.quit(); });
+  loop.loop();
+  printf("%s, %d threads, %d connections\n", mode, threads, connections);
+  bench.report(seconds);
+  fflush(stdout);
+  ::_exit(bench.failed() ? 1 : 0);  // 不等连接一个个关闭
+}
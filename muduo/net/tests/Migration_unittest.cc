@@ -0,0 +1,106 @@
+// TcpConnection::migrateTo() 三步交接中的跨线程 send()：
+// 让原来的 loop 停在 migrateInLoop() 和 handOver() 之间，此时从别的线程 send()，
+// 它必须送到新 loop、等 takeOver() 之后执行，而不是排在原来 loop 的 handOver() 后面。
+// 对端收到的字节顺序要与 send() 的顺序一致。
+// usage: migration_unittest [port]
+
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Logging.h>
+#include <muduo/base/Thread.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/EventLoopThreadPool.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/TcpServer.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+TcpConnectionPtr g_conn;  // 在 connected 之后只读
+CountDownLatch g_connected(1);
+
+string readExactly(int fd, size_t len)
+{
+  string data;
+  char buf[64];
+  while (data.size() < len)
+  {
+    ssize_t n = ::read(fd, buf, std::min(sizeof buf, len - data.size()));
+    assert(n > 0);
+    data.append(buf, static_cast<size_t>(n));
+  }
+  return data;
+}
+
+void runClient(EventLoop* baseLoop, const InetAddress& addr, std::vector<EventLoop*> loops)
+{
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0 || ::connect(fd, addr.getSockAddr(), sizeof(struct sockaddr_in6)) < 0)
+  {
+    LOG_SYSFATAL << "connect";
+  }
+  g_connected.wait();
+  TcpConnectionPtr conn = g_conn;
+  EventLoop* from = conn->getLoop();
+  EventLoop* to = loops[0] == from ? loops[1] : loops[0];
+
+  conn->send("1");
+  // 同一个线程先后放进 from 的队列：migrateInLoop()，然后是 block；
+  // migrateInLoop() 把 handOver() 排在 block 之后
+  conn->migrateTo(to);
+  CountDownLatch blocked(1);
+  from->queueInLoop([&blocked] {
+    blocked.countDown();
+    ::usleep(100 * 1000);
+  });
+  blocked.wait();
+  assert(conn->migrating());
+  conn->send("2");
+  while (conn->migrating() || conn->getLoop() != to)
+  {
+    ::usleep(1000);
+  }
+  conn->send("3");
+
+  string received = readExactly(fd, 3);
+  printf("received %s, moved %s\n", received.c_str(), conn->getLoop() == to ? "yes" : "no");
+  assert(received == "123");
+  assert(conn->getLoop() == to);
+  ::close(fd);
+  baseLoop->runInLoop([baseLoop] { baseLoop->quit(); });
+}
+
+int main(int argc, char* argv[])
+{
+  EventLoop loop;
+  InetAddress addr(static_cast<uint16_t>(argc > 1 ? atoi(argv[1]) : 2026), true);
+  TcpServer server(&loop, addr, "MigrationTest");
+  server.setThreadNum(2);
+  server.setConnectionCallback([](const TcpConnectionPtr& conn) {
+    if (conn->connected())
+    {
+      g_conn = conn;
+      g_connected.countDown();
+    }
+  });
+  server.start();
+  loop.runAfter(30, [] {
+    LOG_FATAL << "timeout";
+  });
+
+  std::vector<EventLoop*> loops = server.threadPool()->getAllLoops();
+  assert(loops.size() == 2);
+  Thread client([&] { runClient(&loop, addr, loops); }, "client");
+  loop.loop();
+  client.join();
+  g_conn.reset();
+}
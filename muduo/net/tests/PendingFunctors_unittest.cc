@@ -0,0 +1,140 @@
+// EventLoop::queueInLoop() 的 pending functor 队列和唤醒合并（wakeupPending_）：
+// fanin：N 个线程各投递 M 个 functor，每个恰好执行一次；
+// pingpong：loop 阻塞在 poll 里（超时 10 秒，没有定时器），多个线程反复投递一个 functor
+//   并等它执行，在 loop 线程里执行的 functor 再投递一个；丢失一次唤醒就要等到 poll 超时；
+// threads：比原来固定的 hazard record 表（512）更多的线程同时往一个 loop 投递。
+
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Thread.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/EventLoopThread.h>
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kProducers = 8;
+const int kFunctorsPerProducer = 100000;
+const int kRounds = 2000;
+// 远小于 poll 的超时，超过就认为唤醒丢了
+const std::chrono::seconds kWakeupTimeout(2);
+const int kManyThreads = 600;
+const int kPostsPerThread = 100;
+
+// waits until everything posted so far has run
+void drain(EventLoop* loop)
+{
+  CountDownLatch drained(1);
+  loop->queueInLoop([&drained] { drained.countDown(); });
+  drained.wait();
+}
+
+void testFanIn(EventLoop* loop)
+{
+  std::vector<int> counts(kProducers * kFunctorsPerProducer, 0);  // 只在 loop 线程修改
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int p = 0; p < kProducers; ++p)
+  {
+    threads.emplace_back(new Thread([loop, &counts, p] {
+      for (int i = 0; i < kFunctorsPerProducer; ++i)
+      {
+        int* count = &counts[p * kFunctorsPerProducer + i];
+        loop->queueInLoop([count] { ++*count; });
+      }
+    }, "producer"));
+  }
+  for (auto& thr : threads)
+  {
+    thr->join();
+  }
+  drain(loop);
+  for (int count : counts)
+  {
+    assert(count == 1);
+    (void)count;
+  }
+  assert(loop->queueSize() == 0);
+  printf("fanin: %d producers x %d functors\n", kProducers, kFunctorsPerProducer);
+}
+
+void testPingPong(EventLoop* loop)
+{
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int p = 0; p < kProducers; ++p)
+  {
+    threads.emplace_back(new Thread([loop, p] {
+      for (int i = 0; i < kRounds; ++i)
+      {
+        std::promise<void> ran;
+        if ((i + p) % 2 == 0)
+        {
+          loop->queueInLoop([&ran] { ran.set_value(); });
+        }
+        else
+        {
+          // 在 doPendingFunctors() 里投递的，也要唤醒下一轮
+          loop->queueInLoop([loop, &ran] {
+            loop->queueInLoop([&ran] { ran.set_value(); });
+          });
+        }
+        bool ok = ran.get_future().wait_for(kWakeupTimeout) == std::future_status::ready;
+        if (!ok)
+        {
+          printf("pingpong: lost wakeup, producer %d round %d\n", p, i);
+        }
+        assert(ok);
+        (void)ok;
+      }
+    }, "pingpong"));
+  }
+  for (auto& thr : threads)
+  {
+    thr->join();
+  }
+  printf("pingpong: %d producers x %d rounds\n", kProducers, kRounds);
+}
+
+void testManyThreads(EventLoop* loop)
+{
+  int executed = 0;  // 只在 loop 线程访问
+  CountDownLatch posted(kManyThreads);
+  CountDownLatch exit(1);
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int i = 0; i < kManyThreads; ++i)
+  {
+    threads.emplace_back(new Thread([&] {
+      for (int j = 0; j < kPostsPerThread; ++j)
+      {
+        loop->queueInLoop([&executed] { ++executed; });
+      }
+      // 等所有线程都投递完才退出，它们同时存在
+      posted.countDown();
+      exit.wait();
+    }, "poster"));
+  }
+  posted.wait();
+  exit.countDown();
+  for (auto& thr : threads)
+  {
+    thr->join();
+  }
+  drain(loop);
+  printf("threads: %d threads posted %d functors\n", kManyThreads, executed);
+  assert(executed == kManyThreads * kPostsPerThread);
+}
+
+int main()
+{
+  EventLoopThread loopThread;
+  EventLoop* loop = loopThread.getLoop();
+  testFanIn(loop);
+  testPingPong(loop);
+  testManyThreads(loop);
+}
@@ -0,0 +1,149 @@
+// 长短连接混合时 EventLoopThreadPool 各个放置策略的负载均衡。
+// 按 1 个长连接、threads-1 个短连接的顺序依次建立，轮转时长连接全落在同一个 loop 上。
+// 每 20ms 来一个新连接，长连接不停地收发 16KiB 的消息，短连接收到回显即关闭。
+// usage: placement_bench [threads] [rr|lc|lb|p2c] [long connections] [seconds]
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/EventLoopThreadPool.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/TcpClient.h>
+#include <muduo/net/TcpServer.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+EventLoopThreadPool::Placement parsePlacement(const char* name)
+{
+  if (strcmp(name, "lc") == 0)
+    return EventLoopThreadPool::kLeastConnections;
+  if (strcmp(name, "lb") == 0)
+    return EventLoopThreadPool::kLeastBusy;
+  if (strcmp(name, "p2c") == 0)
+    return EventLoopThreadPool::kPowerOfTwoChoices;
+  return EventLoopThreadPool::kRoundRobin;
+}
+
+const double kArrivalInterval = 0.02;
+
+class Bench : noncopyable
+{
+ public:
+  Bench(EventLoop* loop, const InetAddress& addr, int threads,
+        EventLoopThreadPool::Placement placement, int numLong)
+    : loop_(loop),
+      server_(loop, addr, "PlacementServer"),
+      serverAddr_(addr),
+      threads_(threads),
+      total_(numLong * threads),
+      started_(0),
+      longMessage_(16 * 1024, 'L'),
+      shortMessage_("S")
+  {
+    server_.setThreadNum(threads);
+    server_.threadPool()->setPlacement(placement);
+    // 长连接回显，短连接回显之后关闭
+    server_.setMessageCallback(
+        [](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+          bool isShort = buf->peek()[0] == 'S';
+          conn->send(buf);
+          if (isShort)
+          {
+            conn->shutdown();
+          }
+        });
+    server_.start();
+  }
+
+  void startNext()
+  {
+    if (started_ >= total_)
+    {
+      return;
+    }
+    bool isLong = started_ % threads_ == 0;
+    char name[32];
+    snprintf(name, sizeof name, "%c%05d", isLong ? 'L' : 'S', started_++);
+    TcpClient* client = new TcpClient(loop_, serverAddr_, name);
+    clients_.emplace_back(client);
+    client->setConnectionCallback([this, isLong](const TcpConnectionPtr& conn) {
+      if (conn->connected())
+      {
+        conn->send(isLong ? longMessage_ : shortMessage_);
+        // 新连接陆续到来，kLeastBusy 才有采样可用
+        loop_->runAfter(kArrivalInterval, [this] { startNext(); });
+      }
+    });
+    client->setMessageCallback(
+        [isLong](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+          if (isLong)
+          {
+            conn->send(buf);
+          }
+          else
+          {
+            buf->retrieveAll();
+          }
+        });
+    client->connect();
+  }
+
+  void report(double seconds)
+  {
+    int64_t total = 0;
+    std::vector<EventLoopThreadPool::LoopLoad> loads = server_.threadPool()->loads();
+    for (const auto& load : loads)
+    {
+      total += load.loop->busyMicroSeconds();
+    }
+    double maxShare = 0;
+    for (const auto& load : loads)
+    {
+      double share = static_cast<double>(load.loop->busyMicroSeconds()) / static_cast<double>(total);
+      maxShare = std::max(maxShare, share);
+      printf("  loop %p: %3d connections, %5.1f%% of busy time\n",
+             load.loop, load.connections, share * 100);
+    }
+    printf("busiest loop has %.1f%% of busy time, %.2fx the fair share, in %.1f s\n",
+           maxShare * 100, maxShare * static_cast<double>(loads.size()), seconds);
+  }
+
+ private:
+  EventLoop* loop_;
+  TcpServer server_;
+  InetAddress serverAddr_;
+  const int threads_;
+  const int total_;
+  int started_;
+  string longMessage_;
+  string shortMessage_;
+  std::vector<std::unique_ptr<TcpClient>> clients_;
+};
+
+int main(int argc, char* argv[])
+{
+  int threads = argc > 1 ? atoi(argv[1]) : 4;
+  const char* placement = argc > 2 ? argv[2] : "rr";
+  int numLong = argc > 3 ? atoi(argv[3]) : 8;
+  double seconds = argc > 4 ? atof(argv[4]) : 3.0;
+  Logger::setLogLevel(Logger::WARN);
+
+  EventLoop loop;
+  Bench bench(&loop, InetAddress(2021, true), threads, parsePlacement(placement), numLong);
+  bench.startNext();
+  loop.runAfter(seconds, [&loop] { loop.quit(); });
+  loop.loop();
+  printf("%s, %d threads, %d long connections\n", placement, threads, numLong);
+  bench.report(seconds);
+  fflush(stdout);
+  ::_exit(0);  // 不等连接一个个关闭
+}
@@ -0,0 +1,109 @@
+// batch：一轮里重新注册大量 Channel：kChannels 个一直可读、但回调里不读的 socket，
+// 水平触发下每一轮都要报告每一个。IoUringPoller 在一次 poll() 里要提交远多于 SQ 大小的
+// POLL_ADD，而且注册时立即就绪，完成事件多于 CQ 的容量，会遇到 SQ 满和 CQ 积压；
+// 丢掉任何一个 POLL_ADD，那个 Channel 就再也不会被报告。
+// closedfd：IoUringPoller 推迟到 poll() 才提交 POLL_ADD，这之前 fd 已经关闭，
+// 得到 -EBADF，要像 EPOLLERR 一样交给 Channel 的错误回调，而不是结束进程。
+// 用 MUDUO_USE_IO_URING=1 运行来测试 IoUringPoller，默认是 EPollPoller。
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/Channel.h>
+#include <muduo/net/EventLoop.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kChannels = 2000;
+const int kRounds = 50;
+
+void testBatch(EventLoop& loop)
+{
+  std::vector<int> fds(2 * kChannels);
+  std::vector<int> counts(kChannels, 0);
+  std::vector<std::unique_ptr<Channel>> channels;
+  for (int i = 0; i < kChannels; ++i)
+  {
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, &fds[2 * i]) < 0)
+    {
+      LOG_SYSFATAL << "socketpair";
+    }
+    if (::write(fds[2 * i + 1], "x", 1) != 1)
+    {
+      LOG_SYSFATAL << "write";
+    }
+    channels.emplace_back(new Channel(&loop, fds[2 * i]));
+    channels.back()->setReadCallback([&loop, &counts, i](Timestamp) {
+      ++counts[i];
+      if (i == 0 && counts[0] == kRounds)
+      {
+        loop.quit();
+      }
+    });
+    channels.back()->enableReading();
+  }
+  loop.loop();
+
+  int minCount = *std::min_element(counts.begin(), counts.end());
+  printf("batch: %d channels, %lld iterations, every channel reported at least %d times\n",
+         kChannels, static_cast<long long>(loop.iteration()), minCount);
+  // 第一轮的注册可能分在两次 poll() 里
+  assert(minCount >= kRounds - 1);
+  (void)minCount;
+
+  for (auto& channel : channels)
+  {
+    channel->disableAll();
+    channel->remove();
+  }
+  for (int fd : fds)
+  {
+    ::close(fd);
+  }
+}
+
+void testClosedFd(EventLoop& loop)
+{
+  int fds[2];
+  if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) < 0)
+  {
+    LOG_SYSFATAL << "socketpair";
+  }
+  Channel channel(&loop, fds[0]);
+  bool errorCalled = false;
+  channel.setErrorCallback([&] {
+    errorCalled = true;
+    channel.disableAll();
+    channel.remove();
+    loop.quit();
+  });
+  channel.enableReading();
+  ::close(fds[0]);
+  loop.loop();
+  printf("closedfd: error callback %s\n", errorCalled ? "called" : "not called");
+  assert(errorCalled);
+  ::close(fds[1]);
+}
+
+int main()
+{
+  EventLoop loop;
+  loop.runAfter(30, [] {
+    LOG_FATAL << "timeout";
+  });
+  testBatch(loop);
+  // EPollPoller 在 enableReading() 时就注册了，关闭之后不会再报告
+  if (::getenv("MUDUO_USE_IO_URING"))
+  {
+    testClosedFd(loop);
+  }
+}
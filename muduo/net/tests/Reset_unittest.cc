@@ -0,0 +1,143 @@
+// 对端发 RST 之后服务端要发现连接断开：
+// recv：连接空闲、只有读在等的时候收到 RST；
+// send：服务端 stopRead() 之后不停地发，只有写那一侧会看到错误。
+// MUDUO_USE_IO_URING=completion 时没有 POLL_ADD，POLLHUP/POLLERR 都收不到，
+// 只能靠 recv/send 的结果关闭连接，否则连接永远停在 kConnected，测试超时。
+// 就绪模式下 send 阶段的 Channel 什么都不关注，同样要在写出错时关闭；
+// recv 阶段可能同时收到 POLLHUP 和 POLLRDHUP，不能关闭两次。
+// usage: reset_unittest [port]
+
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Logging.h>
+#include <muduo/base/Thread.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/TcpServer.h>
+
+#include <algorithm>
+#include <atomic>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+enum Phase { kRecv, kSend };
+
+const size_t kChunkSize = 64 * 1024;
+const size_t kSendPhaseRead = 1024 * 1024;
+
+std::atomic<int> g_phase(kRecv);
+CountDownLatch g_recvClosed(1);
+CountDownLatch g_sendClosed(1);
+
+void onConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    int phase = g_phase.load();
+    conn->setContext(phase);
+    if (phase == kSend)
+    {
+      conn->stopRead();
+      conn->send(string(kChunkSize, 'x'));
+    }
+  }
+  else
+  {
+    int phase = std::any_cast<int>(conn->getContext());
+    printf("%s: server saw the disconnect\n", phase == kRecv ? "recv" : "send");
+    (phase == kRecv ? g_recvClosed : g_sendClosed).countDown();
+  }
+}
+
+void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  buf->retrieveAll();
+  conn->send("ok");
+}
+
+void onWriteComplete(const TcpConnectionPtr& conn)
+{
+  if (std::any_cast<int>(conn->getContext()) == kSend)
+  {
+    conn->send(string(kChunkSize, 'x'));
+  }
+}
+
+int connectTo(const InetAddress& addr)
+{
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0 || ::connect(fd, addr.getSockAddr(), sizeof(struct sockaddr_in6)) < 0)
+  {
+    LOG_SYSFATAL << "connect";
+  }
+  return fd;
+}
+
+void readExactly(int fd, size_t len)
+{
+  char buf[65536];
+  size_t received = 0;
+  while (received < len)
+  {
+    ssize_t n = ::read(fd, buf, std::min(sizeof buf, len - received));
+    assert(n > 0);
+    received += static_cast<size_t>(n);
+  }
+}
+
+// SO_LINGER 为 0 时 close() 发 RST 而不是 FIN
+void resetConnection(int fd)
+{
+  struct linger lg = { 1, 0 };
+  if (::setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof lg) < 0)
+  {
+    LOG_SYSFATAL << "setsockopt SO_LINGER";
+  }
+  ::close(fd);
+}
+
+void runClient(EventLoop* loop, const InetAddress& addr)
+{
+  g_phase = kRecv;
+  int fd = connectTo(addr);
+  if (::write(fd, "hello", 5) != 5)
+  {
+    LOG_SYSFATAL << "write";
+  }
+  // 服务端已经处理完数据，接下来只有 recv 在等
+  readExactly(fd, 2);
+  resetConnection(fd);
+  g_recvClosed.wait();
+
+  g_phase = kSend;
+  fd = connectTo(addr);
+  readExactly(fd, kSendPhaseRead);
+  resetConnection(fd);
+  g_sendClosed.wait();
+
+  loop->runInLoop([loop] { loop->quit(); });
+}
+
+int main(int argc, char* argv[])
+{
+  EventLoop loop;
+  InetAddress addr(static_cast<uint16_t>(argc > 1 ? atoi(argv[1]) : 2030), true);
+  TcpServer server(&loop, addr, "ResetTest");
+  server.setConnectionCallback(onConnection);
+  server.setMessageCallback(onMessage);
+  server.setWriteCompleteCallback(onWriteComplete);
+  server.start();
+  loop.runAfter(30, [] {
+    LOG_FATAL << "timeout, the server never saw the reset";
+  });
+
+  Thread client([&loop, &addr] { runClient(&loop, addr); }, "client");
+  loop.loop();
+  client.join();
+}
@@ -0,0 +1,154 @@
+// 短连接建立的吞吐：服务端 N 个 I/O 线程，比较 baseLoop 统一 accept 再分发（single）
+// 和每个 I/O loop 各自 SO_REUSEPORT accept（perloop，steer 另外按 CPU 分流）。
+// 客户端在主线程的 loop 里，连上之后发一条消息，服务端原样发回并关闭连接。
+// usage: reuseport_bench [threads] [single|perloop|steer] [connections] [concurrency] [port]
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/TcpClient.h>
+#include <muduo/net/TcpServer.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+class Bench : noncopyable
+{
+ public:
+  Bench(EventLoop* loop, const InetAddress& addr, int connections,
+        int threads, const char* mode)
+    : loop_(loop),
+      server_(loop, addr, "ReusePortServer",
+              strcmp(mode, "single") == 0 ? TcpServer::kNoReusePort
+                                          : TcpServer::kReusePortPerLoop),
+      serverAddr_(addr),
+      connections_(connections),
+      remaining_(connections),
+      started_(0),
+      message_(64, 'x'),
+      serverConnections_(0),
+      accepted_(0)
+  {
+    server_.setThreadNum(threads);
+    if (strcmp(mode, "steer") == 0)
+    {
+      server_.setThreadAffinity(CpuAffinity::compact());
+      server_.setReusePortCpuSteering(true);
+    }
+    // 连接回调在各个 I/O 线程里，计数要原子
+    server_.setConnectionCallback([this](const TcpConnectionPtr& conn) {
+      if (conn->connected())
+      {
+        ++serverConnections_;
+        ++accepted_;
+        MutexLockGuard lock(mutex_);
+        ++perLoop_[conn->getLoop()];
+      }
+      else if (--serverConnections_ == 0 && remaining_ == 0)
+      {
+        loop_->quit();
+      }
+    });
+    server_.setMessageCallback(
+        [](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+          conn->send(buf);
+          conn->shutdown();
+        });
+    server_.setThreadInitCallback([this](EventLoop* ioLoop) {
+      MutexLockGuard lock(mutex_);
+      perLoop_[ioLoop] = 0;
+    });
+    server_.start();
+  }
+
+  void startClient()
+  {
+    // 几个连接同时断开时会排队多个 startClient()
+    if (started_ >= connections_)
+    {
+      return;
+    }
+    char name[32];
+    snprintf(name, sizeof name, "C%06d", started_++);
+    TcpClient* client = new TcpClient(loop_, serverAddr_, name);
+    clients_.emplace_back(client);
+    client->setConnectionCallback([this](const TcpConnectionPtr& conn) {
+      if (conn->connected())
+      {
+        conn->send(message_);
+      }
+      else
+      {
+        if (--remaining_ == 0 && serverConnections_ == 0)
+        {
+          loop_->quit();
+        }
+        if (started_ < connections_)
+        {
+          loop_->queueInLoop([this] { startClient(); });
+        }
+      }
+    });
+    client->connect();
+  }
+
+  int64_t accepted() const { return accepted_; }
+
+  void printPerLoop()
+  {
+    MutexLockGuard lock(mutex_);
+    for (const auto& item : perLoop_)
+    {
+      printf("  loop %p cpu %d: %d connections\n",
+             item.first, item.first->cpu(), item.second);
+    }
+  }
+
+ private:
+  EventLoop* loop_;
+  TcpServer server_;
+  InetAddress serverAddr_;
+  const int connections_;
+  std::atomic<int> remaining_;
+  int started_;
+  string message_;
+  std::atomic<int> serverConnections_;
+  std::atomic<int64_t> accepted_;
+  MutexLock mutex_;
+  std::map<EventLoop*, int> perLoop_ GUARDED_BY(mutex_);
+  std::vector<std::unique_ptr<TcpClient>> clients_;
+};
+
+int main(int argc, char* argv[])
+{
+  int threads = argc > 1 ? atoi(argv[1]) : 4;
+  const char* mode = argc > 2 ? argv[2] : "perloop";
+  int connections = argc > 3 ? atoi(argv[3]) : 20000;
+  int concurrency = argc > 4 ? atoi(argv[4]) : 16;
+  uint16_t port = static_cast<uint16_t>(argc > 5 ? atoi(argv[5]) : 2019);
+  Logger::setLogLevel(Logger::WARN);
+
+  EventLoop loop;
+  Bench bench(&loop, InetAddress(port, true), connections, threads, mode);
+  for (int i = 0; i < concurrency && i < connections; ++i)
+  {
+    bench.startClient();
+  }
+  Timestamp start(Timestamp::now());
+  loop.loop();
+  double seconds = timeDifference(Timestamp::now(), start);
+
+  printf("%s, %d threads: %lld connections in %.3f s, %.0f conn/s\n",
+         mode, threads, static_cast<long long>(bench.accepted()), seconds,
+         static_cast<double>(bench.accepted()) / seconds);
+  bench.printPerLoop();
+}
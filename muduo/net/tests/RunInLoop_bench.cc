@@ -0,0 +1,135 @@
+// 跨线程 runInLoop() 的吞吐量和延迟。
+// usage: runinloop_bench [producers] [posts_per_producer] [busy_poll_us]
+
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Histogram.h>
+#include <muduo/base/Thread.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/EventLoopThread.h>
+
+#include <memory>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+int64_t nowNanos()
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// 多个线程同时向一个 loop 投递，loop 线程里只做计数
+void benchThroughput(EventLoop* loop, int producers, int posts)
+{
+  int64_t total = static_cast<int64_t>(producers) * posts;
+  int64_t count = 0;  // only touched in loop thread
+  CountDownLatch done(1);
+  CountDownLatch ready(producers);
+  CountDownLatch go(1);
+  int64_t wakeupsBefore = loop->wakeups();
+
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int i = 0; i < producers; ++i)
+  {
+    threads.emplace_back(new Thread([&] {
+      ready.countDown();
+      go.wait();
+      for (int n = 0; n < posts; ++n)
+      {
+        loop->runInLoop([&count, &done, total] {
+          if (++count == total)
+          {
+            done.countDown();
+          }
+        });
+      }
+    }, "producer"));
+  }
+  ready.wait();
+  int64_t start = nowNanos();
+  go.countDown();
+  done.wait();
+  double seconds = static_cast<double>(nowNanos() - start) / 1e9;
+  for (auto& thr : threads)
+  {
+    thr->join();
+  }
+  int64_t wakeups = loop->wakeups() - wakeupsBefore;
+  printf("throughput: %d producer(s) %lld posts %.3f s %.0f posts/s, "
+         "%lld eventfd writes (%.3f per post)\n",
+         producers, static_cast<long long>(total), seconds,
+         static_cast<double>(total) / seconds, static_cast<long long>(wakeups),
+         static_cast<double>(wakeups) / static_cast<double>(total));
+}
+
+// 投递到执行的延迟，intervalUs 为 0 时连续投递
+void benchLatency(EventLoop* loop, int posts, int intervalUs)
+{
+  Histogram latency;
+  CountDownLatch done(posts);
+  for (int n = 0; n < posts; ++n)
+  {
+    int64_t sent = nowNanos();
+    loop->runInLoop([&latency, &done, sent] {
+      latency.add(nowNanos() - sent);
+      done.countDown();
+    });
+    if (intervalUs > 0)
+    {
+      ::usleep(intervalUs);
+    }
+  }
+  done.wait();
+  printf("latency: interval %4d us, ns %s\n", intervalUs, latency.toString().c_str());
+}
+
+void printPollStats(EventLoop* loop)
+{
+  EventLoop::PollStats stats;
+  CountDownLatch done(1);
+  loop->runInLoop([&] {
+    stats = loop->pollStats();
+    done.countDown();
+  });
+  done.wait();
+  printf("busy poll %d us: %lld spins %lld hits %lld blocking, spin %.3f s, "
+         "wakeup latency avg %.1f us max %lld us\n",
+         loop->busyPoll(),
+         static_cast<long long>(stats.spins),
+         static_cast<long long>(stats.spinHits),
+         static_cast<long long>(stats.blockingPolls),
+         static_cast<double>(stats.spinMicroSeconds) / 1e6,
+         stats.wakeupsHandled > 0
+             ? static_cast<double>(stats.wakeupLatencyMicroSeconds)
+                 / static_cast<double>(stats.wakeupsHandled)
+             : 0.0,
+         static_cast<long long>(stats.maxWakeupLatencyMicroSeconds));
+}
+
+int main(int argc, char* argv[])
+{
+  int producers = argc > 1 ? atoi(argv[1]) : 4;
+  int posts = argc > 2 ? atoi(argv[2]) : 200000;
+  int busyPollUs = argc > 3 ? atoi(argv[3]) : 0;
+
+  EventLoopThread thread(
+      [busyPollUs](EventLoop* loop) { loop->setBusyPoll(busyPollUs); });
+  EventLoop* loop = thread.getLoop();
+
+  benchThroughput(loop, 1, posts);
+  if (producers > 1)
+  {
+    benchThroughput(loop, producers, posts);
+  }
+  benchLatency(loop, posts, 0);
+  benchLatency(loop, 10000, 10);
+  benchLatency(loop, 2000, 500);
+  printPollStats(loop);
+}
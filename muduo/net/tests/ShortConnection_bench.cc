@@ -0,0 +1,123 @@
+// 短连接：客户端连上之后发一条消息，服务端原样发回并关闭连接，客户端随即再连。
+// 服务端和客户端在同一个 loop 里，统计每个连接的 Channel 修改次数和实际的 epoll_ctl 次数。
+// usage: shortconn_bench [connections] [concurrency] [port] [et]
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/TcpClient.h>
+#include <muduo/net/TcpServer.h>
+
+#include <memory>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+class Bench : noncopyable
+{
+ public:
+  Bench(EventLoop* loop, const InetAddress& addr, int connections, bool et)
+    : loop_(loop),
+      server_(loop, addr, "ShortServer"),
+      serverAddr_(addr),
+      connections_(connections),
+      remaining_(connections),
+      started_(0),
+      serverConnections_(0),
+      message_(1024, 'x')
+  {
+    // 两端的连接都关闭之后才退出，否则 TcpServer 析构时还有半关闭的连接
+    server_.setConnectionCallback([this](const TcpConnectionPtr& conn) {
+      serverConnections_ += conn->connected() ? 1 : -1;
+      quitIfDone();
+    });
+    server_.setMessageCallback(
+        [](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+          conn->send(buf);
+          conn->shutdown();
+        });
+    server_.setEdgeTriggered(et);
+    server_.start();
+  }
+
+  void startClient()
+  {
+    // 几个连接同时断开时会排队多个 startClient()
+    if (started_ >= connections_)
+    {
+      return;
+    }
+    char name[32];
+    snprintf(name, sizeof name, "C%06d", started_++);
+    TcpClient* client = new TcpClient(loop_, serverAddr_, name);
+    clients_.emplace_back(client);
+    client->setConnectionCallback([this](const TcpConnectionPtr& conn) {
+      if (conn->connected())
+      {
+        conn->send(message_);
+      }
+      else
+      {
+        --remaining_;
+        quitIfDone();
+        if (started_ < connections_)
+        {
+          loop_->queueInLoop([this] { startClient(); });
+        }
+      }
+    });
+    client->connect();
+  }
+
+ private:
+  void quitIfDone()
+  {
+    if (remaining_ == 0 && serverConnections_ == 0)
+    {
+      loop_->quit();
+    }
+  }
+
+  EventLoop* loop_;
+  TcpServer server_;
+  InetAddress serverAddr_;
+  const int connections_;
+  int remaining_;
+  int started_;
+  int serverConnections_;
+  string message_;
+  std::vector<std::unique_ptr<TcpClient>> clients_;
+};
+
+int main(int argc, char* argv[])
+{
+  int connections = argc > 1 ? atoi(argv[1]) : 10000;
+  int concurrency = argc > 2 ? atoi(argv[2]) : 10;
+  uint16_t port = static_cast<uint16_t>(argc > 3 ? atoi(argv[3]) : 2018);
+  bool et = argc > 4 && strcmp(argv[4], "et") == 0;
+  Logger::setLogLevel(Logger::WARN);
+
+  EventLoop loop;
+  Bench bench(&loop, InetAddress(port, true), connections, et);
+  for (int i = 0; i < concurrency && i < connections; ++i)
+  {
+    bench.startClient();
+  }
+  Timestamp start(Timestamp::now());
+  loop.loop();
+  double seconds = timeDifference(Timestamp::now(), start);
+
+  EventLoop::PollStats stats = loop.pollStats();
+  printf("%d connections in %.3f s, %.0f conn/s\n",
+         connections, seconds, connections / seconds);
+  printf("channel updates %lld (%.2f per connection), epoll_ctl %lld (%.2f per connection)\n",
+         static_cast<long long>(stats.channelUpdates),
+         static_cast<double>(stats.channelUpdates) / connections,
+         static_cast<long long>(stats.interestSyscalls),
+         static_cast<double>(stats.interestSyscalls) / connections);
+}
@@ -0,0 +1,157 @@
+// std::set 和 TimingWheel 两种 TimerQueue 在大量 Timer 下的开销，
+// 以及 slack 能省掉多少次 timerfd_settime()。
+// usage: timerqueue_bench [timers] [tick_ms] [slack_ms]
+
+#include <muduo/net/EventLoop.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+int64_t nowNanos()
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+struct ExpiryStats
+{
+  EventLoop* loop;
+  int remaining;
+  int early;
+  int64_t maxLateUs;
+};
+
+void onExpire(ExpiryStats* stats, int64_t whenUs)
+{
+  int64_t late = Timestamp::now().microSecondsSinceEpoch() - whenUs;
+  if (late < 0)
+  {
+    ++stats->early;
+  }
+  stats->maxLateUs = std::max(stats->maxLateUs, late);
+  if (--stats->remaining == 0)
+  {
+    stats->loop->quit();
+  }
+}
+
+void report(const char* phase, int n, int64_t start)
+{
+  double ns = static_cast<double>(nowNanos() - start);
+  printf("  %-28s %8.1f ns/op %8.3f s\n", phase, ns / n, ns / 1e9);
+}
+
+// tickMs 为 0 时使用 std::set
+void bench(int n, double tickMs)
+{
+  if (tickMs > 0)
+  {
+    printf("TimingWheel, tick %.3f ms, %d timers\n", tickMs, n);
+  }
+  else
+  {
+    printf("std::set, %d timers\n", n);
+  }
+  EventLoop loop;
+  if (tickMs > 0)
+  {
+    loop.setTimingWheel(tickMs / 1000);
+  }
+
+  std::mt19937 gen(42);
+  // 空闲连接超时一类的 Timer，绝大多数在到期之前就被取消或者推后
+  std::uniform_real_distribution<double> idle(1, 3600);
+  std::vector<TimerId> timers(n);
+
+  int64_t start = nowNanos();
+  for (int i = 0; i < n; ++i)
+  {
+    timers[i] = loop.runAfter(idle(gen), [] {});
+  }
+  report("runAfter", n, start);
+
+  start = nowNanos();
+  for (int i = 0; i < n; ++i)
+  {
+    loop.cancel(timers[i]);
+    timers[i] = loop.runAfter(idle(gen), [] {});
+  }
+  report("cancel + runAfter (refresh)", n, start);
+
+  start = nowNanos();
+  for (int i = 0; i < n; ++i)
+  {
+    loop.cancel(timers[i]);
+  }
+  report("cancel", n, start);
+
+  // 一秒之内全部到期
+  ExpiryStats stats = { &loop, n, 0, 0 };
+  std::uniform_int_distribution<int64_t> soon(0, 1000 * 1000);
+  Timestamp now(Timestamp::now());
+  for (int i = 0; i < n; ++i)
+  {
+    Timestamp when(now.microSecondsSinceEpoch() + soon(gen));
+    int64_t whenUs = when.microSecondsSinceEpoch();
+    loop.runAt(when, [&stats, whenUs] { onExpire(&stats, whenUs); });
+  }
+  start = nowNanos();
+  loop.loop();
+  printf("  expire all in ~1s               %8.3f s, %d early, max late %lld us\n",
+         static_cast<double>(nowNanos() - start) / 1e9, stats.early,
+         static_cast<long long>(stats.maxLateUs));
+}
+
+// 一万个周期 10ms ~ 100ms 的 runEvery()，运行两秒
+void benchSlack(double tickMs, double slackMs)
+{
+  const int kTimers = 10000;
+  const double kSeconds = 2.0;
+  EventLoop loop;
+  if (tickMs > 0)
+  {
+    loop.setTimingWheel(tickMs / 1000);
+  }
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> interval(0.01, 0.1);
+  for (int i = 0; i < kTimers; ++i)
+  {
+    loop.runEvery(interval(gen), [] {}, slackMs / 1000);
+  }
+  loop.runAfter(kSeconds, [&loop] { loop.quit(); });
+  loop.loop();
+
+  const EventLoop::TimerStats& stats = loop.timerStats();
+  printf("  %-9s slack %5.2f ms: %8.0f fired/s %7.0f wakeups/s "
+         "%7.0f timerfd_settime/s %7.0f saved/s\n",
+         tickMs > 0 ? "wheel" : "std::set", slackMs,
+         static_cast<double>(stats.timersFired) / kSeconds,
+         static_cast<double>(stats.timerfdWakeups) / kSeconds,
+         static_cast<double>(stats.timerfdResets) / kSeconds,
+         static_cast<double>(stats.timerfdResetsSaved) / kSeconds);
+}
+
+int main(int argc, char* argv[])
+{
+  int n = argc > 1 ? atoi(argv[1]) : 1000 * 1000;
+  double tickMs = argc > 2 ? atof(argv[2]) : 1.0;
+  double slackMs = argc > 3 ? atof(argv[3]) : 5.0;
+
+  bench(n, 0);
+  bench(n, tickMs);
+
+  printf("runEvery with slack\n");
+  benchSlack(0, 0);
+  benchSlack(0, slackMs);
+  benchSlack(tickMs, 0);
+  benchSlack(tickMs, slackMs);
+}
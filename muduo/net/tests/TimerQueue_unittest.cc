@@ -3,6 +3,7 @@
 #include <muduo/base/Thread.h>
 
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 
 using namespace muduo;
@@ -32,13 +33,20 @@ void cancel(TimerId timer)
   printf("cancelled at %s\n", Timestamp::now().toString().c_str());
 }
 
-int main()
+// usage: timerqueue_unittest [wheel]
+int main(int argc, char* argv[])
 {
+  // 1ms 的 TimingWheel
+  double wheelTick = argc > 1 && strcmp(argv[1], "wheel") == 0 ? 0.001 : 0.0;
   printTid();
   sleep(1);
   {
     EventLoop loop;
     g_loop = &loop;
+    if (wheelTick > 0)
+    {
+      loop.setTimingWheel(wheelTick);
+    }
 
     print("main");
     loop.runAfter(1, std::bind(print, "once1"));
@@ -57,7 +65,12 @@ int main()
   }
   sleep(1);
   {
-    EventLoopThread loopThread;
+    EventLoopThread loopThread([wheelTick](EventLoop* loop) {
+      if (wheelTick > 0)
+      {
+        loop->setTimingWheel(wheelTick);
+      }
+    });
     EventLoop* loop = loopThread.getLoop();
     loop->runAfter(2, printTid);
     sleep(3);
@@ -0,0 +1,208 @@
+// TimingWheel 的正确性：用模拟时间直接驱动 advance()，检查到期时间、cascade 和超出轮子范围的 Timer；
+// 再通过 EventLoop::setTimingWheel() 检查 TimerQueue 里过期 TimerId 和在回调中 cancel 自己的情况。
+
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/Timer.h>
+#include <muduo/net/TimingWheel.h>
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int64_t kTick = 1000;  // 1ms
+const int64_t kLevelTicks[] = { 1, 64, 64 * 64, 64 * 64 * 64, 64 * 64 * 64 * 64,
+                                int64_t(64) * 64 * 64 * 64 * 64 };
+const int64_t kRangeTicks = int64_t(1) << 36;  // 6 层 64 槽
+
+// 起点故意不对齐任何一层的边界
+const int64_t kStart = 1700000000123456;
+
+Timer* addTimer(TimingWheel* wheel, int64_t expiration, double slack,
+                std::map<Timer*, int64_t>* pending)
+{
+  Timer* timer = wheel->newTimer([] {}, Timestamp(expiration), 0.0, slack);
+  wheel->insert(timer);
+  // 插入时已经过期的，从插入的时刻算起
+  (*pending)[timer] = std::max(expiration, kStart);
+  return timer;
+}
+
+// 每次前进到 nextTick()，偶尔先前进到下一个 tick 之前的某个时刻，
+// 检查到期的 Timer 不早于 expiration()，也不晚一个 tick 以上。
+void fireAll(TimingWheel* wheel, std::map<Timer*, int64_t>* pending, std::mt19937* gen)
+{
+  std::vector<Timer*> expired;
+  int64_t now = kStart;
+  while (wheel->size() > 0)
+  {
+    assert(wheel->size() == pending->size());
+    int64_t next = wheel->nextTick();
+    assert(next != TimingWheel::kNoTick);
+
+    // nextDeadline() 不能晚于任何一个 Timer 的 latest()，已经过期的算作下一个 tick
+    int64_t earliestLatest = TimingWheel::kNoTick;
+    for (const auto& p : *pending)
+    {
+      earliestLatest = std::min(earliestLatest, wheel->tickOf(p.first->latest()));
+    }
+    earliestLatest = std::max(earliestLatest, now / kTick + 1);
+    assert(wheel->nextDeadline() <= earliestLatest);
+    (void)earliestLatest;
+
+    int64_t nextTime = wheel->timeOfTick(next).microSecondsSinceEpoch();
+    assert(nextTime > now);
+    if ((*gen)() % 4 == 0)
+    {
+      // 下一个 tick 之前什么都不该到期
+      int64_t before = now + static_cast<int64_t>((*gen)() % static_cast<uint64_t>(nextTime - now));
+      wheel->advance(Timestamp(before), &expired);
+      assert(expired.empty());
+      now = before;
+    }
+    now = nextTime;
+    wheel->advance(Timestamp(now), &expired);
+    for (Timer* timer : expired)
+    {
+      auto it = pending->find(timer);
+      assert(it != pending->end());
+      assert(it->second <= now);
+      assert(now - it->second < kTick);
+      pending->erase(it);
+      wheel->deleteTimer(timer);
+    }
+    expired.clear();
+  }
+  assert(pending->empty());
+  assert(wheel->nextTick() == TimingWheel::kNoTick);
+  assert(wheel->nextDeadline() == TimingWheel::kNoTick);
+}
+
+void testLevelBoundaries()
+{
+  std::mt19937 gen(1);
+  TimingWheel wheel(0.001, Timestamp(kStart));
+  std::map<Timer*, int64_t> pending;
+  // 每一层边界两侧的 tick，加上 tick 内的偏移，检验向上取整
+  for (int64_t ticks : kLevelTicks)
+  {
+    for (int64_t delta = ticks - 2; delta <= ticks + 2; ++delta)
+    {
+      if (delta > 0)
+      {
+        addTimer(&wheel, kStart + delta * kTick, 0.0, &pending);
+        addTimer(&wheel, kStart + delta * kTick + 1, 0.0, &pending);
+        addTimer(&wheel, kStart + delta * kTick + kTick - 1, 0.0, &pending);
+      }
+    }
+  }
+  // 超出整个轮子范围的，包括正好等于范围的
+  for (int64_t delta : { kRangeTicks - 1, kRangeTicks, kRangeTicks + 1,
+                         kRangeTicks + 12345, 3 * kRangeTicks + 777 })
+  {
+    addTimer(&wheel, kStart + delta * kTick, 0.0, &pending);
+  }
+  // 已经过期的，下一个 tick 到期
+  addTimer(&wheel, kStart - 5 * kTick, 0.0, &pending);
+  printf("level boundaries: %zu timers\n", wheel.size());
+  fireAll(&wheel, &pending, &gen);
+}
+
+void testRandom()
+{
+  std::mt19937 gen(2);
+  TimingWheel wheel(0.001, Timestamp(kStart));
+  std::map<Timer*, int64_t> pending;
+  std::vector<Timer*> removed;
+  for (int i = 0; i < 5000; ++i)
+  {
+    // 各个数量级的延迟大致一样多
+    int level = static_cast<int>(gen() % 6);
+    int64_t delta = static_cast<int64_t>(gen() % static_cast<uint64_t>(kLevelTicks[level] * 64 * kTick));
+    double slack = (gen() % 3 == 0) ? static_cast<double>(gen() % 100) / 1000 : 0.0;
+    Timer* timer = addTimer(&wheel, kStart + delta, slack, &pending);
+    if (gen() % 5 == 0)
+    {
+      removed.push_back(timer);
+    }
+  }
+  // 删掉的不会再出现，而且会让 slotDeadlines_ 偏早
+  for (Timer* timer : removed)
+  {
+    wheel.remove(timer);
+    pending.erase(timer);
+    wheel.deleteTimer(timer);
+  }
+  printf("random: %zu timers, %zu removed\n", wheel.size(), removed.size());
+  fireAll(&wheel, &pending, &gen);
+}
+
+void testPoolReuse()
+{
+  TimingWheel wheel(0.001, Timestamp(kStart));
+  Timer* first = wheel.newTimer([] {}, Timestamp(kStart), 0.0, 0.0);
+  int64_t sequence = first->sequence();
+  wheel.deleteTimer(first);
+  assert(first->sequence() != sequence);
+  // 池是后进先出的，马上就会重用同一个对象，但 sequence 不同
+  Timer* second = wheel.newTimer([] {}, Timestamp(kStart), 0.0, 0.0);
+  assert(second == first);
+  assert(second->sequence() != sequence);
+  wheel.deleteTimer(second);
+  (void)sequence;
+}
+
+// 过期的 TimerId 指向的 Timer 已经被 newTimer() 重用，cancel() 它不能影响新的 Timer
+void testCancelStale()
+{
+  EventLoop loop;
+  loop.setTimingWheel(0.001);
+  bool staleFired = false;
+  bool reusedFired = false;
+  TimerId stale = loop.runAfter(0.01, [&] { staleFired = true; });
+  loop.runAfter(0.05, [&] {
+    assert(staleFired);
+    // stale 的 Timer 在池的最前面，这里会拿到它
+    loop.runAfter(0.02, [&] { reusedFired = true; });
+    loop.cancel(stale);
+  });
+  loop.runAfter(0.2, [&] { loop.quit(); });
+  loop.loop();
+  assert(staleFired);
+  assert(reusedFired);
+}
+
+// 在回调中 cancel 自己的重复 Timer 不会再被 restart
+void testCancelInCallback()
+{
+  EventLoop loop;
+  loop.setTimingWheel(0.001);
+  int count = 0;
+  TimerId self;
+  self = loop.runEvery(0.01, [&] {
+    ++count;
+    loop.cancel(self);
+  });
+  int otherCount = 0;
+  loop.runEvery(0.01, [&] { ++otherCount; });
+  loop.runAfter(0.2, [&] { loop.quit(); });
+  loop.loop();
+  printf("cancel in callback: fired %d times, other timer %d times\n", count, otherCount);
+  assert(count == 1);
+  assert(otherCount > 1);
+}
+
+int main()
+{
+  testLevelBoundaries();
+  testRandom();
+  testPoolReuse();
+  testCancelStale();
+  testCancelInCallback();
+}